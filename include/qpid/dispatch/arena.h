@@ -0,0 +1,72 @@
+#ifndef __dispatch_arena_h__
+#define __dispatch_arena_h__ 1
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**@file
+ * Bump allocator for groups of objects that are released together.
+ *
+ * Objects are carved out of blocks that belong to the arena and are never freed
+ * individually.  Freeing or resetting the arena releases all of them in one step.  The
+ * first block is part of the arena's own allocation, so a small group of objects costs a
+ * single allocation.
+ *
+ *@defgroup arena arena
+ *
+ *@{
+ */
+
+#include <stddef.h>
+
+typedef struct qd_arena_t qd_arena_t;
+
+/**
+ * Create an arena.
+ *
+ * @param block_size The number of bytes available in each block of the arena.
+ * @return A new, empty arena.
+ */
+qd_arena_t *qd_arena(size_t block_size);
+
+/**
+ * Free an arena and every object allocated from it.
+ */
+void qd_arena_free(qd_arena_t *arena);
+
+/**
+ * Allocate memory for an object from an arena.  The memory is suitably aligned for any
+ * type and is not initialized.
+ *
+ * @return Pointer to the memory, or NULL if a new block was needed and could not be allocated.
+ */
+void *qd_arena_alloc(qd_arena_t *arena, size_t size);
+
+/**
+ * Release every object allocated from an arena, keeping its first block for reuse.
+ */
+void qd_arena_reset(qd_arena_t *arena);
+
+/**
+ * The number of bytes allocated from an arena since it was created or last reset.
+ */
+size_t qd_arena_used(const qd_arena_t *arena);
+
+///@}
+
+#endif
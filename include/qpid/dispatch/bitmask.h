@@ -27,17 +27,37 @@
  *@{
  */
 
+#include <qpid/dispatch/error.h>
+
 /** A bit mask */
 typedef struct qd_bitmask_t qd_bitmask_t;
 
+/** The largest number of bits a bitmask may be given. */
+#define QD_BITMASK_MAX_WIDTH 4096
+
 /** Number of bits in a bitmask. */
 int qd_bitmask_width();
 
+/** Set the number of bits in every bitmask, rounded up to a multiple of 64.  This must be
+ * called before the first bitmask is created or the width is first asked for.
+ *@return QD_ERROR_VALUE if bits is not between 1 and QD_BITMASK_MAX_WIDTH, QD_ERROR_RUNTIME
+ * if the width is already in use.
+ */
+qd_error_t qd_bitmask_set_width(int bits);
+
 /** Create a bitmask.
  *@param initial if non-zero set all bits, else clear all bits.
  */
 qd_bitmask_t *qd_bitmask(int initial);
+
+/** Release a reference to a bitmask, freeing it when the last reference is released. */
 void qd_bitmask_free(qd_bitmask_t *b);
+
+/** Take another reference to a bitmask.  A bitmask with more than one reference
+ * is shared and must not be modified.
+ *@return b
+ */
+qd_bitmask_t *qd_bitmask_ref(qd_bitmask_t *b);
 void qd_bitmask_set_all(qd_bitmask_t *b);
 void qd_bitmask_clear_all(qd_bitmask_t *b);
 int qd_bitmask_set_bit(qd_bitmask_t *b, int bitnum);
@@ -46,6 +66,11 @@ int qd_bitmask_value(qd_bitmask_t *b, int bitnum);
 int qd_bitmask_first_set(qd_bitmask_t *b, int *bitnum);
 int qd_bitmask_cardinality(const qd_bitmask_t *b);
 
+/** Set operations, applied in place to b a word at a time. */
+void qd_bitmask_and(qd_bitmask_t *b, const qd_bitmask_t *other);
+void qd_bitmask_or(qd_bitmask_t *b, const qd_bitmask_t *other);
+void qd_bitmask_andnot(qd_bitmask_t *b, const qd_bitmask_t *other);
+
 int _qdbm_start(qd_bitmask_t *b);
 void _qdbm_next(qd_bitmask_t *b, int *v);
 
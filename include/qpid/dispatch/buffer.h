@@ -32,10 +32,19 @@ typedef struct qd_buffer_t qd_buffer_t;
 
 DEQ_DECLARE(qd_buffer_t, qd_buffer_list_t);
 
+/** Buffer size classes, in order of increasing capacity. */
+typedef enum {
+    QD_BUFFER_SMALL,            ///< The default capacity, set by qd_buffer_set_size()
+    QD_BUFFER_MEDIUM,
+    QD_BUFFER_LARGE,
+    QD_BUFFER_CLASSES
+} qd_buffer_class_t;
+
 /** A raw byte buffer .*/
 struct qd_buffer_t {
     DEQ_LINKS(qd_buffer_t);
     unsigned int size;          ///< Size of data content
+    unsigned int size_class;    ///< The qd_buffer_class_t of the buffer
 };
 
 /**
@@ -43,12 +52,31 @@ struct qd_buffer_t {
  */
 void qd_buffer_set_size(size_t size);
 
+/**
+ * Set the capacities of the medium and large buffer classes (4KB and 64KB by default).  A class
+ * that is no larger than the one below it is not used.
+ */
+void qd_buffer_set_class_sizes(size_t medium, size_t large);
+
 /**
  * Create a buffer with capacity set by last call to qd_buffer_set_size(), and data
  * content size of 0 bytes.
  */
 qd_buffer_t *qd_buffer(void);
 
+/**
+ * Create an empty buffer of the given size class.
+ */
+qd_buffer_t *qd_buffer_of_class(qd_buffer_class_t size_class);
+
+/**
+ * Create an empty buffer of the smallest class that can hold hint octets, or of the largest
+ * class if none can.
+ *
+ * @param hint The number of octets expected to be stored in the buffer
+ */
+qd_buffer_t *qd_buffer_sized(size_t hint);
+
 /**
  * Free a buffer
  * @param buf A pointer to an allocated buffer
@@ -209,6 +209,19 @@ void qd_compose_insert_symbol(qd_composed_field_t *field, const char *value);
  */
 void qd_compose_insert_typed_iterator(qd_composed_field_t *field, qd_field_iterator_t *iter);
 
+/**
+ * Insert a run of already-encoded values into the current list or map without
+ * decoding them.  The enclosing composite's count is increased by count.
+ *
+ * @param field A field created by qd_compose.
+ * @param iter An iterator positioned at the first octet of the encoded values.
+ *        The caller is responsible for freeing this iterator after the call is complete.
+ * @param length The number of octets to copy from the iterator.
+ * @param count The number of values encoded in those octets.
+ */
+void qd_compose_insert_encoded(qd_composed_field_t *field, qd_field_iterator_t *iter,
+                               uint32_t length, uint32_t count);
+
 /**
  * Begin composing a new sub field that can be appended to a composed field.
  *
@@ -60,6 +60,18 @@ typedef enum {
  */
 qdpn_driver_t *qdpn_driver(void);
 
+/** Set the I/O budget of each connector.
+ *
+ * Each time a connector is handed out by the driver it may be processed until it has
+ * transferred the given number of octets or been processed the given number of times,
+ * whichever comes first (see qdpn_connector_io_ready).
+ *
+ * @param[in] d the driver
+ * @param[in] bytes the number of octets read and written, or zero for no limit
+ * @param[in] passes the number of times the connector is processed, one or more
+ */
+void qdpn_driver_set_io_budget(qdpn_driver_t *d, size_t bytes, int passes);
+
 /** Return the most recent error code.
  *
  * @param[in] d the driver
@@ -92,6 +104,8 @@ pn_error_t *qdpn_driver_error(qdpn_driver_t *d);
 void qdpn_driver_trace(qdpn_driver_t *driver, pn_trace_t trace);
 
 /** Force qdpn_driver_wait() to return
+ *
+ * When several threads are waiting, only one of them is woken.
  *
  * @param[in] driver the driver to wake up
  *
@@ -99,6 +113,30 @@ void qdpn_driver_trace(qdpn_driver_t *driver, pn_trace_t trace);
  */
 int qdpn_driver_wakeup(qdpn_driver_t *driver);
 
+/** Force every thread waiting in qdpn_driver_wait() to return
+ *
+ * The threads are woken one after another, each passing the wakeup on to the
+ * next until count of them have returned.
+ *
+ * @param[in] driver the driver to wake up
+ * @param[in] count the number of threads that may be waiting
+ *
+ * @return zero on success, an error code on failure
+ */
+int qdpn_driver_wakeup_all(qdpn_driver_t *driver, int count);
+
+/** Indicate whether more than one thread may wait on the driver at a time
+ *
+ * When true, qdpn_driver_wait_2() and qdpn_driver_wait_3() may be called
+ * concurrently from several threads and each returned connector or listener
+ * is handed to exactly one of them.
+ *
+ * @param[in] driver the driver
+ *
+ * @return true if concurrent waiters are supported
+ */
+bool qdpn_driver_concurrent_wait(qdpn_driver_t *driver);
+
 /** Wait for an active connector or listener
  *
  * @param[in] driver the driver to wait on
@@ -269,6 +307,19 @@ void qdpn_connector_trace(qdpn_connector_t *connector, pn_trace_t trace);
  */
 void qdpn_connector_process(qdpn_connector_t *connector);
 
+/** Check whether the connector should be processed again before it is given back to the driver.
+ *
+ * A single call to qdpn_connector_process does at most one read and one write.  This
+ * returns true while the socket is still known to be readable (with room in the transport)
+ * or writable (with output pending) and the connector has not used up the I/O budget it was
+ * given when the driver handed it out.  When the budget is used up the connector gives way
+ * to others, and is serviced again later for the readiness that remains.
+ *
+ * @param[in] connector the connector that has just been processed.
+ * @return true if the connector should be processed again.
+ */
+bool qdpn_connector_io_ready(qdpn_connector_t *connector);
+
 /** Access the listener which opened this connector.
  *
  * @param[in] connector connector whose listener will be returned.
@@ -334,6 +385,16 @@ const char *qdpn_connector_name(const qdpn_connector_t *connector);
  */
 const char *qdpn_connector_hostip(const qdpn_connector_t *connector);
 
+/** Access the I/O counters of the connector
+ *
+ * @param[in] connector the connector of interest
+ * @param[out] octets_in octets read from the socket since the connector was created
+ * @param[out] octets_out octets written to the socket since the connector was created
+ * @param[out] io_yields times the connector gave way to others with I/O still ready
+ *             (see qdpn_connector_io_ready)
+ */
+void qdpn_connector_io_stats(const qdpn_connector_t *connector, uint64_t *octets_in, uint64_t *octets_out, uint64_t *io_yields);
+
 /** Access the transport used by this connector.
  *
  * @param[in] connector connector whose transport will be returned
@@ -375,6 +436,16 @@ void qdpn_connector_free(qdpn_connector_t *connector);
  */
 void qdpn_connector_activate(qdpn_connector_t *connector, qdpn_activate_criteria_t criteria);
 
+/** Notify the driver that a thread has finished servicing the connector.
+ * The driver re-examines the connector and wakes up a waiting thread if the
+ * connector needs further service.  Must be called after the connector has
+ * been released by the servicing thread.
+ * @param[in] connector The connector that was serviced
+ * @param[in] work_done True if servicing the connector produced work that may have
+ *                      changed the set of events the connector is interested in
+ */
+void qdpn_connector_serviced(qdpn_connector_t *connector, bool work_done);
+
 /** Activate all of the open file descriptors
  */
 void qdpn_activate_all(qdpn_driver_t *driver);
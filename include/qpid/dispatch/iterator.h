@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <qpid/dispatch/buffer.h>
 #include <qpid/dispatch/iovec.h>
+#include <qpid/dispatch/arena.h>
 
 /**@file
  * Iterate over message buffer chains and addresse fields.
@@ -196,6 +197,12 @@ int qd_field_iterator_end(const qd_field_iterator_t *iter);
  */
 qd_field_iterator_t *qd_field_iterator_sub(const qd_field_iterator_t *iter, uint32_t length);
 
+/**
+ * As qd_field_iterator_sub, but the sub-iterator is allocated from an arena.  It is
+ * released with the arena and must not be passed to qd_field_iterator_free.
+ */
+qd_field_iterator_t *qd_field_iterator_sub_arena(const qd_field_iterator_t *iter, uint32_t length, qd_arena_t *arena);
+
 /**
  * Move the iterator's cursor forward up to length bytes
  */
@@ -238,6 +245,14 @@ int qd_field_iterator_length(const qd_field_iterator_t *iter);
  */
 int qd_field_iterator_ncopy(qd_field_iterator_t *iter, unsigned char* buffer, int n);
 
+/**
+ * Copy up to n bytes from the iterator's current position into buffer.  Unlike
+ * qd_field_iterator_ncopy, the iterator is not reset first, and the data is
+ * copied a buffer segment at a time rather than octet by octet.
+ * @return number of bytes copied.
+ */
+uint32_t qd_field_iterator_read(qd_field_iterator_t *iter, unsigned char *buffer, uint32_t n);
+
 /**
  * Return a new copy of the iterator's view, with a trailing '\0' added.  The
  * cursor is advanced to the end of the view.
@@ -254,6 +269,12 @@ unsigned char *qd_field_iterator_copy(qd_field_iterator_t *iter);
  */
 qd_field_iterator_t *qd_field_iterator_dup(const qd_field_iterator_t *iter);
 
+/**
+ * As qd_field_iterator_dup, but the duplicate is allocated from an arena.  It is
+ * released with the arena and must not be passed to qd_field_iterator_free.
+ */
+qd_field_iterator_t *qd_field_iterator_dup_arena(const qd_field_iterator_t *iter, qd_arena_t *arena);
+
 /**
  * Copy the iterator's view into buffer as a null terminated string,
  * up to a maximum of n bytes. Cursor is advanced by the number of bytes
@@ -201,28 +201,83 @@ int  qd_message_get_phase_annotation(const qd_message_t *msg);
  */
 void qd_message_set_ingress_annotation(qd_message_t *msg, qd_composed_field_t *ingress_field);
 
+/** Result of checking a message to a certain depth */
+typedef enum {
+    QD_MESSAGE_DEPTH_INVALID,     // The message is malformed
+    QD_MESSAGE_DEPTH_OK,          // The message is well-formed to the requested depth
+    QD_MESSAGE_DEPTH_INCOMPLETE   // Not enough of the message has been received to tell
+} qd_message_depth_status_t;
+
 /**
  * Receive message data via a delivery.  This function may be called more than once on the same
- * delivery if the message spans multiple frames.  Once a complete message has been received, this
- * function shall return the message.
+ * delivery if the message spans multiple frames.
+ *
+ * The returned message may be incomplete (see qd_message_receive_complete).  Data received in
+ * later calls is appended to the same message and becomes visible to every reference to it.
  *
  * @param delivery An incoming delivery from a link
- * @return A pointer to the complete message or 0 if the message is not yet complete.
+ * @return A pointer to the message if the message is complete or data was added to it by this
+ *         call, otherwise 0.
  */
 qd_message_t *qd_message_receive(pn_delivery_t *delivery);
 
+/**
+ * Test whether the whole of a message has been received.
+ *
+ * @param msg A pointer to a message.
+ * @return True iff no more data will be added to the message.
+ */
+bool qd_message_receive_complete(qd_message_t *msg);
+
+/**
+ * Abandon a partially received message, for example when its link is lost.  The part of the
+ * message received so far is treated as the whole message by any other references to it.
+ *
+ * @param delivery An incoming delivery from a link
+ */
+void qd_message_receive_cancel(pn_delivery_t *delivery);
+
+/**
+ * Mark a message as having been handed on for forwarding before it was completely received.
+ */
+void qd_message_set_cut_through(qd_message_t *msg, bool cut_through);
+bool qd_message_is_cut_through(const qd_message_t *msg);
+
 /**
  * Send the message outbound on an outgoing link.
  *
+ * If the message has not been completely received, as much of it as is available is sent and the
+ * rest is sent by subsequent calls to qd_message_send_resume on the same link.
+ *
  * @param msg A pointer to a message to be sent.
  * @param link The outgoing link on which to send the message.
+ * @return True iff the whole message has been sent.
+ */
+bool qd_message_send(qd_message_t *msg, qd_link_t *link, bool strip_outbound_annotations);
+
+/**
+ * Test whether the current delivery on a link is a partially sent message.
+ */
+bool qd_message_send_pending(qd_link_t *link);
+
+/**
+ * Continue sending a partially sent message on a link.
+ *
+ * @return True iff the whole message has now been sent.
+ */
+bool qd_message_send_resume(qd_link_t *link);
+
+/**
+ * Abandon the partial send, if any, associated with an outgoing delivery.  This must be called
+ * before the delivery is settled.
  */
-void qd_message_send(qd_message_t *msg, qd_link_t *link, bool strip_outbound_annotations);
+void qd_message_send_cancel(pn_delivery_t *delivery);
 
 /**
  * Check that the message is well-formed up to a certain depth.  Any part of the message that is
  * beyond the specified depth is not checked for validity.
  */
+qd_message_depth_status_t qd_message_check_depth(qd_message_t *msg, qd_message_depth_t depth);
 int qd_message_check(qd_message_t *msg, qd_message_depth_t depth);
 
 /**
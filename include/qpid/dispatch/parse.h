@@ -29,6 +29,10 @@
  *
  * Parse data from qd_field_iterator_t into a tree structure represeniting
  * an AMQP data type tree.
+ *
+ * The sub-fields of a list or map are built the first time they are
+ * accessed, so reading a parsed tree modifies it.  A parsed tree must not be
+ * read by more than one thread at a time without external locking.
  *@{
  */
 
@@ -91,6 +95,17 @@ uint8_t qd_parse_tag(qd_parsed_field_t *field);
  */
 qd_field_iterator_t *qd_parse_raw(qd_parsed_field_t *field);
 
+/**
+ * Return the length in octets of the field's encoded content.  For a scalar
+ * this is the length of the raw value.  For a list or map it is the length of
+ * the encoded sub-fields, which start at the beginning of the raw iterator, so
+ * that they can be copied without being decoded.
+ *
+ * @param field The field pointer returned by qd_parse.
+ * @return The number of octets of encoded content.
+ */
+uint32_t qd_parse_raw_length(qd_parsed_field_t *field);
+
 /**
  * Return the raw content as an unsigned integer up to 32-bits.  This is
  * valid only for scalar fields of a fixed size of 4-octets or fewer.
@@ -50,8 +50,11 @@ ENUM_DECLARE(qd_router_mode);
 
 /**
  * Allocate and start an instance of the router core module.
+ *
+ * @param core_threads The number of core threads.  The first handles all control actions;
+ *        deliveries for addresses are partitioned by hash across the remainder.
  */
-qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area, const char *id);
+qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area, const char *id, int core_threads);
 
 /**
  * Stop and deallocate an instance of the router core.
@@ -510,6 +513,19 @@ qdr_delivery_t *qdr_link_deliver_to(qdr_link_t *link, qd_message_t *msg,
 qdr_delivery_t *qdr_link_deliver_to_routed_link(qdr_link_t *link, qd_message_t *msg, bool settled,
                                                 const uint8_t *tag, int tag_length);
 
+/**
+ * qdr_link_deliver_flush
+ *
+ * Deliveries made with qdr_link_deliver and qdr_link_deliver_to are collected per calling
+ * thread and handed to the core as one action.  Call this at the end of each pass over a
+ * connection's events.  Any other call into the core from the same thread also flushes the
+ * collected deliveries first, so ordering with respect to other actions is preserved.
+ *
+ * @param core Pointer to the core object.  Only deliveries made on this core's links are
+ *             flushed.
+ */
+void qdr_link_deliver_flush(qdr_core_t *core);
+
 void qdr_link_process_deliveries(qdr_core_t *core, qdr_link_t *link, int credit);
 
 void qdr_link_flow(qdr_core_t *core, qdr_link_t *link, int credit, bool drain_mode);
@@ -523,7 +539,13 @@ typedef void (*qdr_link_flow_t)          (void *context, qdr_link_t *link, int c
 typedef void (*qdr_link_offer_t)         (void *context, qdr_link_t *link, int delivery_count);
 typedef void (*qdr_link_drained_t)       (void *context, qdr_link_t *link);
 typedef void (*qdr_link_push_t)          (void *context, qdr_link_t *link);
-typedef void (*qdr_link_deliver_t)       (void *context, qdr_link_t *link, qdr_delivery_t *delivery, bool settled);
+
+/**
+ * Send a delivery on an outgoing link.  If the message is still being received, only part of it
+ * may be sent.  In that case the handler returns false and no further deliveries are offered on
+ * the link until the push handler has finished sending the message.
+ */
+typedef bool (*qdr_link_deliver_t)       (void *context, qdr_link_t *link, qdr_delivery_t *delivery, bool settled);
 typedef void (*qdr_delivery_update_t)    (void *context, qdr_delivery_t *dlv, uint64_t disp, bool settled);
 
 void qdr_connection_handlers(qdr_core_t                *core,
@@ -547,8 +569,23 @@ void qdr_connection_handlers(qdr_core_t                *core,
 void qdr_delivery_free(qdr_delivery_t *delivery);
 void qdr_delivery_update_disposition(qdr_core_t *core, qdr_delivery_t *delivery, uint64_t disp, bool settled);
 
+/**
+ * qdr_delivery_continue
+ *
+ * Notify the core that more of the message of an incoming delivery has been received.  This
+ * is used for messages that were handed to the core before they were complete.
+ *
+ * @param core Pointer to the router core.
+ * @param delivery The incoming delivery.
+ */
+void qdr_delivery_continue(qdr_core_t *core, qdr_delivery_t *delivery);
+
 void qdr_delivery_set_context(qdr_delivery_t *delivery, void *context);
 void *qdr_delivery_get_context(qdr_delivery_t *delivery);
+
+/**
+ * Return a delivery's tag.  Only the first length octets of the tag are defined.
+ */
 void qdr_delivery_tag(const qdr_delivery_t *delivery, const char **tag, int *length);
 qd_message_t *qdr_delivery_message(const qdr_delivery_t *delivery);
 
@@ -27,6 +27,12 @@
 #include "entity.h"
 #include "entity_cache.h"
 
+#if USE_ALLOC_ARENAS
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #if !defined(NDEBUG)
 #define QD_MEMORY_DEBUG 1
 #endif
@@ -60,10 +66,232 @@ DEQ_DECLARE(qd_alloc_item_t, qd_alloc_item_list_t);
 struct qd_alloc_pool_t {
     DEQ_LINKS(qd_alloc_pool_t);
     qd_alloc_item_list_t free_list;
+    uint64_t             top;        // Global pool only: tagged pointer to the top batch
+    uint64_t             count;      // Global pool only: number of items in the batches
+};
+
+//
+// The global pool is a stack of batches that is pushed without a lock, so that threads that
+// free items allocated by other threads don't contend on a lock to hand them back.  A batch is
+// a chain of items linked by their next pointers; the prev pointer of the first item in a
+// batch links to the batch below it in the stack.
+//
+// Pops are serialized by the type's lock.  A popping thread reads the link of the top batch
+// before it swaps the top, and only another pop could take that batch (and perhaps free it to
+// the heap) in the meantime.  With one popper at a time, a batch can't leave the stack and
+// come back while a pop is in progress, so the compare-and-swap can't succeed against a stack
+// that has changed under it.  The top also carries a modification count in its unused
+// high-order bits, which keeps that true should pops ever be made lock-free.
+//
+#if UINTPTR_MAX > 0xffffffffUL
+#define BATCH_TAG_SHIFT 48
+#else
+#define BATCH_TAG_SHIFT 32
+#endif
+#define BATCH_PTR_MASK ((((uint64_t) 1) << BATCH_TAG_SHIFT) - 1)
+#define BATCH_PTR(t)   ((qd_alloc_item_t*) (uintptr_t) ((t) & BATCH_PTR_MASK))
+#define BATCH_NEXT(t, p) (((uint64_t) (uintptr_t) (p)) | ((((t) >> BATCH_TAG_SHIFT) + 1) << BATCH_TAG_SHIFT))
+
+#if USE_ALLOC_ARENAS
+//
+// In arena mode, the batches that would otherwise be taken from the heap are carved out of
+// large arenas, one set per NUMA node, so that a thread pinned to a node gets node-local memory
+// for the items it allocates.  Arenas are mapped with huge pages where possible to reduce TLB
+// misses.  Pages are placed on the node of the thread that first touches them, which is a
+// thread on the arena's node.
+//
+// Arena memory is not returned to the heap until the allocator is finalized, so the
+// global_free_list_max limit isn't applied in this mode and totalFreeToHeap stays at zero.
+//
+#define ARENA_CHUNK_SIZE (2 * 1024 * 1024)
+#define ARENA_MAX_NODES  64
+#define ARENA_ALIGN      16
+
+typedef struct qd_alloc_chunk_t qd_alloc_chunk_t;
+
+struct qd_alloc_chunk_t {
+    qd_alloc_chunk_t *next;
+    size_t            size;
+};
+
+typedef struct {
+    sys_mutex_t      *lock;
+    unsigned char    *cursor;
+    size_t            remaining;
+    qd_alloc_chunk_t *chunks;
+} qd_alloc_arena_t;
+
+static qd_alloc_arena_t  arenas[ARENA_MAX_NODES];
+
+
+static qd_alloc_arena_t *arena_for_thread(void)
+{
+    //
+    // The node is looked up on every carve, not cached per thread, so a thread that is
+    // pinned after its first allocation carves from its new node's arena.  Carves happen
+    // once per batch taken from the heap, not once per item.
+    //
+    unsigned cpu  = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, 0) != 0)
+        node = 0;
+
+    return &arenas[node % ARENA_MAX_NODES];
+}
+
+
+static void *arena_map(size_t size)
+{
+#ifdef MAP_HUGETLB
+    void *p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+        return p;
+#endif
+
+    //
+    // No huge pages are reserved.  Ask for transparent huge pages instead.
+    //
+    void *q = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (q == MAP_FAILED)
+        return 0;
+#ifdef MADV_HUGEPAGE
+    madvise(q, size, MADV_HUGEPAGE);
+#endif
+    return q;
+}
+
+
+/**
+ * Carve up to size octets, in a multiple of min, from the arena of the calling thread's node.
+ * What is left of the current chunk is used before a new chunk is mapped, so the result may
+ * be short of size; the caller comes back for the rest.
+ *
+ * @param carved Set to the number of octets carved.
+ * @return The carved memory, or null if no chunk could be mapped.
+ */
+static void *arena_carve(size_t min, size_t size, size_t *carved)
+{
+    qd_alloc_arena_t *arena  = arena_for_thread();
+    void             *result = 0;
+
+    *carved = 0;
+    sys_mutex_lock(arena->lock);
+    if (arena->remaining < min) {
+        size_t header     = (sizeof(qd_alloc_chunk_t) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+        size_t chunk_size = ((header + size + ARENA_CHUNK_SIZE - 1) / ARENA_CHUNK_SIZE) * ARENA_CHUNK_SIZE;
+        qd_alloc_chunk_t *chunk = (qd_alloc_chunk_t*) arena_map(chunk_size);
+        if (chunk) {
+            chunk->size      = chunk_size;
+            chunk->next      = arena->chunks;
+            arena->chunks    = chunk;
+            arena->cursor    = ((unsigned char*) chunk) + header;
+            arena->remaining = chunk_size - header;
+        }
+    }
+
+    if (arena->remaining >= min) {
+        if (size > arena->remaining)
+            size = (arena->remaining / min) * min;
+        result            = arena->cursor;
+        arena->cursor    += size;
+        arena->remaining -= size;
+        *carved           = size;
+    }
+    sys_mutex_unlock(arena->lock);
+
+    return result;
+}
+#endif
+
+//
+// A type whose configuration has a slab_alignment takes each batch from the heap as a single
+// slab, laid out so that every item starts on an alignment boundary.  This lets a type keep
+// the fields it touches most in one cache line.  Items in slabs are never returned to the heap
+// one at a time, so, as in arena mode, the global_free_list_max limit isn't applied to them;
+// the slabs are freed when the allocator is finalized.
+//
+struct qd_alloc_slab_t {
+    qd_alloc_slab_t *next;
 };
 
-qd_alloc_config_t qd_alloc_default_config_big   = {16,  32, 0};
-qd_alloc_config_t qd_alloc_default_config_small = {64, 128, 0};
+
+/**
+ * Allocate size octets starting on the type's slab alignment.
+ */
+static unsigned char *slab_alloc(qd_alloc_type_desc_t *desc, size_t size)
+{
+    size_t align = desc->config->slab_alignment;
+
+#if USE_ALLOC_ARENAS
+    //
+    // Arena memory is already aligned to ARENA_ALIGN, so only a larger alignment needs
+    // padding.  The carve is kept a multiple of ARENA_ALIGN for the carves that follow.
+    //
+    size_t carve = size + (align > ARENA_ALIGN ? align - ARENA_ALIGN : 0);
+    size_t carved;
+    carve = (carve + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+    unsigned char *raw = arena_carve(carve, carve, &carved);
+    return raw ? (unsigned char*) (((uintptr_t) raw + align - 1) & ~((uintptr_t) align - 1)) : 0;
+#else
+    //
+    // The slab's link is kept in the first alignment unit.
+    //
+    void *block = 0;
+    if (posix_memalign(&block, align, align + size) != 0)
+        return 0;
+
+    qd_alloc_slab_t *slab = (qd_alloc_slab_t*) block;
+    sys_mutex_lock(desc->lock);
+    slab->next  = desc->slabs;
+    desc->slabs = slab;
+    sys_mutex_unlock(desc->lock);
+    return (unsigned char*) block + align;
+#endif
+}
+
+#ifdef QD_MEMORY_DEBUG
+#define ITEM_TRAILER_SIZE sizeof(uint32_t)
+#else
+#define ITEM_TRAILER_SIZE 0
+#endif
+
+//
+// An item's header normally sits in front of it.  In a slab, unless memory debugging needs the
+// header to outlive the allocation, the header is kept in the item itself, which is unused
+// while the item is free.  Items can then be packed at their aligned size, with no room left
+// between them for a header.
+//
+#ifdef QD_MEMORY_DEBUG
+#define ITEM_HEADER_SIZE(d) sizeof(qd_alloc_item_t)
+#else
+#define ITEM_HEADER_SIZE(d) ((d)->config->slab_alignment ? 0 : sizeof(qd_alloc_item_t))
+#endif
+#define ITEM_SIZE(d) (ITEM_HEADER_SIZE(d) + (d)->total_size + ITEM_TRAILER_SIZE)
+#define ITEM_OBJECT(d,i) ((void*) (((unsigned char*) (i)) + ITEM_HEADER_SIZE(d)))
+#define OBJECT_ITEM(d,p) ((qd_alloc_item_t*) (((unsigned char*) (p)) - ITEM_HEADER_SIZE(d)))
+
+//
+// Return an item's memory to the heap, if it came from there on its own.  Return true iff
+// the item was freed.
+//
+static bool item_to_heap(qd_alloc_type_desc_t *desc, qd_alloc_item_t *item)
+{
+    if (desc->config->slab_alignment)
+        return false;  // The memory belongs to a slab and is freed with it.
+#if USE_ALLOC_ARENAS
+    // The memory belongs to an arena and is unmapped with it.
+    return false;
+#else
+    free(item);
+    return true;
+#endif
+}
+
+#define STAT_ADD(d,s,n) __atomic_fetch_add(&(d)->stats->s, (n), __ATOMIC_RELAXED)
+#define STAT_SUB(d,s,n) __atomic_fetch_sub(&(d)->stats->s, (n), __ATOMIC_RELAXED)
+
+qd_alloc_config_t qd_alloc_default_config_big   = {16,  32, 0, 0};
+qd_alloc_config_t qd_alloc_default_config_small = {64, 128, 0, 0};
 #define BIG_THRESHOLD 256
 
 static sys_mutex_t          *init_lock = 0;
@@ -84,11 +312,18 @@ static void qd_alloc_init(qd_alloc_type_desc_t *desc)
                 &qd_alloc_default_config_big : &qd_alloc_default_config_small;
 
         assert (desc->config->local_free_list_max >= desc->config->transfer_batch_size);
+        assert (desc->config->slab_alignment == 0 ||
+                ((desc->config->slab_alignment & (desc->config->slab_alignment - 1)) == 0 &&
+                 desc->config->slab_alignment >= sizeof(qd_alloc_item_t) + sizeof(qd_alloc_slab_t) &&
+                 desc->total_size >= sizeof(qd_alloc_item_t)));
 
         desc->global_pool = NEW(qd_alloc_pool_t);
         DEQ_INIT(desc->global_pool->free_list);
+        desc->global_pool->top   = 0;
+        desc->global_pool->count = 0;
         desc->lock = sys_mutex();
         DEQ_INIT(desc->tpool_list);
+        desc->slabs = 0;
         desc->stats = NEW(qd_alloc_stats_t);
         memset(desc->stats, 0, sizeof(qd_alloc_stats_t));
 
@@ -106,6 +341,58 @@ static void qd_alloc_init(qd_alloc_type_desc_t *desc)
 }
 
 
+static void global_push(qd_alloc_type_desc_t *desc, qd_alloc_item_t *batch, int size)
+{
+    qd_alloc_pool_t *global = desc->global_pool;
+    uint64_t         top    = __atomic_load_n(&global->top, __ATOMIC_ACQUIRE);
+
+    assert(((uintptr_t) batch & ~BATCH_PTR_MASK) == 0);
+
+    while (1) {
+        batch->prev = BATCH_PTR(top);
+        if (__atomic_compare_exchange_n(&global->top, &top, BATCH_NEXT(top, batch), false,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            break;
+        STAT_ADD(desc, global_exchange_retries, 1);
+    }
+
+    __atomic_fetch_add(&global->count, size, __ATOMIC_RELAXED);
+}
+
+
+static qd_alloc_item_t *global_pop(qd_alloc_type_desc_t *desc, int size)
+{
+    qd_alloc_pool_t *global = desc->global_pool;
+    qd_alloc_item_t *batch  = 0;
+
+    //
+    // Don't take the lock for an empty stack.  A batch pushed just after the check is left
+    // for the next pop.
+    //
+    if (!BATCH_PTR(__atomic_load_n(&global->top, __ATOMIC_ACQUIRE)))
+        return 0;
+
+    sys_mutex_lock(desc->lock);
+    uint64_t top = __atomic_load_n(&global->top, __ATOMIC_ACQUIRE);
+    while (BATCH_PTR(top)) {
+        qd_alloc_item_t *below = BATCH_PTR(top)->prev;
+        if (__atomic_compare_exchange_n(&global->top, &top, BATCH_NEXT(top, below), false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            batch = BATCH_PTR(top);
+            break;
+        }
+        STAT_ADD(desc, global_exchange_retries, 1);
+    }
+    sys_mutex_unlock(desc->lock);
+
+    if (batch) {
+        __atomic_fetch_sub(&global->count, size, __ATOMIC_RELAXED);
+        batch->prev = 0;
+    }
+    return batch;
+}
+
+
 /* coverity[+alloc] */
 void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
 {
@@ -143,46 +430,78 @@ void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
 #ifdef QD_MEMORY_DEBUG
         item->desc   = desc;
         item->header = PATTERN_FRONT;
-        *((uint32_t*) ((void*) &item[1] + desc->total_size))= PATTERN_BACK;
+        *((uint32_t*) (ITEM_OBJECT(desc, item) + desc->total_size))= PATTERN_BACK;
 #endif
-        return &item[1];
+        return ITEM_OBJECT(desc, item);
     }
 
     //
     // The local free list is empty, we need to either rebalance a batch
     // of items from the global list or go to the heap to get new memory.
     //
-    sys_mutex_lock(desc->lock);
-    if (DEQ_SIZE(desc->global_pool->free_list) >= desc->config->transfer_batch_size) {
+    item = global_pop(desc, desc->config->transfer_batch_size);
+    if (item) {
         //
         // Rebalance a full batch from the global free list to the thread list.
         //
-        desc->stats->batches_rebalanced_to_threads++;
-        desc->stats->held_by_threads += desc->config->transfer_batch_size;
-        for (idx = 0; idx < desc->config->transfer_batch_size; idx++) {
-            item = DEQ_HEAD(desc->global_pool->free_list);
-            DEQ_REMOVE_HEAD(desc->global_pool->free_list);
+        STAT_ADD(desc, batches_rebalanced_to_threads, 1);
+        STAT_ADD(desc, held_by_threads, desc->config->transfer_batch_size);
+        while (item) {
+            qd_alloc_item_t *next = item->next;
+            DEQ_ITEM_INIT(item);
             DEQ_INSERT_TAIL(pool->free_list, item);
+            item = next;
         }
     } else {
         //
         // Allocate a full batch from the heap and put it on the thread list.
         //
+        size_t         align     = desc->config->slab_alignment;
+        size_t         item_size = 0;
+        unsigned char *block     = 0;
+#if USE_ALLOC_ARENAS
+        unsigned char *end       = 0;
+#endif
+        if (align) {
+            //
+            // Items follow one another at their aligned size.  A header in front of the first
+            // item is given a leading alignment unit of its own.
+            //
+            size_t lead = (ITEM_HEADER_SIZE(desc) + align - 1) & ~(align - 1);
+            item_size = (ITEM_SIZE(desc) + align - 1) & ~(align - 1);
+            block     = slab_alloc(desc, lead + item_size * desc->config->transfer_batch_size);
+            if (block)
+                block += lead - ITEM_HEADER_SIZE(desc);
+        }
+#if USE_ALLOC_ARENAS
+        else
+            item_size = (ITEM_SIZE(desc) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+#endif
         for (idx = 0; idx < desc->config->transfer_batch_size; idx++) {
-            item = (qd_alloc_item_t*) malloc(sizeof(qd_alloc_item_t) + desc->total_size
-#ifdef QD_MEMORY_DEBUG
-                                             + sizeof(uint32_t)
+#if USE_ALLOC_ARENAS
+            //
+            // The batch may be carved in pieces, the first from what is left of a chunk.
+            //
+            if (!align && block == end) {
+                size_t carved = 0;
+                block = arena_carve(item_size, item_size * (desc->config->transfer_batch_size - idx), &carved);
+                end   = block ? block + carved : 0;
+            }
 #endif
-                                             );
+            if (item_size) {
+                item = (qd_alloc_item_t*) block;
+                if (block)
+                    block += item_size;
+            } else
+                item = (qd_alloc_item_t*) malloc(ITEM_SIZE(desc));
             if (item == 0)
                 break;
             DEQ_ITEM_INIT(item);
             DEQ_INSERT_TAIL(pool->free_list, item);
-            desc->stats->held_by_threads++;
-            desc->stats->total_alloc_from_heap++;
+            STAT_ADD(desc, held_by_threads, 1);
+            STAT_ADD(desc, total_alloc_from_heap, 1);
         }
     }
-    sys_mutex_unlock(desc->lock);
 
     item = DEQ_HEAD(pool->free_list);
     if (item) {
@@ -190,9 +509,9 @@ void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
 #ifdef QD_MEMORY_DEBUG
         item->desc = desc;
         item->header = PATTERN_FRONT;
-        *((uint32_t*) ((void*) &item[1] + desc->total_size))= PATTERN_BACK;
+        *((uint32_t*) (ITEM_OBJECT(desc, item) + desc->total_size))= PATTERN_BACK;
 #endif
-        return &item[1];
+        return ITEM_OBJECT(desc, item);
     }
 
     return 0;
@@ -203,7 +522,7 @@ void *qd_alloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool)
 void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p)
 {
     if (!p) return;
-    qd_alloc_item_t *item = ((qd_alloc_item_t*) p) - 1;
+    qd_alloc_item_t *item = OBJECT_ITEM(desc, p);
     int              idx;
 
 #ifdef QD_MEMORY_DEBUG
@@ -239,29 +558,39 @@ void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p)
     // We've exceeded the maximum size of the local free list.  A batch must be
     // rebalanced back to the global list.
     //
-    sys_mutex_lock(desc->lock);
-    desc->stats->batches_rebalanced_to_global++;
-    desc->stats->held_by_threads -= desc->config->transfer_batch_size;
-    for (idx = 0; idx < desc->config->transfer_batch_size; idx++) {
+    qd_alloc_item_t *batch = 0;
+    qd_alloc_item_t *last  = 0;
+    int              size  = desc->config->transfer_batch_size;
+
+    STAT_ADD(desc, batches_rebalanced_to_global, 1);
+    STAT_SUB(desc, held_by_threads, size);
+    for (idx = 0; idx < size; idx++) {
         item = DEQ_HEAD(pool->free_list);
         DEQ_REMOVE_HEAD(pool->free_list);
-        DEQ_INSERT_TAIL(desc->global_pool->free_list, item);
+        if (last)
+            last->next = item;
+        else
+            batch = item;
+        last = item;
     }
 
     //
-    // If there's a global_free_list size limit, remove items until the limit is
-    // not exceeded.
+    // If there's a global_free_list size limit and the batch would exceed it, return the
+    // batch to the heap instead.  The limit is applied in whole batches.
     //
-    if (desc->config->global_free_list_max != 0) {
-        while (DEQ_SIZE(desc->global_pool->free_list) > desc->config->global_free_list_max) {
-            item = DEQ_HEAD(desc->global_pool->free_list);
-            DEQ_REMOVE_HEAD(desc->global_pool->free_list);
-            free(item);
-            desc->stats->total_free_to_heap++;
+    if (!USE_ALLOC_ARENAS && !desc->config->slab_alignment && desc->config->global_free_list_max != 0 &&
+        __atomic_load_n(&desc->global_pool->count, __ATOMIC_RELAXED) + size >
+        (uint64_t) desc->config->global_free_list_max) {
+        while (batch) {
+            item  = batch;
+            batch = batch->next;
+            if (item_to_heap(desc, item))
+                STAT_ADD(desc, total_free_to_heap, 1);
         }
+        return;
     }
 
-    sys_mutex_unlock(desc->lock);
+    global_push(desc, batch, size);
 }
 
 
@@ -269,6 +598,13 @@ void qd_alloc_initialize(void)
 {
     init_lock = sys_mutex();
     DEQ_INIT(type_list);
+
+#if USE_ALLOC_ARENAS
+    for (int i = 0; i < ARENA_MAX_NODES; i++) {
+        memset(&arenas[i], 0, sizeof(qd_alloc_arena_t));
+        arenas[i].lock = sys_mutex();
+    }
+#endif
 }
 
 
@@ -301,15 +637,27 @@ void qd_alloc_finalize(void)
         qd_entity_cache_remove(QD_ALLOCATOR_TYPE, type_item);
         qd_alloc_type_desc_t *desc = type_item->desc;
 
+        //
+        // Items in arenas and slabs are released with their memory rather than freed to the
+        // heap, so count the items reclaimed to find the ones still allocated.
+        //
+        uint64_t outstanding = desc->stats->total_alloc_from_heap - desc->stats->total_free_to_heap;
+
         //
         // Reclaim the items on the global free pool
         //
-        item = DEQ_HEAD(desc->global_pool->free_list);
-        while (item) {
-            DEQ_REMOVE_HEAD(desc->global_pool->free_list);
-            free(item);
-            desc->stats->total_free_to_heap++;
-            item = DEQ_HEAD(desc->global_pool->free_list);
+        qd_alloc_item_t *batch = BATCH_PTR(desc->global_pool->top);
+        while (batch) {
+            qd_alloc_item_t *below = batch->prev;
+            item = batch;
+            while (item) {
+                qd_alloc_item_t *next = item->next;
+                if (item_to_heap(desc, item))
+                    desc->stats->total_free_to_heap++;
+                outstanding--;
+                item = next;
+            }
+            batch = below;
         }
         free(desc->global_pool);
         desc->global_pool = 0;
@@ -322,8 +670,9 @@ void qd_alloc_finalize(void)
             item = DEQ_HEAD(tpool->free_list);
             while (item) {
                 DEQ_REMOVE_HEAD(tpool->free_list);
-                free(item);
-                desc->stats->total_free_to_heap++;
+                if (item_to_heap(desc, item))
+                    desc->stats->total_free_to_heap++;
+                outstanding--;
                 item = DEQ_HEAD(tpool->free_list);
             }
 
@@ -332,14 +681,24 @@ void qd_alloc_finalize(void)
             tpool = DEQ_HEAD(desc->tpool_list);
         }
 
+        //
+        // Reclaim the slabs, if any
+        //
+        qd_alloc_slab_t *slab = desc->slabs;
+        while (slab) {
+            qd_alloc_slab_t *next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        desc->slabs = 0;
+
         //
         // Check the stats for lost items
         //
-        if (dump_file && desc->stats->total_free_to_heap < desc->stats->total_alloc_from_heap)
+        if (dump_file && outstanding > 0)
             fprintf(dump_file,
                     "alloc.c: Items of type '%s' remain allocated at shutdown: %"PRId64"\n",
-                    desc->type_name,
-                    desc->stats->total_alloc_from_heap - desc->stats->total_free_to_heap);
+                    desc->type_name, outstanding);
 
         //
         // Reclaim the descriptor components
@@ -354,6 +713,19 @@ void qd_alloc_finalize(void)
         type_item = DEQ_HEAD(type_list);
     }
 
+#if USE_ALLOC_ARENAS
+    for (int i = 0; i < ARENA_MAX_NODES; i++) {
+        qd_alloc_chunk_t *chunk = arenas[i].chunks;
+        while (chunk) {
+            qd_alloc_chunk_t *next = chunk->next;
+            munmap(chunk, chunk->size);
+            chunk = next;
+        }
+        sys_mutex_free(arenas[i].lock);
+        memset(&arenas[i], 0, sizeof(qd_alloc_arena_t));
+    }
+#endif
+
     sys_mutex_free(init_lock);
     if (dump_file) fclose(dump_file);
 }
@@ -370,7 +742,8 @@ qd_error_t qd_entity_refresh_allocator(qd_entity_t* entity, void *impl) {
         qd_entity_set_long(entity, "totalFreeToHeap", alloc_type->desc->stats->total_free_to_heap) == 0 &&
         qd_entity_set_long(entity, "heldByThreads", alloc_type->desc->stats->held_by_threads) == 0 &&
         qd_entity_set_long(entity, "batchesRebalancedToThreads", alloc_type->desc->stats->batches_rebalanced_to_threads) == 0 &&
-        qd_entity_set_long(entity, "batchesRebalancedToGlobal", alloc_type->desc->stats->batches_rebalanced_to_global) == 0)
+        qd_entity_set_long(entity, "batchesRebalancedToGlobal", alloc_type->desc->stats->batches_rebalanced_to_global) == 0 &&
+        qd_entity_set_long(entity, "globalExchangeRetries", alloc_type->desc->stats->global_exchange_retries) == 0)
         return QD_ERROR_NONE;
     return qd_error_code();
 }
@@ -38,11 +38,15 @@ typedef struct qd_alloc_pool_t qd_alloc_pool_t;
 
 DEQ_DECLARE(qd_alloc_pool_t, qd_alloc_pool_list_t);
 
+/** Allocation slab */
+typedef struct qd_alloc_slab_t qd_alloc_slab_t;
+
 /** Allocation configuration. */
 typedef struct {
     int  transfer_batch_size;
     int  local_free_list_max;
     int  global_free_list_max;
+    int  slab_alignment;        ///< If non-zero, batches are carved from slabs so that items start on this power-of-two boundary
 } qd_alloc_config_t;
 
 /** Allocation statistics. */
@@ -52,6 +56,7 @@ typedef struct {
     uint64_t held_by_threads;
     uint64_t batches_rebalanced_to_threads;
     uint64_t batches_rebalanced_to_global;
+    uint64_t global_exchange_retries;    ///< Updates of the global pool retried because of contention
 } qd_alloc_stats_t;
 
 /** Allocation type descriptor. */
@@ -66,6 +71,7 @@ typedef struct {
     qd_alloc_pool_t      *global_pool;
     sys_mutex_t          *lock;
     qd_alloc_pool_list_t  tpool_list;
+    qd_alloc_slab_t      *slabs;
     uint32_t              trailer;
 } qd_alloc_type_desc_t;
 
@@ -87,7 +93,7 @@ void qd_dealloc(qd_alloc_type_desc_t *desc, qd_alloc_pool_t **tpool, void *p);
  *@internal
  */
 #define ALLOC_DEFINE_CONFIG(T,S,A,C)                                \
-    qd_alloc_type_desc_t __desc_##T = {0, #T, S, A, 0, C, 0, 0, 0, {0,0}, 0}; \
+    qd_alloc_type_desc_t __desc_##T = {0, #T, S, A, 0, C, 0, 0, 0, {0,0}, 0, 0}; \
     __thread qd_alloc_pool_t *__local_pool_##T = 0;                     \
     T *new_##T(void) { return (T*) qd_alloc(&__desc_##T, &__local_pool_##T); }  \
     void free_##T(T *p) { qd_dealloc(&__desc_##T, &__local_pool_##T, (void*) p); } \
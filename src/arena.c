@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <qpid/dispatch/arena.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGN 16
+
+typedef struct arena_block_t arena_block_t;
+
+struct arena_block_t {
+    arena_block_t *next;
+    size_t         size;
+    size_t         used;
+    uint8_t       *data;
+};
+
+struct qd_arena_t {
+    arena_block_t  first;
+    arena_block_t *current;
+    size_t         block_size;
+    size_t         total;
+};
+
+
+static size_t align_up(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+
+qd_arena_t *qd_arena(size_t block_size)
+{
+    size_t      header = align_up(sizeof(qd_arena_t));
+    qd_arena_t *arena;
+
+    block_size = align_up(block_size);
+    arena      = (qd_arena_t*) malloc(header + block_size);
+    if (!arena)
+        return 0;
+
+    arena->first.next = 0;
+    arena->first.size = block_size;
+    arena->first.used = 0;
+    arena->first.data = (uint8_t*) arena + header;
+    arena->current    = &arena->first;
+    arena->block_size = block_size;
+    arena->total      = 0;
+    return arena;
+}
+
+
+static void free_extra_blocks(qd_arena_t *arena)
+{
+    arena_block_t *block = arena->first.next;
+    while (block) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first.next = 0;
+}
+
+
+void qd_arena_free(qd_arena_t *arena)
+{
+    if (!arena)
+        return;
+
+    free_extra_blocks(arena);
+    free(arena);
+}
+
+
+void *qd_arena_alloc(qd_arena_t *arena, size_t size)
+{
+    arena_block_t *block = arena->current;
+
+    size = align_up(size);
+    if (block->size - block->used < size) {
+        //
+        // Start a new block.  An object larger than the block size gets a block of its own.
+        //
+        size_t header = align_up(sizeof(arena_block_t));
+        size_t length = size > arena->block_size ? size : arena->block_size;
+
+        block = (arena_block_t*) malloc(header + length);
+        if (!block)
+            return 0;
+        block->next = 0;
+        block->size = length;
+        block->used = 0;
+        block->data = (uint8_t*) block + header;
+        arena->current->next = block;
+        arena->current       = block;
+    }
+
+    void *item = block->data + block->used;
+    block->used  += size;
+    arena->total += size;
+    return item;
+}
+
+
+void qd_arena_reset(qd_arena_t *arena)
+{
+    free_extra_blocks(arena);
+    arena->first.used = 0;
+    arena->current    = &arena->first;
+    arena->total      = 0;
+}
+
+
+size_t qd_arena_used(const qd_arena_t *arena)
+{
+    return arena->total;
+}
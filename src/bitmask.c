@@ -17,6 +17,7 @@
  * under the License.
  */
 
+
 #include "alloc.h"
 #include <qpid/dispatch/bitmask.h>
 #include <assert.h>
@@ -24,33 +25,58 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
-#define QD_BITMASK_LONGS 2
-#define QD_BITMASK_BITS  (QD_BITMASK_LONGS * 64)
+//
+// The width of every bitmask is set once, before the first bitmask is created, by
+// qd_bitmask_set_width().  The words of the mask follow the header in the same pool item.
+//
+#define QD_BITMASK_DEFAULT_BITS 128
 
 struct qd_bitmask_t {
-    uint64_t array[QD_BITMASK_LONGS];
     int      first_set;
     int      cardinality;
+    uint32_t ref_count;
+    uint64_t array[];
 };
 
+static int    mask_words   = QD_BITMASK_DEFAULT_BITS / 64;
+static size_t array_size   = QD_BITMASK_DEFAULT_BITS / 8;
+static int    width_locked = 0;
+
 ALLOC_DECLARE(qd_bitmask_t);
-ALLOC_DEFINE(qd_bitmask_t);
+ALLOC_DEFINE_CONFIG(qd_bitmask_t, sizeof(qd_bitmask_t), &array_size, 0);
 
+#define QD_BITMASK_BITS  (mask_words * 64)
 #define MASK_INDEX(num)  (num / 64)
 #define MASK_ONEHOT(num) (((uint64_t) 1) << (num % 64))
 #define FIRST_NONE    -1
 #define FIRST_UNKNOWN -2
 
 
+qd_error_t qd_bitmask_set_width(int bits)
+{
+    if (bits < 1 || bits > QD_BITMASK_MAX_WIDTH)
+        return qd_error(QD_ERROR_VALUE, "Bitmask width %d is not between 1 and %d", bits, QD_BITMASK_MAX_WIDTH);
+    if (width_locked)
+        return qd_error(QD_ERROR_RUNTIME, "Bitmask width cannot change once bitmasks are in use");
+
+    mask_words = (bits + 63) / 64;
+    array_size = mask_words * sizeof(uint64_t);
+    return QD_ERROR_NONE;
+}
+
+
 int qd_bitmask_width()
 {
+    width_locked = 1;
     return QD_BITMASK_BITS;
 }
 
 
 qd_bitmask_t *qd_bitmask(int initial)
 {
+    width_locked = 1;
     qd_bitmask_t *b = new_qd_bitmask_t();
+    b->ref_count = 1;
     if (initial)
         qd_bitmask_set_all(b);
     else
@@ -62,13 +88,21 @@ qd_bitmask_t *qd_bitmask(int initial)
 void qd_bitmask_free(qd_bitmask_t *b)
 {
     if (!b) return;
-    free_qd_bitmask_t(b);
+    if (__atomic_sub_fetch(&b->ref_count, 1, __ATOMIC_ACQ_REL) == 0)
+        free_qd_bitmask_t(b);
+}
+
+
+qd_bitmask_t *qd_bitmask_ref(qd_bitmask_t *b)
+{
+    __atomic_fetch_add(&b->ref_count, 1, __ATOMIC_RELAXED);
+    return b;
 }
 
 
 void qd_bitmask_set_all(qd_bitmask_t *b)
 {
-    for (int i = 0; i < QD_BITMASK_LONGS; i++)
+    for (int i = 0; i < mask_words; i++)
         b->array[i] = 0xFFFFFFFFFFFFFFFF;
     b->first_set   = 0;
     b->cardinality = QD_BITMASK_BITS;
@@ -77,7 +111,7 @@ void qd_bitmask_set_all(qd_bitmask_t *b)
 
 void qd_bitmask_clear_all(qd_bitmask_t *b)
 {
-    for (int i = 0; i < QD_BITMASK_LONGS; i++)
+    for (int i = 0; i < mask_words; i++)
         b->array[i] = 0;
     b->first_set   = FIRST_NONE;
     b->cardinality = 0;
@@ -124,21 +158,32 @@ int qd_bitmask_value(qd_bitmask_t *b, int bitnum)
 }
 
 
-int qd_bitmask_first_set(qd_bitmask_t *b, int *bitnum)
+//
+// Find the first set bit at or after bitnum, a word at a time.
+//
+static int next_set(const qd_bitmask_t *b, int bitnum)
 {
-    if (b->first_set == FIRST_UNKNOWN) {
-        b->first_set = FIRST_NONE;
-        for (int i = 0; i < QD_BITMASK_LONGS; i++)
-            if (b->array[i]) {
-                for (int j = 0; j < 64; j++)
-                    if ((((uint64_t) 1) << j) & b->array[i]) {
-                        b->first_set = i * 64 + j;
-                        break;
-                    }
-                break;
-            }
+    if (bitnum >= QD_BITMASK_BITS)
+        return FIRST_NONE;
+
+    int      idx  = MASK_INDEX(bitnum);
+    uint64_t word = b->array[idx] & (~((uint64_t) 0) << (bitnum % 64));
+
+    while (word == 0) {
+        if (++idx == mask_words)
+            return FIRST_NONE;
+        word = b->array[idx];
     }
 
+    return idx * 64 + __builtin_ctzll(word);
+}
+
+
+int qd_bitmask_first_set(qd_bitmask_t *b, int *bitnum)
+{
+    if (b->first_set == FIRST_UNKNOWN)
+        b->first_set = next_set(b, 0);
+
     if (b->first_set == FIRST_NONE)
         return 0;
     *bitnum = b->first_set;
@@ -152,6 +197,44 @@ int qd_bitmask_cardinality(const qd_bitmask_t *b)
 }
 
 
+//
+// The set operations are written as plain loops over whole words so that the compiler can
+// vectorize them.
+//
+static void settle(qd_bitmask_t *b)
+{
+    int cardinality = 0;
+    for (int i = 0; i < mask_words; i++)
+        cardinality += __builtin_popcountll(b->array[i]);
+    b->cardinality = cardinality;
+    b->first_set   = cardinality ? FIRST_UNKNOWN : FIRST_NONE;
+}
+
+
+void qd_bitmask_and(qd_bitmask_t *b, const qd_bitmask_t *other)
+{
+    for (int i = 0; i < mask_words; i++)
+        b->array[i] &= other->array[i];
+    settle(b);
+}
+
+
+void qd_bitmask_or(qd_bitmask_t *b, const qd_bitmask_t *other)
+{
+    for (int i = 0; i < mask_words; i++)
+        b->array[i] |= other->array[i];
+    settle(b);
+}
+
+
+void qd_bitmask_andnot(qd_bitmask_t *b, const qd_bitmask_t *other)
+{
+    for (int i = 0; i < mask_words; i++)
+        b->array[i] &= ~other->array[i];
+    settle(b);
+}
+
+
 int _qdbm_start(qd_bitmask_t *b)
 {
     int v;
@@ -163,30 +246,5 @@ int _qdbm_start(qd_bitmask_t *b)
 
 void _qdbm_next(qd_bitmask_t *b, int *v)
 {
-    if (*v == QD_BITMASK_BITS - 1) {
-        *v = -1;
-        return;
-    }
-
-    int      idx  = MASK_INDEX(*v);
-    uint64_t bits = MASK_ONEHOT(*v);
-    int      next = *v;
-
-    while (1) {
-        next++;
-        if (bits & 0x8000000000000000LL) {
-            if (++idx == QD_BITMASK_LONGS) {
-                *v = -1;
-                return;
-            }
-            bits = 1;
-        } else
-            bits = bits << 1;
-
-        if (b->array[idx] & bits) {
-            *v = next;
-            return;
-        }
-    }
+    *v = next_set(b, *v + 1);
 }
-
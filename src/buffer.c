@@ -24,35 +24,96 @@
 #include <string.h>
 
 
+//
+// Buffers come in size classes so that small messages don't waste the space of a large buffer
+// and large messages aren't spread over long chains of small ones.  Each class has its own
+// allocation pool (and therefore its own allocation statistics).  The small class is the
+// default and has the size set by qd_buffer_set_size().  The larger classes are only used
+// when they are bigger than the small class.
+//
+typedef qd_buffer_t qd_buffer_medium_t;
+typedef qd_buffer_t qd_buffer_large_t;
+
 static size_t buffer_size = 512;
+static size_t class_size[QD_BUFFER_CLASSES] = {512, 4 * 1024, 64 * 1024};
 static int    size_locked = 0;
 
 ALLOC_DECLARE(qd_buffer_t);
+ALLOC_DECLARE(qd_buffer_medium_t);
+ALLOC_DECLARE(qd_buffer_large_t);
 ALLOC_DEFINE_CONFIG(qd_buffer_t, sizeof(qd_buffer_t), &buffer_size, 0);
+ALLOC_DEFINE_CONFIG(qd_buffer_medium_t, sizeof(qd_buffer_t), &class_size[QD_BUFFER_MEDIUM], 0);
+ALLOC_DEFINE_CONFIG(qd_buffer_large_t, sizeof(qd_buffer_t), &class_size[QD_BUFFER_LARGE], 0);
 
 
 void qd_buffer_set_size(size_t size)
 {
     assert(!size_locked);
     buffer_size = size;
+    class_size[QD_BUFFER_SMALL] = size;
 }
 
 
-qd_buffer_t *qd_buffer(void)
+void qd_buffer_set_class_sizes(size_t medium, size_t large)
+{
+    assert(!size_locked);
+    class_size[QD_BUFFER_MEDIUM] = medium;
+    class_size[QD_BUFFER_LARGE]  = large;
+}
+
+
+qd_buffer_t *qd_buffer_of_class(qd_buffer_class_t size_class)
 {
     size_locked = 1;
-    qd_buffer_t *buf = new_qd_buffer_t();
+    qd_buffer_t *buf;
+
+    switch (size_class) {
+    case QD_BUFFER_MEDIUM: buf = new_qd_buffer_medium_t(); break;
+    case QD_BUFFER_LARGE:  buf = new_qd_buffer_large_t();  break;
+    default:
+        size_class = QD_BUFFER_SMALL;
+        buf = new_qd_buffer_t();
+        break;
+    }
 
     DEQ_ITEM_INIT(buf);
-    buf->size = 0;
+    buf->size       = 0;
+    buf->size_class = size_class;
     return buf;
 }
 
 
+qd_buffer_t *qd_buffer(void)
+{
+    return qd_buffer_of_class(QD_BUFFER_SMALL);
+}
+
+
+qd_buffer_t *qd_buffer_sized(size_t hint)
+{
+    qd_buffer_class_t size_class = QD_BUFFER_SMALL;
+
+    for (int i = QD_BUFFER_SMALL + 1; i < QD_BUFFER_CLASSES; i++) {
+        if (class_size[i] <= class_size[size_class])
+            continue;
+        if (hint <= class_size[size_class])
+            break;
+        size_class = (qd_buffer_class_t) i;
+    }
+
+    return qd_buffer_of_class(size_class);
+}
+
+
 void qd_buffer_free(qd_buffer_t *buf)
 {
     if (!buf) return;
-    free_qd_buffer_t(buf);
+
+    switch (buf->size_class) {
+    case QD_BUFFER_MEDIUM: free_qd_buffer_medium_t(buf); break;
+    case QD_BUFFER_LARGE:  free_qd_buffer_large_t(buf);  break;
+    default:               free_qd_buffer_t(buf);        break;
+    }
 }
 
 
@@ -70,7 +131,7 @@ unsigned char *qd_buffer_cursor(qd_buffer_t *buf)
 
 size_t qd_buffer_capacity(qd_buffer_t *buf)
 {
-    return buffer_size - buf->size;
+    return class_size[buf->size_class] - buf->size;
 }
 
 
@@ -83,7 +144,7 @@ size_t qd_buffer_size(qd_buffer_t *buf)
 void qd_buffer_insert(qd_buffer_t *buf, size_t len)
 {
     buf->size += len;
-    assert(buf->size <= buffer_size);
+    assert(buf->size <= class_size[buf->size_class]);
 }
 
 unsigned int qd_buffer_list_clone(qd_buffer_list_t *dst, const qd_buffer_list_t *src)
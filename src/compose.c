@@ -70,6 +70,36 @@ static void qd_insert(qd_composed_field_t *field, const uint8_t *seq, size_t len
 }
 
 
+//
+// Copy up to length octets from an iterator, a buffer segment at a time.
+//
+static void qd_insert_iterator(qd_composed_field_t *field, qd_field_iterator_t *iter, uint32_t length)
+{
+    qd_buffer_t    *buf  = DEQ_TAIL(field->buffers);
+    qd_composite_t *comp = DEQ_HEAD(field->fieldStack);
+
+    while (length > 0) {
+        if (buf == 0 || qd_buffer_capacity(buf) == 0) {
+            buf = qd_buffer();
+            if (buf == 0)
+                return;
+            DEQ_INSERT_TAIL(field->buffers, buf);
+        }
+
+        uint32_t to_copy = qd_buffer_capacity(buf);
+        if (to_copy > length)
+            to_copy = length;
+        to_copy = qd_field_iterator_read(iter, qd_buffer_cursor(buf), to_copy);
+        if (to_copy == 0)
+            return;
+        qd_buffer_insert(buf, to_copy);
+        length -= to_copy;
+        if (comp)
+            comp->length += to_copy;
+    }
+}
+
+
 static void qd_insert_8(qd_composed_field_t *field, uint8_t value)
 {
     qd_insert(field, &value, 1);
@@ -450,11 +480,7 @@ void qd_compose_insert_string_iterator(qd_composed_field_t *field, qd_field_iter
         qd_insert_32(field, len);
     }
 
-    while (!qd_field_iterator_end(iter)) {
-        uint8_t octet = qd_field_iterator_octet(iter);
-        qd_insert_8(field, octet);
-    }
-
+    qd_insert_iterator(field, iter, len);
     bump_count(field);
 }
 
@@ -477,15 +503,22 @@ void qd_compose_insert_symbol(qd_composed_field_t *field, const char *value)
 
 void qd_compose_insert_typed_iterator(qd_composed_field_t *field, qd_field_iterator_t *iter)
 {
-    while (!qd_field_iterator_end(iter)) {
-        uint8_t octet = qd_field_iterator_octet(iter);
-        qd_insert_8(field, octet);
-    }
-
+    qd_insert_iterator(field, iter, UINT32_MAX);
     bump_count(field);
 }
 
 
+void qd_compose_insert_encoded(qd_composed_field_t *field, qd_field_iterator_t *iter,
+                               uint32_t length, uint32_t count)
+{
+    qd_insert_iterator(field, iter, length);
+
+    qd_composite_t *comp = DEQ_HEAD(field->fieldStack);
+    if (comp)
+        comp->count += count;
+}
+
+
 qd_buffer_list_t *qd_compose_buffers(qd_composed_field_t *field)
 {
     return &field->buffers;
@@ -64,6 +64,7 @@ qd_dispatch_t *qd_dispatch(const char *python_pkgdir)
     qd->router_area = strdup("0");
     qd->router_id   = strdup("0");
     qd->router_mode = QD_ROUTER_MODE_ENDPOINT;
+    qd->core_thread_count = 1;
 
     qd_python_initialize(qd, python_pkgdir);
     if (qd_error_code()) { qd_dispatch_free(qd); return 0; }
@@ -101,6 +102,8 @@ qd_error_t qd_dispatch_configure_container(qd_dispatch_t *qd, qd_entity_t *entit
 {
     const char *default_name = "00000000-0000-0000-0000-000000000000";
     qd->thread_count   = qd_entity_opt_long(entity, "workerThreads", 1); QD_ERROR_RET();
+    qd->io_budget_bytes  = qd_entity_opt_long(entity, "ioBudgetBytes", 262144); QD_ERROR_RET();
+    qd->io_budget_passes = qd_entity_opt_long(entity, "ioBudgetPasses", 16); QD_ERROR_RET();
     qd->container_name = qd_entity_opt_string(entity, "containerName", default_name); QD_ERROR_RET();
     qd->sasl_config_path = qd_entity_opt_string(entity, "saslConfigPath", 0); QD_ERROR_RET();
     qd->sasl_config_name = qd_entity_opt_string(entity, "saslConfigName", "qdrouterd"); QD_ERROR_RET();
@@ -120,7 +123,14 @@ qd_error_t qd_dispatch_configure_router(qd_dispatch_t *qd, qd_entity_t *entity)
     qd->router_id   = qd_entity_opt_string(entity, "routerId", qd->container_name);
     QD_ERROR_RET();
     qd->router_mode = qd_entity_get_long(entity, "mode");
-    return qd_error_code();
+    QD_ERROR_RET();
+    qd->core_thread_count = qd_entity_opt_long(entity, "coreThreads", 1);
+    QD_ERROR_RET();
+    long max_routers = qd_entity_opt_long(entity, "maxRouters", 128);
+    QD_ERROR_RET();
+    if (max_routers < 1 || max_routers > QD_BITMASK_MAX_WIDTH)
+        return qd_error(QD_ERROR_CONFIG, "maxRouters must be between 1 and %d", QD_BITMASK_MAX_WIDTH);
+    return qd_bitmask_set_width(max_routers);
 }
 
 qd_error_t qd_dispatch_configure_fixed_address(qd_dispatch_t *qd, qd_entity_t *entity) {
@@ -54,12 +54,15 @@ struct qd_dispatch_t {
     void                    *dl_handle;
 
     int    thread_count;
+    long   io_budget_bytes;
+    int    io_budget_passes;
     char  *container_name;
     char  *sasl_config_path;
     char  *sasl_config_name;
     char  *router_area;
     char  *router_id;
     qd_router_mode_t  router_mode;
+    int    core_thread_count;
 
     qd_log_source_t *log_source;
 };
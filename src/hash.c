@@ -26,8 +26,8 @@
 #include <qpid/dispatch/ctools.h>
 
 typedef struct qd_hash_item_t {
-    DEQ_LINKS(struct qd_hash_item_t);
     unsigned char *key;
+    uint32_t       hash;
     union {
         void       *val;
         const void *val_const;
@@ -36,18 +36,39 @@ typedef struct qd_hash_item_t {
 
 ALLOC_DECLARE(qd_hash_item_t);
 ALLOC_DEFINE(qd_hash_item_t);
-DEQ_DECLARE(qd_hash_item_t, items_t);
 
 
-typedef struct bucket_t {
-    items_t items;
-} bucket_t;
+//
+// The table is an open-addressed array of slots searched by linear probing.  Each slot holds
+// the full hash of its item so that most mismatches are rejected without touching the item or
+// its key.
+//
+// When the table becomes too full, a table of twice the size is allocated and the items are
+// moved to it a few slots at a time by subsequent inserts and removals, so no single operation
+// pays for rehashing the whole table.  While the move is in progress, lookups search both
+// tables.  Slots of the old table that have been emptied are marked as deleted rather than
+// made empty so that they don't break the probe sequences of the items still in it.
+//
+typedef struct slot_t {
+    uint32_t        hash;
+    qd_hash_item_t *item;
+} slot_t;
+
+typedef struct table_t {
+    slot_t       *slots;
+    unsigned int  mask;
+    size_t        used;     // Slots holding an item
+} table_t;
 
+#define SLOT_DELETED   ((qd_hash_item_t*) 1)
+#define SLOT_LIVE(s)   ((s)->item > SLOT_DELETED)
+#define MIN_EXPONENT   3
+#define MIGRATE_SLOTS  16
 
 struct qd_hash_t {
-    bucket_t     *buckets;
-    unsigned int  bucket_count;
-    unsigned int  bucket_mask;
+    table_t       table;        // Where new items are inserted
+    table_t       old;          // The table being moved from, if old.slots isn't null
+    unsigned int  migrated;     // The slots of old that have been moved
     int           batch_size;
     size_t        size;
     int           is_const;
@@ -55,7 +76,6 @@ struct qd_hash_t {
 
 
 struct qd_hash_handle_t {
-    bucket_t    *bucket;
     qd_hash_item_t *item;
 };
 
@@ -63,44 +83,206 @@ ALLOC_DECLARE(qd_hash_handle_t);
 ALLOC_DEFINE(qd_hash_handle_t);
 
 
+static int table_init(table_t *table, int exponent)
+{
+    table->mask  = (1 << exponent) - 1;
+    table->used  = 0;
+    table->slots = NEW_ARRAY(slot_t, table->mask + 1);
+    if (!table->slots)
+        return 0;
+    memset(table->slots, 0, (table->mask + 1) * sizeof(slot_t));
+    return 1;
+}
+
+
+static slot_t *table_find(table_t *table, uint32_t hash, qd_field_iterator_t *key)
+{
+    unsigned int idx = hash & table->mask;
+
+    while (table->slots[idx].item) {
+        slot_t *slot = &table->slots[idx];
+        if (slot->hash == hash && SLOT_LIVE(slot) && qd_field_iterator_equal(key, slot->item->key))
+            return slot;
+        idx = (idx + 1) & table->mask;
+    }
+
+    return 0;
+}
+
+
+static slot_t *table_find_item(table_t *table, qd_hash_item_t *item)
+{
+    unsigned int idx = item->hash & table->mask;
+
+    while (table->slots[idx].item) {
+        if (table->slots[idx].item == item)
+            return &table->slots[idx];
+        idx = (idx + 1) & table->mask;
+    }
+
+    return 0;
+}
+
+
+static void table_put(table_t *table, qd_hash_item_t *item)
+{
+    unsigned int idx = item->hash & table->mask;
+
+    while (SLOT_LIVE(&table->slots[idx]))
+        idx = (idx + 1) & table->mask;
+
+    table->slots[idx].hash = item->hash;
+    table->slots[idx].item = item;
+    table->used++;
+}
+
+
+//
+// Remove the item in a slot of the current table.  The items after it in its run are shifted
+// back so that no probe sequence is broken and no deleted markers are needed.
+//
+static void table_remove(table_t *table, slot_t *slot)
+{
+    unsigned int hole = slot - table->slots;
+    unsigned int idx  = (hole + 1) & table->mask;
+
+    while (table->slots[idx].item) {
+        unsigned int home = table->slots[idx].hash & table->mask;
+
+        //
+        // The item can fill the hole if the hole is cyclically between its home slot and
+        // where it is now.
+        //
+        if (((idx - home) & table->mask) >= ((idx - hole) & table->mask)) {
+            table->slots[hole] = table->slots[idx];
+            hole = idx;
+        }
+        idx = (idx + 1) & table->mask;
+    }
+
+    table->slots[hole].item = 0;
+    table->slots[hole].hash = 0;
+    table->used--;
+}
+
+
+//
+// Move some (or all) of the remaining items of the old table into the current table.
+//
+static void migrate(qd_hash_t *h, unsigned int count)
+{
+    while (h->old.slots && count--) {
+        slot_t *slot = &h->old.slots[h->migrated];
+        if (SLOT_LIVE(slot)) {
+            table_put(&h->table, slot->item);
+            slot->item = SLOT_DELETED;
+            h->old.used--;
+        }
+
+        if (++h->migrated > h->old.mask || h->old.used == 0) {
+            free(h->old.slots);
+            h->old.slots = 0;
+        }
+    }
+}
+
+
+//
+// Start growing the table if an insert would make it more than three quarters full.
+//
+static void grow(qd_hash_t *h)
+{
+    unsigned int capacity = h->table.mask + 1;
+    int          exponent = 0;
+
+    if ((h->table.used + 1) * 4 <= capacity * 3)
+        return;
+
+    migrate(h, (unsigned int) -1);
+
+    while ((1u << exponent) <= capacity)
+        exponent++;
+
+    table_t bigger;
+    if (!table_init(&bigger, exponent))
+        return;
+
+    h->old      = h->table;
+    h->table    = bigger;
+    h->migrated = 0;
+}
+
+
+static slot_t *find(qd_hash_t *h, uint32_t hash, qd_field_iterator_t *key, table_t **table)
+{
+    slot_t *slot = table_find(&h->table, hash, key);
+    *table = &h->table;
+
+    if (!slot && h->old.slots) {
+        slot   = table_find(&h->old, hash, key);
+        *table = &h->old;
+    }
+
+    return slot;
+}
+
+
+static void remove_slot(qd_hash_t *h, table_t *table, slot_t *slot)
+{
+    if (table == &h->old) {
+        slot->item = SLOT_DELETED;
+        h->old.used--;
+    } else
+        table_remove(table, slot);
+    h->size--;
+    migrate(h, MIGRATE_SLOTS);
+}
+
+
 qd_hash_t *qd_hash(int bucket_exponent, int batch_size, int value_is_const)
 {
-    int i;
     qd_hash_t *h = NEW(qd_hash_t);
 
     if (!h)
         return 0;
 
-    h->bucket_count = 1 << bucket_exponent;
-    h->bucket_mask  = h->bucket_count - 1;
-    h->batch_size   = batch_size;
-    h->size         = 0;
-    h->is_const     = value_is_const;
-    h->buckets = NEW_ARRAY(bucket_t, h->bucket_count);
-    for (i = 0; i < h->bucket_count; i++) {
-        DEQ_INIT(h->buckets[i].items);
+    if (bucket_exponent < MIN_EXPONENT)
+        bucket_exponent = MIN_EXPONENT;
+
+    h->old.slots  = 0;
+    h->migrated   = 0;
+    h->batch_size = batch_size;
+    h->size       = 0;
+    h->is_const   = value_is_const;
+    if (!table_init(&h->table, bucket_exponent)) {
+        free(h);
+        return 0;
     }
 
     return h;
 }
 
 
-void qd_hash_free(qd_hash_t *h)
+static void free_items(table_t *table)
 {
-    if (!h) return;
-    qd_hash_item_t *item;
-    int             idx;
-
-    for (idx = 0; idx < h->bucket_count; idx++) {
-        item = DEQ_HEAD(h->buckets[idx].items);
-        while (item) {
-            free(item->key);
-            DEQ_REMOVE_HEAD(h->buckets[idx].items);
-            free_qd_hash_item_t(item);
-            item = DEQ_HEAD(h->buckets[idx].items);
+    for (unsigned int idx = 0; idx <= table->mask; idx++) {
+        slot_t *slot = &table->slots[idx];
+        if (SLOT_LIVE(slot)) {
+            free(slot->item->key);
+            free_qd_hash_item_t(slot->item);
         }
     }
-    free(h->buckets);
+    free(table->slots);
+}
+
+
+void qd_hash_free(qd_hash_t *h)
+{
+    if (!h) return;
+
+    free_items(&h->table);
+    if (h->old.slots)
+        free_items(&h->old);
     free(h);
 }
 
@@ -113,40 +295,36 @@ size_t qd_hash_size(qd_hash_t *h)
 
 static qd_hash_item_t *qd_hash_internal_insert(qd_hash_t *h, qd_field_iterator_t *key, int *exists, qd_hash_handle_t **handle)
 {
-    unsigned long   idx  = qd_iterator_hash_function(key) & h->bucket_mask;
-    qd_hash_item_t *item = DEQ_HEAD(h->buckets[idx].items);
-
-    while (item) {
-        if (qd_field_iterator_equal(key, item->key))
-            break;
-        item = item->next;
-    }
+    uint32_t  hash = qd_iterator_hash_function(key);
+    table_t  *table;
+    slot_t   *slot = find(h, hash, key, &table);
 
-    if (item) {
+    if (slot) {
         *exists = 1;
         if (handle)
             *handle = 0;
-        return item;
+        return slot->item;
     }
 
-    item = new_qd_hash_item_t();
+    qd_hash_item_t *item = new_qd_hash_item_t();
     if (!item)
         return 0;
 
-    DEQ_ITEM_INIT(item);
-    item->key = qd_field_iterator_copy(key);
+    item->key  = qd_field_iterator_copy(key);
+    item->hash = hash;
 
-    DEQ_INSERT_TAIL(h->buckets[idx].items, item);
+    grow(h);
+    table_put(&h->table, item);
     h->size++;
     *exists = 0;
+    migrate(h, MIGRATE_SLOTS);
 
     //
     // If a pointer to a handle-pointer was supplied, create a handle for this item.
     //
     if (handle) {
         *handle = new_qd_hash_handle_t();
-        (*handle)->bucket = &h->buckets[idx];
-        (*handle)->item   = item;
+        (*handle)->item = item;
     }
 
     return item;
@@ -185,17 +363,10 @@ qd_error_t qd_hash_insert_const(qd_hash_t *h, qd_field_iterator_t *key, const vo
 
 static qd_hash_item_t *qd_hash_internal_retrieve_with_hash(qd_hash_t *h, uint32_t hash, qd_field_iterator_t *key)
 {
-    uint32_t   idx  = hash & h->bucket_mask;
+    table_t *table;
+    slot_t  *slot = find(h, hash, key, &table);
 
-	qd_hash_item_t *item = DEQ_HEAD(h->buckets[idx].items);
-
-	while (item) {
-		if (qd_field_iterator_equal(key, item->key))
-			break;
-		item = item->next;
-	}
-
-	return item;
+    return slot ? slot->item : 0;
 }
 
 
@@ -276,20 +447,14 @@ qd_error_t qd_hash_retrieve_const(qd_hash_t *h, qd_field_iterator_t *key, const
 
 qd_error_t qd_hash_remove(qd_hash_t *h, qd_field_iterator_t *key)
 {
-    uint32_t   idx  = qd_iterator_hash_function(key) & h->bucket_mask;
-    qd_hash_item_t *item = DEQ_HEAD(h->buckets[idx].items);
+    table_t *table;
+    slot_t  *slot = find(h, qd_iterator_hash_function(key), key, &table);
 
-    while (item) {
-        if (qd_field_iterator_equal(key, item->key))
-            break;
-        item = item->next;
-    }
-
-    if (item) {
+    if (slot) {
+        qd_hash_item_t *item = slot->item;
+        remove_slot(h, table, slot);
         free(item->key);
-        DEQ_REMOVE(h->buckets[idx].items, item);
         free_qd_hash_item_t(item);
-        h->size--;
         return QD_ERROR_NONE;
     }
 
@@ -326,9 +491,18 @@ qd_error_t qd_hash_remove_by_handle2(qd_hash_t *h, qd_hash_handle_t *handle, uns
 {
     if (!handle)
         return QD_ERROR_NOT_FOUND;
+
+    table_t *table = &h->table;
+    slot_t  *slot  = table_find_item(table, handle->item);
+    if (!slot && h->old.slots) {
+        table = &h->old;
+        slot  = table_find_item(table, handle->item);
+    }
+    assert(slot);
+
     *key = handle->item->key;
-    DEQ_REMOVE(handle->bucket->items, handle->item);
+    if (slot)
+        remove_slot(h, table, slot);
     free_qd_hash_item_t(handle->item);
-    h->size--;
     return QD_ERROR_NONE;
 }
@@ -487,9 +487,8 @@ int qd_field_iterator_end(const qd_field_iterator_t *iter)
 }
 
 
-qd_field_iterator_t *qd_field_iterator_sub(const qd_field_iterator_t *iter, uint32_t length)
+static qd_field_iterator_t *field_iterator_sub_init(qd_field_iterator_t *sub, const qd_field_iterator_t *iter, uint32_t length)
 {
-    qd_field_iterator_t *sub = new_qd_field_iterator_t();
     if (!sub)
         return 0;
 
@@ -510,6 +509,18 @@ qd_field_iterator_t *qd_field_iterator_sub(const qd_field_iterator_t *iter, uint
 }
 
 
+qd_field_iterator_t *qd_field_iterator_sub(const qd_field_iterator_t *iter, uint32_t length)
+{
+    return field_iterator_sub_init(new_qd_field_iterator_t(), iter, length);
+}
+
+
+qd_field_iterator_t *qd_field_iterator_sub_arena(const qd_field_iterator_t *iter, uint32_t length, qd_arena_t *arena)
+{
+    return field_iterator_sub_init((qd_field_iterator_t*) qd_arena_alloc(arena, sizeof(qd_field_iterator_t)), iter, length);
+}
+
+
 void qd_field_iterator_advance(qd_field_iterator_t *iter, uint32_t length)
 {
     while (length > 0 && !qd_field_iterator_end(iter)) {
@@ -588,6 +599,70 @@ int qd_field_iterator_ncopy(qd_field_iterator_t *iter, unsigned char* buffer, in
 }
 
 
+//
+// Step over the next run of up to limit octets of the view that are contiguous in memory and
+// return a pointer to them.  Prefix and phase octets synthesized by an address view are
+// returned one at a time from scratch.  Returns zero at the end of the view.
+//
+static uint32_t field_iterator_next_span(qd_field_iterator_t *iter, const unsigned char **span,
+                                         uint32_t limit, unsigned char *scratch)
+{
+    if (qd_field_iterator_end(iter))
+        return 0;
+
+    if (iter->state != STATE_IN_ADDRESS) {
+        *scratch = qd_field_iterator_octet(iter);
+        *span    = scratch;
+        return 1;
+    }
+
+    uint32_t chunk = iter->pointer.length;
+    if (iter->pointer.buffer) {
+        uint32_t in_buffer = qd_buffer_cursor(iter->pointer.buffer) - iter->pointer.cursor;
+        if (chunk > in_buffer)
+            chunk = in_buffer;
+    }
+    if (chunk > limit)
+        chunk = limit;
+    if (chunk == 0)
+        return 0;
+
+    //
+    // A slash-terminated view ends before the next slash after the first octet.
+    //
+    if (iter->mode == MODE_TO_SLASH && chunk > 1) {
+        const unsigned char *slash = memchr(iter->pointer.cursor + 1, '/', chunk - 1);
+        if (slash)
+            chunk = slash - iter->pointer.cursor;
+    }
+
+    *span = iter->pointer.cursor;
+    field_iterator_move_cursor(iter, chunk);
+    if (iter->pointer.length && iter->mode == MODE_TO_SLASH && *(iter->pointer.cursor) == '/')
+        iter->pointer.length = 0;
+
+    return chunk;
+}
+
+
+uint32_t qd_field_iterator_read(qd_field_iterator_t *iter, unsigned char *buffer, uint32_t n)
+{
+    const unsigned char *span;
+    unsigned char        scratch;
+    uint32_t             copied = 0;
+
+    while (copied < n) {
+        uint32_t chunk = field_iterator_next_span(iter, &span, n - copied, &scratch);
+        if (chunk == 0)
+            break;
+        memcpy(buffer + copied, span, chunk);
+        copied += chunk;
+    }
+
+    return copied;
+}
+
+
 char* qd_field_iterator_strncpy(qd_field_iterator_t *iter, char* buffer, int n) {
     int i = qd_field_iterator_ncopy(iter, (unsigned char*)buffer, n-1);
     buffer[i] = '\0';
@@ -617,6 +692,18 @@ qd_field_iterator_t *qd_field_iterator_dup(const qd_field_iterator_t *iter)
 }
 
 
+qd_field_iterator_t *qd_field_iterator_dup_arena(const qd_field_iterator_t *iter, qd_arena_t *arena)
+{
+    if (iter == 0)
+        return 0;
+
+    qd_field_iterator_t *dup = (qd_field_iterator_t*) qd_arena_alloc(arena, sizeof(qd_field_iterator_t));
+    if (dup)
+        *dup = *iter;
+    return dup;
+}
+
+
 qd_iovec_t *qd_field_iterator_iovec(const qd_field_iterator_t *iter)
 {
     assert(!iter->view_prefix); // Not supported for views with a prefix
@@ -672,15 +759,110 @@ qd_iovec_t *qd_field_iterator_iovec(const qd_field_iterator_t *iter)
 }
 
 
+//
+// Addresses are hashed eight octets at a time over the contiguous spans of the view, so the
+// cost per octet is a fraction of a byte-wise hash that goes through the iterator for every
+// octet.  Octets are packed into words in little-endian order whichever way the spans fall,
+// so the same address always hashes the same wherever its buffer boundaries are.  The state
+// can be finished at any point, which gives the hash of every prefix of the address as it
+// streams past; qd_iterator_hash_segments relies on that.
+//
+#define HASH_K1 0x9E3779B97F4A7C15ULL
+#define HASH_K2 0xC2B2AE3D27D4EB4FULL
+
+typedef struct {
+    uint64_t h;
+    uint64_t pending;     // octets not yet making up a whole word
+    uint32_t npending;
+    uint32_t length;
+} hash_state_t;
+
+
+static inline uint64_t hash_rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+
+static inline void hash_word(hash_state_t *st, uint64_t w)
+{
+    st->h = hash_rotl(st->h ^ (w * HASH_K1), 29) * HASH_K2;
+}
+
+
+static inline uint64_t hash_load(const unsigned char *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    return w;
+}
+
+
+static inline void hash_start(hash_state_t *st)
+{
+    st->h        = HASH_INIT;
+    st->pending  = 0;
+    st->npending = 0;
+    st->length   = 0;
+}
+
+
+static void hash_update(hash_state_t *st, const unsigned char *p, uint32_t len)
+{
+    st->length += len;
+
+    while (st->npending && len) {
+        st->pending |= ((uint64_t) *p++) << (8 * st->npending);
+        len--;
+        if (++st->npending == 8) {
+            hash_word(st, st->pending);
+            st->pending  = 0;
+            st->npending = 0;
+        }
+    }
+
+    while (len >= 8) {
+        hash_word(st, hash_load(p));
+        p   += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        st->pending |= ((uint64_t) *p++) << (8 * st->npending);
+        st->npending++;
+    }
+}
+
+
+static uint32_t hash_final(const hash_state_t *st)
+{
+    uint64_t h = st->h ^ ((st->pending ^ st->length) * HASH_K2);
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return (uint32_t) (h ^ (h >> 32));
+}
+
+
 uint32_t qd_iterator_hash_function(qd_field_iterator_t *iter)
 {
-    uint32_t hash = HASH_INIT;
+    const unsigned char *span;
+    unsigned char        scratch;
+    uint32_t             chunk;
+    hash_state_t         st;
 
+    hash_start(&st);
     qd_field_iterator_reset(iter);
-    while (!qd_field_iterator_end(iter))
-        hash = ((hash << 5) + hash) + (int) qd_field_iterator_octet(iter); /* hash * 33 + c */
+    while ((chunk = field_iterator_next_span(iter, &span, UINT32_MAX, &scratch)) > 0)
+        hash_update(&st, span, chunk);
 
-    return hash;
+    return hash_final(&st);
 }
 
 
@@ -714,27 +896,37 @@ static void qd_insert_hash_segment(qd_field_iterator_t *iter, uint32_t *hash, in
 
 void qd_iterator_hash_segments(qd_field_iterator_t *iter)
 {
+    const unsigned char *span;
+    unsigned char        scratch;
+    uint32_t             chunk;
+    hash_state_t         st;
+
     // Reset the pointers in the iterator
     qd_field_iterator_reset(iter);
-    uint32_t hash = HASH_INIT;
-    char octet;
-    int segment_length=0;
+    hash_start(&st);
 
-    while (!qd_field_iterator_end(iter)) {
-        // Get the octet at which the iterator is currently pointing to.
-        octet = qd_field_iterator_octet(iter);
-        segment_length += 1;
-
-        if (octet == SEPARATOR) {
-            qd_insert_hash_segment(iter, &hash, segment_length-1);
+    while ((chunk = field_iterator_next_span(iter, &span, UINT32_MAX, &scratch)) > 0) {
+        //
+        // Record the hash of everything before each separator.  Don't include the separator
+        // in the segment but do include it in the overall hash.
+        //
+        const unsigned char *sep;
+        while ((sep = memchr(span, SEPARATOR, chunk)) != 0) {
+            uint32_t before = sep - span;
+            hash_update(&st, span, before);
+            uint32_t hash = hash_final(&st);
+            qd_insert_hash_segment(iter, &hash, st.length);
+            hash_update(&st, sep, 1);
+            span  += before + 1;
+            chunk -= before + 1;
         }
-
-        hash = ((hash << 5) + hash) + octet; /* hash * 33 + c */
+        hash_update(&st, span, chunk);
     }
 
     // Segments should never end with a separator. see view_initialize which in turn calls qd_address_iterator_check_trailing_octet
     // Insert the last segment which was not inserted in the previous while loop
-    qd_insert_hash_segment(iter, &hash, segment_length);
+    uint32_t hash = hash_final(&st);
+    qd_insert_hash_segment(iter, &hash, st.length);
 
     // Return the pointers in the iterator back to the original state before returning from this function.
     qd_field_iterator_reset(iter);
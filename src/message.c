@@ -61,11 +61,41 @@ PN_HANDLE(PN_DELIVERY_CTX);
 
 ALLOC_DEFINE_CONFIG(qd_message_t, sizeof(qd_message_pvt_t), 0, 0);
 ALLOC_DEFINE(qd_message_content_t);
+ALLOC_DEFINE(qd_message_stream_t);
+ALLOC_DEFINE(qd_message_annotations_t);
 
 typedef void (*buffer_process_t) (void *context, const unsigned char *base, int length);
 
 static qd_log_source_t* log_source = 0;
 
+//
+// The content lock only guards content that is still changing: data arriving for a message
+// being cut through, lazy parsing and the shared annotation encoding.  Those critical
+// sections are short and never nest, so contents share a fixed set of locks, chosen by
+// address, rather than each creating and destroying a mutex of its own.  A lock is created
+// the first time its slot is used.
+//
+#define CONTENT_LOCK_BITS 6
+
+static sys_mutex_t *content_locks[1 << CONTENT_LOCK_BITS];
+
+static sys_mutex_t *content_lock(const qd_message_content_t *content)
+{
+    uint32_t     slot = ((uint32_t) ((uintptr_t) content >> 4) * 2654435761u) >> (32 - CONTENT_LOCK_BITS);
+    sys_mutex_t *lock = __atomic_load_n(&content_locks[slot], __ATOMIC_ACQUIRE);
+
+    if (!lock) {
+        sys_mutex_t *fresh = sys_mutex();
+        if (__atomic_compare_exchange_n(&content_locks[slot], &lock, fresh, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            lock = fresh;
+        else
+            sys_mutex_free(fresh);
+    }
+
+    return lock;
+}
+
 void qd_message_initialize() {
     log_source = qd_log_source("MESSAGE");
 }
@@ -111,7 +141,8 @@ char* qd_message_repr(qd_message_t *msg, char* buffer, size_t len) {
         copy_field(msg, QD_FIELD_REPLY_TO, INT_MAX, " reply-to='", "'", &begin, end);
         copy_field(msg, QD_FIELD_BODY, 16, " body='", "'", &begin, end);
         aprintf(&begin, end, "%s", REPR_END);   /* We saved space at the beginning. */
-    }
+    } else if (len > 0)
+        buffer[0] = '\0';
     return buffer;
 }
 
@@ -548,10 +579,8 @@ qd_message_t *qd_message()
         return 0;
 
     DEQ_ITEM_INIT(msg);
-    DEQ_INIT(msg->ma_to_override);
-    DEQ_INIT(msg->ma_trace);
-    DEQ_INIT(msg->ma_ingress);
-    msg->ma_phase = 0;
+    msg->ma          = 0;
+    msg->cut_through = false;
     msg->content = new_qd_message_content_t();
 
     if (msg->content == 0) {
@@ -560,8 +589,9 @@ qd_message_t *qd_message()
     }
 
     memset(msg->content, 0, sizeof(qd_message_content_t));
-    msg->content->lock        = sys_mutex();
+    msg->content->lock        = content_lock(msg->content);
     msg->content->ref_count   = 1;
+    msg->content->receive_complete = true;
     msg->content->parse_depth = QD_DEPTH_NONE;
     msg->content->parsed_message_annotations = 0;
 
@@ -569,23 +599,77 @@ qd_message_t *qd_message()
 }
 
 
+//
+// Drop the message's reference to its annotations.  This is done when the message is freed.
+//
+static void ma_release(qd_message_pvt_t *msg)
+{
+    qd_message_annotations_t *ma = msg->ma;
+
+    if (!ma)
+        return;
+
+    if (__atomic_sub_fetch(&ma->ref_count, 1, __ATOMIC_ACQ_REL) == 0) {
+        qd_buffer_list_free_buffers(&ma->to_override);
+        qd_buffer_list_free_buffers(&ma->trace);
+        qd_buffer_list_free_buffers(&ma->ingress);
+        qd_buffer_list_free_buffers(&ma->buffers);
+        free_qd_message_annotations_t(ma);
+    }
+
+    msg->ma = 0;
+}
+
+
+//
+// Get annotations that the message may change.  If the annotations are shared with copies of the
+// message, the message gets its own copy of them first.  Any encoding of the old annotations is
+// discarded either way.
+//
+static qd_message_annotations_t *ma_writable(qd_message_pvt_t *msg)
+{
+    qd_message_annotations_t *ma = msg->ma;
+
+    if (ma && __atomic_load_n(&ma->ref_count, __ATOMIC_ACQUIRE) == 1) {
+        qd_buffer_list_free_buffers(&ma->buffers);
+        ma->encoded = false;
+        return ma;
+    }
+
+    qd_message_annotations_t *own = new_qd_message_annotations_t();
+    if (!own)
+        return 0;
+
+    own->ref_count = 1;
+    own->phase     = ma ? ma->phase : 0;
+    own->encoded   = false;
+    DEQ_INIT(own->to_override);
+    DEQ_INIT(own->trace);
+    DEQ_INIT(own->ingress);
+    DEQ_INIT(own->buffers);
+
+    if (ma) {
+        qd_buffer_list_clone(&own->to_override, &ma->to_override);
+        qd_buffer_list_clone(&own->trace, &ma->trace);
+        qd_buffer_list_clone(&own->ingress, &ma->ingress);
+        ma_release(msg);
+    }
+
+    msg->ma = own;
+    return own;
+}
+
+
 void qd_message_free(qd_message_t *in_msg)
 {
     if (!in_msg) return;
-    uint32_t rc;
     qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
 
-    qd_buffer_list_free_buffers(&msg->ma_to_override);
-    qd_buffer_list_free_buffers(&msg->ma_trace);
-    qd_buffer_list_free_buffers(&msg->ma_ingress);
+    ma_release(msg);
 
     qd_message_content_t *content = msg->content;
 
-    sys_mutex_lock(content->lock);
-    rc = --content->ref_count;
-    sys_mutex_unlock(content->lock);
-
-    if (rc == 0) {
+    if (__atomic_sub_fetch(&content->ref_count, 1, __ATOMIC_ACQ_REL) == 0) {
         if (content->parsed_message_annotations)
             qd_parse_free(content->parsed_message_annotations);
 
@@ -596,7 +680,6 @@ void qd_message_free(qd_message_t *in_msg)
             buf = DEQ_HEAD(content->buffers);
         }
 
-        sys_mutex_free(content->lock);
         free_qd_message_content_t(content);
     }
 
@@ -614,16 +697,17 @@ qd_message_t *qd_message_copy(qd_message_t *in_msg)
         return 0;
 
     DEQ_ITEM_INIT(copy);
-    qd_buffer_list_clone(&copy->ma_to_override, &msg->ma_to_override);
-    qd_buffer_list_clone(&copy->ma_trace, &msg->ma_trace);
-    qd_buffer_list_clone(&copy->ma_ingress, &msg->ma_ingress);
-    copy->ma_phase = msg->ma_phase;
+    copy->cut_through = false;
+    copy->content     = content;
 
-    copy->content = content;
+    //
+    // The copy shares the annotations of the message until one of them changes its own.
+    //
+    copy->ma = msg->ma;
+    if (copy->ma)
+        __atomic_fetch_add(&copy->ma->ref_count, 1, __ATOMIC_RELAXED);
 
-    sys_mutex_lock(content->lock);
-    content->ref_count++;
-    sys_mutex_unlock(content->lock);
+    __atomic_fetch_add(&content->ref_count, 1, __ATOMIC_RELAXED);
 
     return (qd_message_t*) copy;
 }
@@ -658,37 +742,48 @@ qd_parsed_field_t *qd_message_message_annotations(qd_message_t *in_msg)
 
 void qd_message_set_trace_annotation(qd_message_t *in_msg, qd_composed_field_t *trace_field)
 {
-    qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    qd_buffer_list_free_buffers(&msg->ma_trace);
-    qd_compose_take_buffers(trace_field, &msg->ma_trace);
+    qd_message_annotations_t *ma = ma_writable((qd_message_pvt_t*) in_msg);
+    if (ma) {
+        qd_buffer_list_free_buffers(&ma->trace);
+        qd_compose_take_buffers(trace_field, &ma->trace);
+    }
     qd_compose_free(trace_field);
 }
 
 void qd_message_set_to_override_annotation(qd_message_t *in_msg, qd_composed_field_t *to_field)
 {
-    qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    qd_buffer_list_free_buffers(&msg->ma_to_override);
-    qd_compose_take_buffers(to_field, &msg->ma_to_override);
+    qd_message_annotations_t *ma = ma_writable((qd_message_pvt_t*) in_msg);
+    if (ma) {
+        qd_buffer_list_free_buffers(&ma->to_override);
+        qd_compose_take_buffers(to_field, &ma->to_override);
+    }
     qd_compose_free(to_field);
 }
 
 void qd_message_set_phase_annotation(qd_message_t *in_msg, int phase)
 {
     qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    msg->ma_phase = phase;
+    if (qd_message_get_phase_annotation(in_msg) == phase)
+        return;
+
+    qd_message_annotations_t *ma = ma_writable(msg);
+    if (ma)
+        ma->phase = phase;
 }
 
 int qd_message_get_phase_annotation(const qd_message_t *in_msg)
 {
     qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    return msg->ma_phase;
+    return msg->ma ? msg->ma->phase : 0;
 }
 
 void qd_message_set_ingress_annotation(qd_message_t *in_msg, qd_composed_field_t *ingress_field)
 {
-    qd_message_pvt_t *msg = (qd_message_pvt_t*) in_msg;
-    qd_buffer_list_free_buffers(&msg->ma_ingress);
-    qd_compose_take_buffers(ingress_field, &msg->ma_ingress);
+    qd_message_annotations_t *ma = ma_writable((qd_message_pvt_t*) in_msg);
+    if (ma) {
+        qd_buffer_list_free_buffers(&ma->ingress);
+        qd_compose_take_buffers(ingress_field, &ma->ingress);
+    }
     qd_compose_free(ingress_field);
 }
 
@@ -708,80 +803,156 @@ qd_message_t *qd_message_receive(pn_delivery_t *delivery)
     //
     if (!msg) {
         msg = (qd_message_pvt_t*) qd_message();
+        msg->content->receive_complete = false;
         pn_record_def(record, PN_DELIVERY_CTX, PN_WEAKREF);
         pn_record_set(record, PN_DELIVERY_CTX, (void*) msg);
     }
 
+    qd_message_content_t *content = msg->content;
+
     //
-    // Get a reference to the tail buffer on the message.  This is the buffer into which
-    // we will store incoming message data.  If there is no buffer in the message, allocate
-    // an empty one and add it to the message.
+    // The message may already be in the hands of other threads that are reading the
+    // published buffers.  New data is stored where no reader will look for it:  in the
+    // unused space of the tail buffer (beyond its published size) and in a local list of
+    // new buffers.  Only this thread ever adds to the buffer chain, so the tail may be
+    // examined without the lock.
     //
-    buf = DEQ_TAIL(msg->content->buffers);
-    if (!buf) {
-        buf = qd_buffer();
-        DEQ_INSERT_TAIL(msg->content->buffers, buf);
-    }
+    qd_buffer_t      *tail        = DEQ_TAIL(content->buffers);
+    size_t            tail_octets = 0;
+    qd_buffer_list_t  received;
+    bool              eos         = false;
+
+    DEQ_INIT(received);
 
     while (1) {
         //
-        // Try to receive enough data to fill the remaining space in the tail buffer.
+        // Try to receive enough data to fill the remaining space in the current buffer.
         //
-        rc = pn_link_recv(link, (char*) qd_buffer_cursor(buf), qd_buffer_capacity(buf));
+        if (tail && qd_buffer_capacity(tail) > tail_octets) {
+            buf = 0;
+            rc  = pn_link_recv(link, (char*) qd_buffer_cursor(tail) + tail_octets,
+                               qd_buffer_capacity(tail) - tail_octets);
+        } else {
+            //
+            // Size the new buffer to the data that is waiting, so that a small message fits
+            // in a small buffer and a large one is not spread over a long chain.
+            //
+            buf = DEQ_TAIL(received);
+            if (!buf || qd_buffer_capacity(buf) == 0) {
+                buf = qd_buffer_sized(pn_delivery_pending(delivery));
+                DEQ_INSERT_TAIL(received, buf);
+            }
+            rc = pn_link_recv(link, (char*) qd_buffer_cursor(buf), qd_buffer_capacity(buf));
+        }
 
         //
         // If we receive PN_EOS, we have come to the end of the message.
         //
         if (rc == PN_EOS) {
-            //
-            // Clear the value in the record with key PN_DELIVERY_CTX
-            //
-            pn_record_set(record, PN_DELIVERY_CTX, 0);
+            eos = true;
+            break;
+        }
 
-            //
-            // If the last buffer in the list is empty, remove it and free it.  This
-            // will only happen if the size of the message content is an exact multiple
-            // of the buffer size.
-            //
+        //
+        // We received zero bytes, and no PN_EOS.  This means that we've received
+        // all of the data available up to this point, but it does not constitute
+        // the entire message.  We'll be back later to finish it up.
+        //
+        if (rc <= 0)
+            break;
 
-            if (qd_buffer_size(buf) == 0) {
-                DEQ_REMOVE_TAIL(msg->content->buffers);
-                qd_buffer_free(buf);
-            }
+        if (buf)
+            qd_buffer_insert(buf, rc);
+        else
+            tail_octets += rc;
+    }
+
+    //
+    // If the last new buffer is empty, remove it and free it.  This will only happen if
+    // the amount of data received is an exact multiple of the buffer size.
+    //
+    buf = DEQ_TAIL(received);
+    if (buf && qd_buffer_size(buf) == 0) {
+        DEQ_REMOVE_TAIL(received);
+        qd_buffer_free(buf);
+    }
 
-            char repr[qd_message_repr_len()];
-            qd_log(log_source, QD_LOG_TRACE, "Received %s on link %s",
-                   qd_message_repr((qd_message_t*)msg, repr, sizeof(repr)),
-                   pn_link_name(link));
+    bool progress = tail_octets > 0 || !DEQ_IS_EMPTY(received);
 
-            return (qd_message_t*) msg;
-        }
+    //
+    // Publish the new data to the readers of the message.
+    //
+    if (progress || eos) {
+        sys_mutex_lock(content->lock);
+        if (tail_octets > 0)
+            qd_buffer_insert(tail, tail_octets);
+        DEQ_APPEND(content->buffers, received);
+        if (eos)
+            content->receive_complete = true;
+        sys_mutex_unlock(content->lock);
+    }
 
-        if (rc > 0) {
-            //
-            // We have received a positive number of bytes for the message.  Advance
-            // the cursor in the buffer.
-            //
-            qd_buffer_insert(buf, rc);
+    if (eos) {
+        //
+        // Clear the value in the record with key PN_DELIVERY_CTX
+        //
+        pn_record_set(record, PN_DELIVERY_CTX, 0);
 
-            //
-            // If the buffer is full, allocate a new empty buffer and append it to the
-            // tail of the message's list.
-            //
-            if (qd_buffer_capacity(buf) == 0) {
-                buf = qd_buffer();
-                DEQ_INSERT_TAIL(msg->content->buffers, buf);
-            }
-        } else
-            //
-            // We received zero bytes, and no PN_EOS.  This means that we've received
-            // all of the data available up to this point, but it does not constitute
-            // the entire message.  We'll be back later to finish it up.
-            //
-            break;
+        char repr[qd_message_repr_len()];
+        qd_log(log_source, QD_LOG_TRACE, "Received %s on link %s",
+               qd_message_repr((qd_message_t*)msg, repr, sizeof(repr)),
+               pn_link_name(link));
     }
 
-    return 0;
+    return progress || eos ? (qd_message_t*) msg : 0;
+}
+
+
+void qd_message_receive_cancel(pn_delivery_t *delivery)
+{
+    pn_record_t      *record = pn_delivery_attachments(delivery);
+    qd_message_pvt_t *msg    = (qd_message_pvt_t*) pn_record_get(record, PN_DELIVERY_CTX);
+
+    if (!msg)
+        return;
+
+    pn_record_set(record, PN_DELIVERY_CTX, 0);
+
+    //
+    // Whatever has been received is all there will ever be.
+    //
+    sys_mutex_lock(msg->content->lock);
+    msg->content->receive_complete = true;
+    sys_mutex_unlock(msg->content->lock);
+
+    qd_log(log_source, QD_LOG_DEBUG, "Abandoned partially received message on link %s",
+           pn_link_name(pn_delivery_link(delivery)));
+
+    qd_message_free((qd_message_t*) msg);
+}
+
+
+bool qd_message_receive_complete(qd_message_t *in_msg)
+{
+    qd_message_content_t *content = MSG_CONTENT(in_msg);
+    bool                  complete;
+
+    sys_mutex_lock(content->lock);
+    complete = content->receive_complete;
+    sys_mutex_unlock(content->lock);
+    return complete;
+}
+
+
+void qd_message_set_cut_through(qd_message_t *in_msg, bool cut_through)
+{
+    ((qd_message_pvt_t*) in_msg)->cut_through = cut_through;
+}
+
+
+bool qd_message_is_cut_through(const qd_message_t *in_msg)
+{
+    return ((const qd_message_pvt_t*) in_msg)->cut_through;
 }
 
 
@@ -791,34 +962,46 @@ static void send_handler(void *context, const unsigned char *start, int length)
     pn_link_send(pnl, (const char*) start, length);
 }
 
+//
+// Insert a copy of a buffer list into a composed field.  The list may be shared with copies of
+// the message, so it is left as it is.
+//
+static void compose_insert_clone(qd_composed_field_t *field, const qd_buffer_list_t *list)
+{
+    qd_buffer_list_t clone;
+    DEQ_INIT(clone);
+    qd_buffer_list_clone(&clone, list);
+    qd_compose_insert_buffers(field, &clone);
+}
+
 // create a buffer chain holding the outgoing message annotations section
-static bool compose_message_annotations(qd_message_pvt_t *msg, qd_buffer_list_t *out)
+static bool compose_message_annotations(qd_message_annotations_t *ma, qd_buffer_list_t *out)
 {
-    if (!DEQ_IS_EMPTY(msg->ma_to_override) ||
-        !DEQ_IS_EMPTY(msg->ma_trace) ||
-        !DEQ_IS_EMPTY(msg->ma_ingress)) {
+    if (!DEQ_IS_EMPTY(ma->to_override) ||
+        !DEQ_IS_EMPTY(ma->trace) ||
+        !DEQ_IS_EMPTY(ma->ingress)) {
 
         qd_composed_field_t *out_ma = qd_compose(QD_PERFORMATIVE_MESSAGE_ANNOTATIONS, 0);
         qd_compose_start_map(out_ma);
 
-        if (!DEQ_IS_EMPTY(msg->ma_to_override)) {
+        if (!DEQ_IS_EMPTY(ma->to_override)) {
             qd_compose_insert_symbol(out_ma, QD_MA_TO);
-            qd_compose_insert_buffers(out_ma, &msg->ma_to_override);
+            compose_insert_clone(out_ma, &ma->to_override);
         }
 
-        if (!DEQ_IS_EMPTY(msg->ma_trace)) {
+        if (!DEQ_IS_EMPTY(ma->trace)) {
             qd_compose_insert_symbol(out_ma, QD_MA_TRACE);
-            qd_compose_insert_buffers(out_ma, &msg->ma_trace);
+            compose_insert_clone(out_ma, &ma->trace);
         }
 
-        if (!DEQ_IS_EMPTY(msg->ma_ingress)) {
+        if (!DEQ_IS_EMPTY(ma->ingress)) {
             qd_compose_insert_symbol(out_ma, QD_MA_INGRESS);
-            qd_compose_insert_buffers(out_ma, &msg->ma_ingress);
+            compose_insert_clone(out_ma, &ma->ingress);
         }
 
-        if (msg->ma_phase != 0) {
+        if (ma->phase != 0) {
             qd_compose_insert_symbol(out_ma, QD_MA_PHASE);
-            qd_compose_insert_int(out_ma, msg->ma_phase);
+            qd_compose_insert_int(out_ma, ma->phase);
         }
 
         qd_compose_end_map(out_ma);
@@ -831,124 +1014,330 @@ static bool compose_message_annotations(qd_message_pvt_t *msg, qd_buffer_list_t
     return false;
 }
 
-void qd_message_send(qd_message_t *in_msg,
+qd_buffer_list_t *qd_message_outbound_annotations(qd_message_t *in_msg, qd_buffer_list_t *local)
+{
+    qd_message_pvt_t         *msg     = (qd_message_pvt_t*) in_msg;
+    qd_message_annotations_t *ma      = msg->ma;
+    qd_message_content_t     *content = msg->content;
+    bool                      encoded = false;
+
+    if (!ma)
+        return 0;
+
+    sys_mutex_lock(content->lock);
+    encoded = ma->encoded;
+    sys_mutex_unlock(content->lock);
+    if (encoded)
+        return &ma->buffers;
+
+    if (!compose_message_annotations(ma, local))
+        return 0;
+
+    //
+    // Share the encoding with the copies, unless another copy got there first.
+    //
+    sys_mutex_lock(content->lock);
+    if (!ma->encoded) {
+        DEQ_MOVE(*local, ma->buffers);
+        ma->encoded = true;
+        encoded     = true;
+    }
+    sys_mutex_unlock(content->lock);
+    if (encoded)
+        return &ma->buffers;
+
+    return local;
+}
+
+
+//
+// Send the part of the message that has been published since the last call.  Each buffer's
+// run of octets goes to the link directly; Proton copies it into the delivery and has no
+// vectored send that gathering the runs first could feed.  Return true iff the whole message
+// has now been sent.
+//
+static bool send_published(qd_message_stream_t *stream, pn_link_t *pnl)
+{
+    qd_message_content_t *content = MSG_CONTENT(stream->msg);
+
+    //
+    // Take a snapshot of how much of the message has been received.  Buffers ahead of the
+    // tail and the octets within the tail's size won't change after this point.
+    //
+    sys_mutex_lock(content->lock);
+    qd_buffer_t *tail      = DEQ_TAIL(content->buffers);
+    size_t       tail_size = tail ? qd_buffer_size(tail) : 0;
+    bool         complete  = content->receive_complete;
+    sys_mutex_unlock(content->lock);
+
+    qd_buffer_t   *buf    = stream->buffer;
+    unsigned char *cursor = stream->cursor;
+
+    while (buf) {
+        unsigned char *end = qd_buffer_base(buf) + (buf == tail ? tail_size : qd_buffer_size(buf));
+        if (cursor < end) {
+            pn_link_send(pnl, (const char*) cursor, end - cursor);
+            cursor = end;
+        }
+
+        if (buf == tail)
+            break;
+
+        buf = DEQ_NEXT(buf);
+        if (buf)
+            cursor = qd_buffer_base(buf);
+    }
+
+    stream->buffer = buf;
+    stream->cursor = cursor;
+    return complete;
+}
+
+
+static bool send_message(qd_message_stream_t *stream, pn_link_t *pnl)
+{
+    qd_message_pvt_t     *msg     = (qd_message_pvt_t*) stream->msg;
+    qd_message_content_t *content = msg->content;
+    qd_buffer_list_t     *new_ma  = 0;
+    qd_buffer_list_t      local_ma;
+
+    DEQ_INIT(local_ma);
+
+    if (!stream->started) {
+        qd_buffer_t   *buf;
+        unsigned char *cursor;
+
+        sys_mutex_lock(content->lock);
+        buf = DEQ_HEAD(content->buffers);
+        sys_mutex_unlock(content->lock);
+
+        new_ma = qd_message_outbound_annotations(stream->msg, &local_ma);
+        if (stream->strip || new_ma) {
+            //
+            // This is the case where the message annotations have been modified.
+            // The message send must be divided into sections:  The existing header;
+            // the new message annotations; the rest of the existing message.
+            // Note that the original message annotations that are still in the
+            // buffer chain must not be sent.
+            //
+            // Start by making sure that we've parsed the message sections through
+            // the message annotations.  If they haven't all arrived yet, wait for them.
+            //
+            qd_message_depth_status_t status = qd_message_check_depth(stream->msg, QD_DEPTH_MESSAGE_ANNOTATIONS);
+            if (status != QD_MESSAGE_DEPTH_OK) {
+                qd_buffer_list_free_buffers(&local_ma);
+                if (status == QD_MESSAGE_DEPTH_INCOMPLETE)
+                    return false;
+                qd_log(log_source, QD_LOG_ERROR, "Cannot send: %s", qd_error_message());
+                return true;
+            }
+
+            //
+            // Send header if present
+            //
+            cursor = qd_buffer_base(buf);
+            if (content->section_message_header.length > 0) {
+                buf    = content->section_message_header.buffer;
+                cursor = content->section_message_header.offset + qd_buffer_base(buf);
+                advance(&cursor, &buf,
+                        content->section_message_header.length + content->section_message_header.hdr_length,
+                        send_handler, (void*) pnl);
+            }
+
+            //
+            // Send new message annotations
+            //
+            qd_buffer_t *da_buf = new_ma ? DEQ_HEAD(*new_ma) : 0;
+            while (da_buf) {
+                pn_link_send(pnl, (char*) qd_buffer_base(da_buf), qd_buffer_size(da_buf));
+                da_buf = DEQ_NEXT(da_buf);
+            }
+            qd_buffer_list_free_buffers(&local_ma);
+
+            //
+            // Skip over replaced message annotations
+            //
+            if (content->section_message_annotation.length > 0)
+                advance(&cursor, &buf,
+                        content->section_message_annotation.hdr_length + content->section_message_annotation.length,
+                        0, 0);
+        } else
+            cursor = buf ? qd_buffer_base(buf) : 0;
+
+        //
+        // The rest of the message is sent as-is from here on.
+        //
+        stream->started = true;
+        stream->buffer  = buf;
+        stream->cursor  = cursor;
+    }
+
+    return send_published(stream, pnl);
+}
+
+
+bool qd_message_send(qd_message_t *in_msg,
                      qd_link_t    *link,
                      bool          strip_annotations)
 {
-    qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
-    qd_message_content_t *content = msg->content;
-    qd_buffer_t          *buf     = DEQ_HEAD(content->buffers);
-    unsigned char        *cursor;
-    pn_link_t            *pnl     = qd_link_pn(link);
+    pn_link_t           *pnl = qd_link_pn(link);
+    qd_message_stream_t  stream;
 
     char repr[qd_message_repr_len()];
     qd_log(log_source, QD_LOG_TRACE, "Sending %s on link %s",
            qd_message_repr(in_msg, repr, sizeof(repr)),
            pn_link_name(pnl));
 
-    qd_buffer_list_t new_ma;
-    DEQ_INIT(new_ma);
+    ZERO(&stream);
+    stream.msg   = in_msg;
+    stream.strip = strip_annotations;
 
-    if (strip_annotations || compose_message_annotations(msg, &new_ma)) {
-        //
-        // This is the case where the message annotations have been modified.
-        // The message send must be divided into sections:  The existing header;
-        // the new message annotations; the rest of the existing message.
-        // Note that the original message annotations that are still in the
-        // buffer chain must not be sent.
-        //
-        // Start by making sure that we've parsed the message sections through
-        // the message annotations
-        //
-        // ??? NO LONGER NECESSARY???
-        if (!qd_message_check(in_msg, QD_DEPTH_MESSAGE_ANNOTATIONS)) {
-            qd_log(log_source, QD_LOG_ERROR, "Cannot send: %s", qd_error_message);
-            return;
-        }
+    if (send_message(&stream, pnl))
+        return true;
 
-        //
-        // Send header if present
-        //
-        cursor = qd_buffer_base(buf);
-        if (content->section_message_header.length > 0) {
-            buf    = content->section_message_header.buffer;
-            cursor = content->section_message_header.offset + qd_buffer_base(buf);
-            advance(&cursor, &buf,
-                    content->section_message_header.length + content->section_message_header.hdr_length,
-                    send_handler, (void*) pnl);
-        }
+    //
+    // The message has not been completely received.  Attach the progress of the send to
+    // the outgoing delivery so it can be resumed when more of the message arrives.  The
+    // stream holds its own reference so the content outlives the caller's message.
+    //
+    qd_message_stream_t *pending = new_qd_message_stream_t();
+    *pending     = stream;
+    pending->msg = qd_message_copy(in_msg);
 
-        //
-        // Send new message annotations
-        //
-        qd_buffer_t *da_buf = DEQ_HEAD(new_ma);
-        while (da_buf) {
-            pn_link_send(pnl, (char*) qd_buffer_base(da_buf), qd_buffer_size(da_buf));
-            da_buf = DEQ_NEXT(da_buf);
-        }
-        qd_buffer_list_free_buffers(&new_ma);
+    pn_record_t *record = pn_delivery_attachments(pn_link_current(pnl));
+    pn_record_def(record, PN_DELIVERY_CTX, PN_WEAKREF);
+    pn_record_set(record, PN_DELIVERY_CTX, (void*) pending);
+    return false;
+}
 
-        //
-        // Skip over replaced message annotations
-        //
-        if (content->section_message_annotation.length > 0)
-            advance(&cursor, &buf,
-                    content->section_message_annotation.hdr_length + content->section_message_annotation.length,
-                    0, 0);
 
-        //
-        // Send remaining partial buffer
-        //
-        if (buf) {
-            size_t len = qd_buffer_size(buf) - (cursor - qd_buffer_base(buf));
-            advance(&cursor, &buf, len, send_handler, (void*) pnl);
-        }
+bool qd_message_send_pending(qd_link_t *link)
+{
+    pn_delivery_t *pnd = pn_link_current(qd_link_pn(link));
+    return pnd && pn_record_get(pn_delivery_attachments(pnd), PN_DELIVERY_CTX) != 0;
+}
 
-        // Fall through to process the remaining buffers normally
-        // Note that 'advance' will have moved us to the next buffer in the chain.
-    }
 
-    while (buf) {
-        pn_link_send(pnl, (char*) qd_buffer_base(buf), qd_buffer_size(buf));
+bool qd_message_send_resume(qd_link_t *link)
+{
+    pn_link_t           *pnl    = qd_link_pn(link);
+    pn_delivery_t       *pnd    = pn_link_current(pnl);
+    qd_message_stream_t *stream = pnd ? (qd_message_stream_t*) pn_record_get(pn_delivery_attachments(pnd), PN_DELIVERY_CTX) : 0;
+
+    if (!stream)
+        return true;
+
+    if (!send_message(stream, pnl))
+        return false;
+
+    qd_message_send_cancel(pnd);
+    return true;
+}
+
+
+void qd_message_send_cancel(pn_delivery_t *delivery)
+{
+    //
+    // On incoming deliveries the record holds the message being received.
+    //
+    if (!pn_link_is_sender(pn_delivery_link(delivery)))
+        return;
+
+    pn_record_t         *record = pn_delivery_attachments(delivery);
+    qd_message_stream_t *stream = (qd_message_stream_t*) pn_record_get(record, PN_DELIVERY_CTX);
+
+    if (!stream)
+        return;
+
+    pn_record_set(record, PN_DELIVERY_CTX, 0);
+    qd_message_free(stream->msg);
+    free_qd_message_stream_t(stream);
+}
+
+
+//
+// Return true if at least count octets have been received beyond the parse cursor.
+//
+static bool qd_parse_available_LH(qd_message_content_t *content, size_t count)
+{
+    qd_buffer_t *buf   = content->parse_buffer;
+    size_t       avail = 0;
+
+    if (buf)
+        avail = qd_buffer_size(buf) - (content->parse_cursor - qd_buffer_base(buf));
+    while (buf && avail < count) {
         buf = DEQ_NEXT(buf);
+        if (buf)
+            avail += qd_buffer_size(buf);
     }
+
+    return avail >= count;
 }
 
 
-static int qd_check_field_LH(qd_message_content_t *content,
-                             qd_message_depth_t    depth,
-                             const unsigned char  *long_pattern,
-                             const unsigned char  *short_pattern,
-                             const unsigned char  *expected_tags,
-                             qd_field_location_t  *location,
-                             int                   more)
+static qd_message_depth_status_t qd_check_field_LH(qd_message_content_t *content,
+                                                   qd_message_depth_t    depth,
+                                                   const unsigned char  *long_pattern,
+                                                   const unsigned char  *short_pattern,
+                                                   const unsigned char  *expected_tags,
+                                                   qd_field_location_t  *location,
+                                                   int                   more,
+                                                   const char           *error)
 {
 #define LONG  10
 #define SHORT 3
     if (depth > content->parse_depth) {
-        if (0 == qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, long_pattern,  LONG,  expected_tags, location))
-            return 0;
-        if (0 == qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, short_pattern, SHORT, expected_tags, location))
-            return 0;
+        bool                 complete = content->receive_complete;
+        qd_buffer_t         *buffer   = content->parse_buffer;
+        unsigned char       *cursor   = content->parse_cursor;
+        qd_field_location_t  saved    = *location;
+
+        //
+        // Until the whole message has arrived, don't look for a section unless there is
+        // enough data to read its descriptor, tag, and size without running off the end.
+        //
+        if (!complete && !qd_parse_available_LH(content, LONG + 6))
+            return QD_MESSAGE_DEPTH_INCOMPLETE;
+
+        if (0 == qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, long_pattern,  LONG,  expected_tags, location) ||
+            0 == qd_check_and_advance(&content->parse_buffer, &content->parse_cursor, short_pattern, SHORT, expected_tags, location)) {
+            qd_error(QD_ERROR_MESSAGE, "%s", error);
+            return QD_MESSAGE_DEPTH_INVALID;
+        }
+
+        //
+        // If the section reaches the end of a partially received message, it can't be
+        // checked yet.  Back out and try again when more has arrived.
+        //
+        if (!complete && content->parse_cursor == 0) {
+            content->parse_buffer = buffer;
+            content->parse_cursor = cursor;
+            *location = saved;
+            return QD_MESSAGE_DEPTH_INCOMPLETE;
+        }
+
         if (!more)
             content->parse_depth = depth;
     }
-    return 1;
+    return QD_MESSAGE_DEPTH_OK;
 }
 
 
-static bool qd_message_check_LH(qd_message_content_t *content, qd_message_depth_t depth)
+static qd_message_depth_status_t qd_message_check_LH(qd_message_content_t *content, qd_message_depth_t depth)
 {
     qd_error_clear();
     qd_buffer_t *buffer  = DEQ_HEAD(content->buffers);
+    qd_message_depth_status_t rc;
 
     if (!buffer) {
+        if (!content->receive_complete)
+            return QD_MESSAGE_DEPTH_INCOMPLETE;
         qd_error(QD_ERROR_MESSAGE, "No data");
-        return false;
+        return QD_MESSAGE_DEPTH_INVALID;
     }
 
     if (depth <= content->parse_depth)
-        return true; // We've already parsed at least this deep
+        return QD_MESSAGE_DEPTH_OK; // We've already parsed at least this deep
 
     if (content->parse_buffer == 0) {
         content->parse_buffer = buffer;
@@ -956,62 +1345,52 @@ static bool qd_message_check_LH(qd_message_content_t *content, qd_message_depth_
     }
 
     if (depth == QD_DEPTH_NONE)
-        return true;
+        return QD_MESSAGE_DEPTH_OK;
 
     //
     // MESSAGE HEADER
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_HEADER,
-                               MSG_HDR_LONG, MSG_HDR_SHORT, TAGS_LIST, &content->section_message_header, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid header");
-        return false;
-    }
-    if (depth == QD_DEPTH_HEADER)
-        return true;
+    rc = qd_check_field_LH(content, QD_DEPTH_HEADER,
+                           MSG_HDR_LONG, MSG_HDR_SHORT, TAGS_LIST, &content->section_message_header, 0,
+                           "Invalid header");
+    if (rc != QD_MESSAGE_DEPTH_OK || depth == QD_DEPTH_HEADER)
+        return rc;
 
     //
     // DELIVERY ANNOTATION
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_DELIVERY_ANNOTATIONS,
-                               DELIVERY_ANNOTATION_LONG, DELIVERY_ANNOTATION_SHORT, TAGS_MAP, &content->section_delivery_annotation, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid delivery-annotations");
-        return false;
-    }
-    if (depth == QD_DEPTH_DELIVERY_ANNOTATIONS)
-        return true;
+    rc = qd_check_field_LH(content, QD_DEPTH_DELIVERY_ANNOTATIONS,
+                           DELIVERY_ANNOTATION_LONG, DELIVERY_ANNOTATION_SHORT, TAGS_MAP, &content->section_delivery_annotation, 0,
+                           "Invalid delivery-annotations");
+    if (rc != QD_MESSAGE_DEPTH_OK || depth == QD_DEPTH_DELIVERY_ANNOTATIONS)
+        return rc;
 
     //
     // MESSAGE ANNOTATION
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_MESSAGE_ANNOTATIONS,
-                               MESSAGE_ANNOTATION_LONG, MESSAGE_ANNOTATION_SHORT, TAGS_MAP, &content->section_message_annotation, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid annotations");
-        return false;
-    }
-    if (depth == QD_DEPTH_MESSAGE_ANNOTATIONS)
-        return true;
+    rc = qd_check_field_LH(content, QD_DEPTH_MESSAGE_ANNOTATIONS,
+                           MESSAGE_ANNOTATION_LONG, MESSAGE_ANNOTATION_SHORT, TAGS_MAP, &content->section_message_annotation, 0,
+                           "Invalid annotations");
+    if (rc != QD_MESSAGE_DEPTH_OK || depth == QD_DEPTH_MESSAGE_ANNOTATIONS)
+        return rc;
 
     //
     // PROPERTIES
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_PROPERTIES,
-                               PROPERTIES_LONG, PROPERTIES_SHORT, TAGS_LIST, &content->section_message_properties, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid message properties");
-        return false;
-    }
-    if (depth == QD_DEPTH_PROPERTIES)
-        return true;
+    rc = qd_check_field_LH(content, QD_DEPTH_PROPERTIES,
+                           PROPERTIES_LONG, PROPERTIES_SHORT, TAGS_LIST, &content->section_message_properties, 0,
+                           "Invalid message properties");
+    if (rc != QD_MESSAGE_DEPTH_OK || depth == QD_DEPTH_PROPERTIES)
+        return rc;
 
     //
     // APPLICATION PROPERTIES
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_APPLICATION_PROPERTIES,
-                               APPLICATION_PROPERTIES_LONG, APPLICATION_PROPERTIES_SHORT, TAGS_MAP, &content->section_application_properties, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid application-properties");
-        return false;
-    }
-    if (depth == QD_DEPTH_APPLICATION_PROPERTIES)
-        return true;
+    rc = qd_check_field_LH(content, QD_DEPTH_APPLICATION_PROPERTIES,
+                           APPLICATION_PROPERTIES_LONG, APPLICATION_PROPERTIES_SHORT, TAGS_MAP, &content->section_application_properties, 0,
+                           "Invalid application-properties");
+    if (rc != QD_MESSAGE_DEPTH_OK || depth == QD_DEPTH_APPLICATION_PROPERTIES)
+        return rc;
 
     //
     // BODY
@@ -1019,43 +1398,36 @@ static bool qd_message_check_LH(qd_message_content_t *content, qd_message_depth_
     // not a problem for messages passing through Dispatch because through-only messages won't
     // be parsed to BODY-depth.
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_BODY,
-                               BODY_DATA_LONG, BODY_DATA_SHORT, TAGS_BINARY, &content->section_body, 1)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid body data");
-        return false;
-    }
-    if (0 == qd_check_field_LH(content, QD_DEPTH_BODY,
-                               BODY_SEQUENCE_LONG, BODY_SEQUENCE_SHORT, TAGS_LIST, &content->section_body, 1)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid body sequence");
-        return false;
-    }
-    if (0 == qd_check_field_LH(content, QD_DEPTH_BODY,
-                               BODY_VALUE_LONG, BODY_VALUE_SHORT, TAGS_ANY, &content->section_body, 0)) {
-        qd_error(QD_ERROR_MESSAGE, "Invalid body value");
-        return false;
-    }
-    if (depth == QD_DEPTH_BODY)
-        return true;
+    rc = qd_check_field_LH(content, QD_DEPTH_BODY,
+                           BODY_DATA_LONG, BODY_DATA_SHORT, TAGS_BINARY, &content->section_body, 1,
+                           "Invalid body data");
+    if (rc != QD_MESSAGE_DEPTH_OK)
+        return rc;
+    rc = qd_check_field_LH(content, QD_DEPTH_BODY,
+                           BODY_SEQUENCE_LONG, BODY_SEQUENCE_SHORT, TAGS_LIST, &content->section_body, 1,
+                           "Invalid body sequence");
+    if (rc != QD_MESSAGE_DEPTH_OK)
+        return rc;
+    rc = qd_check_field_LH(content, QD_DEPTH_BODY,
+                           BODY_VALUE_LONG, BODY_VALUE_SHORT, TAGS_ANY, &content->section_body, 0,
+                           "Invalid body value");
+    if (rc != QD_MESSAGE_DEPTH_OK || depth == QD_DEPTH_BODY)
+        return rc;
 
     //
     // FOOTER
     //
-    if (0 == qd_check_field_LH(content, QD_DEPTH_ALL,
-                               FOOTER_LONG, FOOTER_SHORT, TAGS_MAP, &content->section_footer, 0)) {
-
-        qd_error(QD_ERROR_MESSAGE, "Invalid footer");
-        return false;
-    }
-
-    return true;
+    return qd_check_field_LH(content, QD_DEPTH_ALL,
+                             FOOTER_LONG, FOOTER_SHORT, TAGS_MAP, &content->section_footer, 0,
+                             "Invalid footer");
 }
 
 
-int qd_message_check(qd_message_t *in_msg, qd_message_depth_t depth)
+qd_message_depth_status_t qd_message_check_depth(qd_message_t *in_msg, qd_message_depth_t depth)
 {
-    qd_message_pvt_t     *msg     = (qd_message_pvt_t*) in_msg;
-    qd_message_content_t *content = msg->content;
-    int                   result;
+    qd_message_pvt_t          *msg     = (qd_message_pvt_t*) in_msg;
+    qd_message_content_t      *content = msg->content;
+    qd_message_depth_status_t  result;
 
     sys_mutex_lock(content->lock);
     result = qd_message_check_LH(content, depth);
@@ -1064,6 +1436,12 @@ int qd_message_check(qd_message_t *in_msg, qd_message_depth_t depth)
 }
 
 
+int qd_message_check(qd_message_t *in_msg, qd_message_depth_t depth)
+{
+    return qd_message_check_depth(in_msg, depth) == QD_MESSAGE_DEPTH_OK;
+}
+
+
 qd_field_iterator_t *qd_message_field_iterator_typed(qd_message_t *msg, qd_message_field_t field)
 {
     qd_field_location_t *loc = qd_message_field_location(msg, field);
@@ -1143,8 +1521,9 @@ void qd_message_compose_1(qd_message_t *msg, const char *to, qd_buffer_list_t *b
     //qd_compose_insert_uint(field, 0);     // delivery-count
     qd_compose_end_list(field);
 
+    qd_message_annotations_t *ma = ((qd_message_pvt_t*) msg)->ma;
     qd_buffer_list_t out_ma;
-    if (compose_message_annotations((qd_message_pvt_t*)msg, &out_ma)) {
+    if (ma && compose_message_annotations(ma, &out_ma)) {
         qd_compose_insert_buffers(field, &out_ma);
     }
 
@@ -44,6 +44,10 @@
  * references.  If a message is received and is to be queued for multiple destinations, there is only
  * one copy of the message content in memory but multiple lightweight references to the content.
  *
+ * A message may be forwarded before it has been completely received.  The receiving thread fills
+ * buffers privately and publishes them to the content's buffer chain under the content lock.  Once
+ * published, the octets of a buffer never change, so senders may read them without the lock.
+ *
  * @internal
  * @{ 
  */
@@ -59,14 +63,13 @@ typedef struct {
 
 
 // TODO - consider using pointers to qd_field_location_t below to save memory
-// TODO - provide a way to allocate a message without a lock for the link-routing case.
-//        It's likely that link-routing will cause no contention for the message content.
 //
 
 typedef struct {
-    sys_mutex_t         *lock;
-    uint32_t             ref_count;                       // The number of messages referencing this
+    sys_mutex_t         *lock;                            // Shared with other contents; see content_lock()
+    uint32_t             ref_count;                       // The number of messages referencing this (atomic)
     qd_buffer_list_t     buffers;                         // The buffer chain containing the message
+    bool                 receive_complete;                // True once the whole message has been received
     qd_field_location_t  section_message_header;          // The message header list
     qd_field_location_t  section_delivery_annotation;     // The delivery annotation map
     qd_field_location_t  section_message_annotation;      // The message annotation map
@@ -87,20 +90,59 @@ typedef struct {
     qd_parsed_field_t   *parsed_message_annotations;
 } qd_message_content_t;
 
+/**
+ * The outbound message annotations of a message.  Copies of a message share one of these until a
+ * copy changes its annotations, at which point that copy gets its own.  The fields other than the
+ * encoding don't change while the annotations are shared.  The section is encoded by whichever
+ * copy is sent first; the encoding is protected by the content lock and the buffers don't change
+ * once encoded is set.
+ */
+typedef struct {
+    uint32_t          ref_count;    // The number of messages referencing this (atomic)
+    qd_buffer_list_t  to_override;  // to field in outgoing message annotations.
+    qd_buffer_list_t  trace;        // trace list in outgoing message annotations
+    qd_buffer_list_t  ingress;      // ingress field in outgoing message annotations
+    int               phase;        // phase for the override address
+    bool              encoded;      // True once buffers holds the encoded section
+    qd_buffer_list_t  buffers;      // The encoded message annotations section
+} qd_message_annotations_t;
+
 typedef struct {
     DEQ_LINKS(qd_message_t);   // Deque linkage that overlays the qd_message_t
-    qd_message_content_t *content;
-    qd_buffer_list_t      ma_to_override;  // to field in outgoing message annotations.
-    qd_buffer_list_t      ma_trace;        // trace list in outgoing message annotations
-    qd_buffer_list_t      ma_ingress;      // ingress field in outgoing message annotations
-    int                   ma_phase;        // phase for the override address
+    qd_message_content_t     *content;
+    qd_message_annotations_t *ma;           // outgoing message annotations, or null if none
+    bool                      cut_through;  // handed on for forwarding before it was completely received
 } qd_message_pvt_t;
 
+/**
+ * The progress of a message being sent before it has been completely received.
+ * This is attached to the outgoing delivery until the whole message has been sent.
+ */
+typedef struct {
+    qd_message_t  *msg;      // Reference to the message held for the duration of the send
+    bool           strip;    // Strip the inbound annotations
+    bool           started;  // The header and annotations have been sent
+    qd_buffer_t   *buffer;   // Buffer holding the next octet to send
+    unsigned char *cursor;   // Next octet to send
+} qd_message_stream_t;
+
 ALLOC_DECLARE(qd_message_t);
 ALLOC_DECLARE(qd_message_content_t);
+ALLOC_DECLARE(qd_message_stream_t);
+ALLOC_DECLARE(qd_message_annotations_t);
 
 #define MSG_CONTENT(m) (((qd_message_pvt_t*) m)->content)
 
+/**
+ * Get the encoded outbound message annotations for a message.
+ *
+ * @param local An empty list into which the section is encoded if it can't be shared.  The
+ *        caller must free any buffers left in it.
+ * @return The list holding the section (either local or a list shared with copies of the
+ *         message that must not be modified), or null if the message has no annotations.
+ */
+qd_buffer_list_t *qd_message_outbound_annotations(qd_message_t *msg, qd_buffer_list_t *local);
+
 /** Initialize logging */
 void qd_message_initialize();
 
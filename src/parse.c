@@ -22,26 +22,54 @@
 #include <qpid/dispatch/parse.h>
 #include <qpid/dispatch/amqp.h>
 
-DEQ_DECLARE(qd_parsed_field_t, qd_parsed_field_list_t);
-
 struct qd_parsed_field_t {
-    DEQ_LINKS(qd_parsed_field_t);
     qd_parsed_field_t      *parent;
-    qd_parsed_field_list_t  children;
+    qd_parsed_field_t      *children;    ///< Contiguous array of 'count' sub-fields, built on first access
+    uint32_t                count;       ///< Number of encoded sub-fields (map keys and values both count)
+    uint32_t                length;      ///< Octets of encoded content following the count
     uint8_t                 tag;
     qd_field_iterator_t    *raw_iter;
     const char             *parse_error;
+    qd_arena_t             *arena;       ///< Holds every field of the tree and its iterators
 };
 
-ALLOC_DECLARE(qd_parsed_field_t);
-ALLOC_DEFINE(qd_parsed_field_t);
+//
+// The fields of a parsed tree and their iterators are allocated from an arena owned by the
+// root and are released together when the root is freed.  The first block is sized for a
+// typical message-annotations map.
+//
+// qd_parse validates the whole encoding up front but only builds the root field.  The
+// sub-fields of a list or map are built, as one contiguous array, the first time they are
+// asked for, so that indexed access is constant-time and nested composites that are never
+// looked at cost nothing beyond the validation scan.
+//
+#define PARSE_ARENA_BLOCK 2048
+
+
+//
+// Read one octet of a field header, charging it to the byte budget of the enclosing
+// composite.  A budget of zero is treated like the end of the data.
+//
+static inline bool budget_end(qd_field_iterator_t *iter, uint32_t *budget)
+{
+    return *budget == 0 || qd_field_iterator_end(iter);
+}
+
+
+static inline unsigned int budget_octet(qd_field_iterator_t *iter, uint32_t *budget)
+{
+    if (*budget)
+        (*budget)--;
+    return (unsigned int) qd_field_iterator_octet(iter);
+}
 
 
-static char *get_type_info(qd_field_iterator_t *iter, uint8_t *tag, uint32_t *length, uint32_t *count, uint32_t *clen)
+static char *get_type_info(qd_field_iterator_t *iter, uint32_t *budget,
+                           uint8_t *tag, uint32_t *length, uint32_t *count, uint32_t *clen)
 {
-    if (qd_field_iterator_end(iter))
+    if (budget_end(iter, budget))
         return "Insufficient Data to Determine Tag";
-    *tag      = qd_field_iterator_octet(iter);
+    *tag      = budget_octet(iter, budget);
     *count    = 0;
     *length   = 0;
     *clen     = 0;
@@ -56,17 +84,17 @@ static char *get_type_info(qd_field_iterator_t *iter, uint8_t *tag, uint32_t *le
     case 0xB0:
     case 0xD0:
     case 0xF0:
-        *length += ((unsigned int) qd_field_iterator_octet(iter)) << 24;
-        *length += ((unsigned int) qd_field_iterator_octet(iter)) << 16;
-        *length += ((unsigned int) qd_field_iterator_octet(iter)) << 8;
+        *length += budget_octet(iter, budget) << 24;
+        *length += budget_octet(iter, budget) << 16;
+        *length += budget_octet(iter, budget) << 8;
         // fall through to the next case
 
     case 0xA0:
     case 0xC0:
     case 0xE0:
-        if (qd_field_iterator_end(iter))
+        if (budget_end(iter, budget))
             return "Insufficient Data to Determine Length";
-        *length += (unsigned int) qd_field_iterator_octet(iter);
+        *length += budget_octet(iter, budget);
         break;
 
     default:
@@ -76,17 +104,17 @@ static char *get_type_info(qd_field_iterator_t *iter, uint8_t *tag, uint32_t *le
     switch (*tag & 0xF0) {
     case 0xD0:
     case 0xF0:
-        *count += ((unsigned int) qd_field_iterator_octet(iter)) << 24;
-        *count += ((unsigned int) qd_field_iterator_octet(iter)) << 16;
-        *count += ((unsigned int) qd_field_iterator_octet(iter)) << 8;
+        *count += budget_octet(iter, budget) << 24;
+        *count += budget_octet(iter, budget) << 16;
+        *count += budget_octet(iter, budget) << 8;
         *clen = 3;
         // fall through to the next case
 
     case 0xC0:
     case 0xE0:
-        if (qd_field_iterator_end(iter))
+        if (budget_end(iter, budget))
             return "Insufficient Data to Determine Count";
-        *count += (unsigned int) qd_field_iterator_octet(iter);
+        *count += budget_octet(iter, budget);
         *clen += 1;
         break;
     }
@@ -101,43 +129,116 @@ static char *get_type_info(qd_field_iterator_t *iter, uint8_t *tag, uint32_t *le
 }
 
 
-static qd_parsed_field_t *qd_parse_internal(qd_field_iterator_t *iter, qd_parsed_field_t *p)
+//
+// Check the structure of one encoded field and everything nested in it without building
+// anything.  On return the iterator is positioned after the field and the budget has been
+// charged for it.
+//
+static const char *validate_field(qd_field_iterator_t *iter, uint32_t *budget)
 {
-    qd_parsed_field_t *field = new_qd_parsed_field_t();
-    if (!field)
-        return 0;
+    uint8_t  tag;
+    uint32_t length;
+    uint32_t count;
+    uint32_t length_of_count;
 
-    DEQ_ITEM_INIT(field);
-    DEQ_INIT(field->children);
-    field->parent   = p;
-    field->raw_iter = 0;
+    const char *err = get_type_info(iter, budget, &tag, &length, &count, &length_of_count);
+    if (err)
+        return err;
 
+    uint32_t content = length - length_of_count;
+    uint32_t inner   = content;
+    for (uint32_t idx = 0; idx < count; idx++) {
+        err = validate_field(iter, &inner);
+        if (err)
+            return err;
+    }
+
+    qd_field_iterator_advance(iter, inner);
+    *budget -= content < *budget ? content : *budget;
+    return 0;
+}
+
+
+//
+// Set up a field from the encoding at the iterator and step over it.  The sub-fields of a
+// composite are left unbuilt.  Returns the length of the encoded sub-fields.
+//
+static uint32_t field_init(qd_parsed_field_t *field, qd_parsed_field_t *parent, qd_arena_t *arena,
+                       qd_field_iterator_t *iter)
+{
+    uint32_t budget = UINT32_MAX;
     uint32_t length;
-    uint32_t count;
     uint32_t length_of_count;
 
-    field->parse_error = get_type_info(iter, &field->tag, &length, &count, &length_of_count);
-
-    if (!field->parse_error) {
-        field->raw_iter = qd_field_iterator_sub(iter, length);
-        qd_field_iterator_advance(iter, length - length_of_count);
-        for (uint32_t idx = 0; idx < count; idx++) {
-            qd_parsed_field_t *child = qd_parse_internal(field->raw_iter, field);
-            DEQ_INSERT_TAIL(field->children, child);
-            if (!qd_parse_ok(child)) {
-                field->parse_error = child->parse_error;
-                break;
-            }
-        }
+    field->parent   = parent;
+    field->children = 0;
+    field->count    = 0;
+    field->length   = 0;
+    field->raw_iter = 0;
+    field->arena    = arena;
+
+    field->parse_error = get_type_info(iter, &budget, &field->tag, &length, &field->count, &length_of_count);
+    if (field->parse_error)
+        return 0;
+
+    field->raw_iter = qd_field_iterator_sub_arena(iter, length, arena);
+    if (!field->raw_iter) {
+        field->parse_error = "Out of memory";
+        return 0;
     }
+    field->length = length - length_of_count;
+    qd_field_iterator_advance(iter, field->length);
+    return field->length;
+}
 
-    return field;
+
+//
+// Build the sub-fields of a composite field.  The encoding was validated by qd_parse so
+// this cannot fail for want of data.  The walk uses a copy of the field's iterator so that
+// an iterator handed out by qd_parse_raw is not moved under its holder.
+//
+static bool expand_children(qd_parsed_field_t *field)
+{
+    if (field->children)
+        return true;
+    if (field->count == 0 || field->parse_error)
+        return false;
+
+    qd_parsed_field_t *children =
+        (qd_parsed_field_t*) qd_arena_alloc(field->arena, field->count * sizeof(qd_parsed_field_t));
+    qd_field_iterator_t *walk = qd_field_iterator_dup_arena(field->raw_iter, field->arena);
+    if (!children || !walk)
+        return false;
+
+    qd_field_iterator_reset(walk);
+    for (uint32_t idx = 0; idx < field->count; idx++)
+        field_init(&children[idx], field, field->arena, walk);
+
+    field->children = children;
+    return true;
 }
 
 
 qd_parsed_field_t *qd_parse(qd_field_iterator_t *iter)
 {
-    return qd_parse_internal(iter, 0);
+    qd_arena_t *arena = qd_arena(PARSE_ARENA_BLOCK);
+    if (!arena)
+        return 0;
+
+    qd_parsed_field_t *field = (qd_parsed_field_t*) qd_arena_alloc(arena, sizeof(qd_parsed_field_t));
+    if (!field) {
+        qd_arena_free(arena);
+        return 0;
+    }
+
+    uint32_t inner = field_init(field, 0, arena, iter);
+    if (!field->parse_error && field->count > 0) {
+        for (uint32_t idx = 0; idx < field->count && !field->parse_error; idx++)
+            field->parse_error = validate_field(field->raw_iter, &inner);
+        qd_field_iterator_reset(field->raw_iter);
+    }
+
+    return field;
 }
 
 
@@ -147,19 +248,7 @@ void qd_parse_free(qd_parsed_field_t *field)
         return;
 
     assert(field->parent == 0);
-    if (field->raw_iter)
-        qd_field_iterator_free(field->raw_iter);
-
-    qd_parsed_field_t *sub_field = DEQ_HEAD(field->children);
-    while (sub_field) {
-        qd_parsed_field_t *next = DEQ_NEXT(sub_field);
-        DEQ_REMOVE_HEAD(field->children);
-        sub_field->parent = 0;
-        qd_parse_free(sub_field);
-        sub_field = next;
-    }
-
-    free_qd_parsed_field_t(field);
+    qd_arena_free(field->arena);
 }
 
 
@@ -187,6 +276,12 @@ qd_field_iterator_t *qd_parse_raw(qd_parsed_field_t *field)
 }
 
 
+uint32_t qd_parse_raw_length(qd_parsed_field_t *field)
+{
+    return field->length;
+}
+
+
 uint32_t qd_parse_as_uint(qd_parsed_field_t *field)
 {
     uint32_t result = 0;
@@ -332,7 +427,10 @@ bool qd_parse_as_bool(qd_parsed_field_t *field)
 
 uint32_t qd_parse_sub_count(qd_parsed_field_t *field)
 {
-    uint32_t count = DEQ_SIZE(field->children);
+    if (field->parse_error)
+        return 0;
+
+    uint32_t count = field->count;
 
     if (field->tag == QD_AMQP_MAP8 || field->tag == QD_AMQP_MAP32)
         count = count >> 1;
@@ -347,13 +445,10 @@ qd_parsed_field_t *qd_parse_sub_key(qd_parsed_field_t *field, uint32_t idx)
         return 0;
 
     idx = idx << 1;
-    qd_parsed_field_t *key = DEQ_HEAD(field->children);
-    while (idx && key) {
-        idx--;
-        key = DEQ_NEXT(key);
-    }
+    if (idx >= field->count || !expand_children(field))
+        return 0;
 
-    return key;
+    return &field->children[idx];
 }
 
 
@@ -362,13 +457,10 @@ qd_parsed_field_t *qd_parse_sub_value(qd_parsed_field_t *field, uint32_t idx)
     if (field->tag == QD_AMQP_MAP8 || field->tag == QD_AMQP_MAP32)
         idx = (idx << 1) + 1;
 
-    qd_parsed_field_t *key = DEQ_HEAD(field->children);
-    while (idx && key) {
-        idx--;
-        key = DEQ_NEXT(key);
-    }
+    if (idx >= field->count || !expand_children(field))
+        return 0;
 
-    return key;
+    return &field->children[idx];
 }
 
 
@@ -386,7 +478,7 @@ int qd_parse_is_list(qd_parsed_field_t *field)
 
 int qd_parse_is_scalar(qd_parsed_field_t *field)
 {
-    return DEQ_SIZE(field->children) == 0;
+    return field->count == 0;
 }
 
 
@@ -19,10 +19,18 @@
  *
  */
 
+#include "config.h"
+
 #include <assert.h>
-#include <poll.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#if USE_EPOLL
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
 
 #include <ctype.h>
 #include <errno.h>
@@ -55,6 +63,34 @@
 #define PN_SEL_RD (0x0001)
 #define PN_SEL_WR (0x0002)
 
+#if USE_EPOLL
+//
+// Maximum number of events harvested by one call to epoll_wait.  Events that
+// don't fit remain queued in the kernel and are returned by the next call.
+//
+#define QDPN_EPOLL_BATCH 256
+
+//
+// Sockets are registered with a tag holding the slot of their listener or
+// connector and the generation of the slot.  Freeing the object frees the
+// slot and advances its generation, so an event harvested afterwards by a
+// thread that was already waiting is recognized and ignored.
+//
+#define QDPN_EPOLL_CTRL      ((uint64_t) 0x1)
+#define QDPN_EPOLL_WATCH     ((uint64_t) 0x2)
+#define QDPN_EPOLL_KIND_MASK ((uint64_t) 0x3)
+#define QDPN_EPOLL_GEN_MASK  ((uint32_t) 0x3fffffff)
+#define QDPN_NO_SLOT         UINT32_MAX
+
+typedef struct {
+    void     *object;     // The listener or connector, null if the slot is free
+    uint32_t  gen;        // Incremented each time the slot is freed
+    uint32_t  next_free;
+    bool      listener;
+} qdpn_slot_t;
+
+#endif
+
 DEQ_DECLARE(qdpn_listener_t, qdpn_listener_list_t);
 DEQ_DECLARE(qdpn_connector_t, qdpn_connector_list_t);
 
@@ -78,14 +114,36 @@ struct qdpn_driver_t {
     qdpn_connector_t      *connector_next;
     size_t                 closed_count;
 
+#if USE_EPOLL
+    qdpn_connector_list_t  ready;        // Connectors that need service
+    qdpn_connector_t     **timers;       // Min-heap of connectors ordered by wakeup time
+    size_t                 timer_count;
+    size_t                 timer_capacity;
+    qdpn_slot_t           *slots;        // The listeners and connectors known to epoll
+    uint32_t               slot_count;
+    uint32_t               slot_free;     // Head of the list of free slots
+    int                    waiters;       // Number of threads blocked in epoll_wait
+    pn_timestamp_t         wait_deadline; // Deadline in use by the waiting threads
+    int                    wakeup_pending; // A wakeup has been posted but not consumed (atomic)
+    int                    broadcast;     // Wakeups still to be relayed by qdpn_driver_wakeup_all (atomic)
+    int                    epfd;
+#else
     //
     // The following values will only be accessed by one thread at a time.
     //
     size_t          capacity;
     struct pollfd  *fds;
     size_t          nfds;
+#endif
     int             ctrl[2]; //pipe for updating selectable status
     pn_timestamp_t  wakeup;
+
+    //
+    // The I/O budget of a connector for each time it is handed out.  These are set before the
+    // driver is used and don't change.
+    //
+    size_t          io_budget_bytes;
+    int             io_budget_passes;
 };
 
 struct qdpn_listener_t {
@@ -96,6 +154,9 @@ struct qdpn_listener_t {
     int fd;
     bool pending;
     bool closed;
+#if USE_EPOLL
+    uint32_t slot;
+#endif
 };
 
 #define PN_NAME_MAX (256)
@@ -121,6 +182,28 @@ struct qdpn_connector_t {
     bool closed;
     bool input_done;
     bool output_done;
+    //
+    // I/O done since the connector was handed out by the driver, and totals kept to show how
+    // often the connector had to give way to others with I/O still ready.
+    //
+    size_t   io_bytes;
+    int      io_passes;
+    uint64_t octets_in;
+    uint64_t octets_out;
+    uint64_t io_yields;
+#if USE_EPOLL
+    //
+    // Sockets are registered edge-triggered.  Readiness reported by epoll is
+    // latched here until a read or write shows the socket has been exhausted.
+    //
+    DEQ_LINKS_N(READY, qdpn_connector_t);
+    bool in_ready;
+    bool readable;
+    bool writable;
+    bool repoll;       // Readiness was consumed by qdpn_connector_activated, re-poll on activate
+    size_t timer_idx;  // One-based position in the driver's timer heap, zero if absent
+    uint32_t slot;
+#endif
 };
 
 ALLOC_DECLARE(qdpn_listener_t);
@@ -168,12 +251,14 @@ static bool pn_env_bool(const char *name)
 #define pn_min(X,Y) ((X) > (Y) ? (Y) : (X))
 #define pn_max(X,Y) ((X) < (Y) ? (Y) : (X))
 
+#if !USE_EPOLL
 static pn_timestamp_t pn_timestamp_min( pn_timestamp_t a, pn_timestamp_t b )
 {
     if (a && b) return pn_min(a, b);
     if (a) return a;
     return b;
 }
+#endif
 
 static void qdpn_log_errno(qdpn_driver_t *d, const char *msg)
 {
@@ -183,6 +268,223 @@ static void qdpn_log_errno(qdpn_driver_t *d, const char *msg)
 }
 
 
+#if USE_EPOLL
+
+// epoll support
+
+static void qdpn_epoll_ctl(qdpn_driver_t *d, int op, int fd, uint32_t events, uint64_t data)
+{
+    struct epoll_event ev;
+    ev.events   = events;
+    ev.data.u64 = data;
+    if (epoll_ctl(d->epfd, op, fd, &ev) == -1)
+        qdpn_log_errno(d, "epoll_ctl");
+}
+
+
+static uint64_t qdpn_epoll_tag(qdpn_driver_t *d, uint32_t slot)
+{
+    return ((uint64_t) slot << 32) | ((uint64_t) (d->slots[slot].gen & QDPN_EPOLL_GEN_MASK) << 2) | QDPN_EPOLL_WATCH;
+}
+
+
+/**
+ * Give a listener or connector a slot, which identifies it in its events.
+ * @return The slot.
+ */
+static uint32_t qdpn_epoll_watch_LH(qdpn_driver_t *d, void *object, bool listener)
+{
+    if (d->slot_free == QDPN_NO_SLOT) {
+        uint32_t count = d->slot_count ? 2 * d->slot_count : 64;
+        d->slots = (qdpn_slot_t*) realloc(d->slots, count * sizeof(qdpn_slot_t));
+        for (uint32_t i = count; i > d->slot_count; i--) {
+            d->slots[i - 1].object    = 0;
+            d->slots[i - 1].gen       = 0;
+            d->slots[i - 1].next_free = d->slot_free;
+            d->slot_free = i - 1;
+        }
+        d->slot_count = count;
+    }
+
+    uint32_t     slot = d->slot_free;
+    qdpn_slot_t *s    = &d->slots[slot];
+    d->slot_free = s->next_free;
+    s->object   = object;
+    s->listener = listener;
+    return slot;
+}
+
+
+/**
+ * Release the slot of a listener or connector that is about to be freed.  Any
+ * event for it that has been harvested but not yet processed is now stale.
+ */
+static void qdpn_epoll_forget_LH(qdpn_driver_t *d, uint32_t slot)
+{
+    qdpn_slot_t *s = &d->slots[slot];
+    s->object    = 0;
+    s->gen++;
+    s->next_free = d->slot_free;
+    d->slot_free = slot;
+}
+
+
+/**
+ * @return The listener or connector an event is for, or null if it has been freed.
+ */
+static void *qdpn_epoll_object_LH(qdpn_driver_t *d, uint64_t data, bool *listener)
+{
+    uint32_t slot = (uint32_t) (data >> 32);
+    if ((data & QDPN_EPOLL_KIND_MASK) != QDPN_EPOLL_WATCH || slot >= d->slot_count)
+        return 0;
+
+    qdpn_slot_t *s = &d->slots[slot];
+    if (!s->object || (s->gen & QDPN_EPOLL_GEN_MASK) != ((data >> 2) & QDPN_EPOLL_GEN_MASK))
+        return 0;
+    *listener = s->listener;
+    return s->object;
+}
+
+
+static bool qdpn_connector_needs_service_LH(qdpn_connector_t *c)
+{
+    return c->closed || c->socket_error || c->pending_tick ||
+        (c->readable && (c->status & PN_SEL_RD)) ||
+        (c->writable && (c->status & PN_SEL_WR));
+}
+
+
+/**
+ * Place the connector on the ready list if it needs service.
+ * @return true iff the connector was added to the ready list.
+ */
+static bool qdpn_connector_schedule_LH(qdpn_driver_t *d, qdpn_connector_t *c)
+{
+    if (c->in_ready || !qdpn_connector_needs_service_LH(c))
+        return false;
+    c->in_ready = true;
+    DEQ_INSERT_TAIL_N(READY, d->ready, c);
+    return true;
+}
+
+
+static void qdpn_connector_unschedule_LH(qdpn_driver_t *d, qdpn_connector_t *c)
+{
+    if (c->in_ready) {
+        c->in_ready = false;
+        DEQ_REMOVE_N(READY, d->ready, c);
+    }
+}
+
+
+//
+// Set when the control pipe wakes the polling thread, and reported by the
+// same thread's qdpn_driver_wait_3.
+//
+static __thread bool qdpn_woken = false;
+
+/**
+ * Consume a wakeup from the control pipe.  The pipe is edge-triggered so that
+ * a single wakeup releases a single waiting thread; if a broadcast is under way,
+ * this thread passes the wakeup on to the next one.
+ */
+static void qdpn_driver_woken(qdpn_driver_t *d)
+{
+    char buffer[512];
+    while (read(d->ctrl[0], buffer, sizeof(buffer)) > 0);
+    qdpn_woken = true;
+    __atomic_store_n(&d->wakeup_pending, 0, __ATOMIC_RELEASE);
+
+    int remaining = __atomic_load_n(&d->broadcast, __ATOMIC_ACQUIRE);
+    while (remaining > 0) {
+        if (__atomic_compare_exchange_n(&d->broadcast, &remaining, remaining - 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (remaining > 1)
+                qdpn_driver_wakeup(d);
+            break;
+        }
+    }
+}
+
+
+//
+// Connector tick timers are kept in a binary min-heap so that finding the
+// expired timers does not require a pass over every connector.
+//
+
+static void qdpn_timer_swap_LH(qdpn_driver_t *d, size_t a, size_t b)
+{
+    qdpn_connector_t *tmp = d->timers[a];
+    d->timers[a] = d->timers[b];
+    d->timers[b] = tmp;
+    d->timers[a]->timer_idx = a + 1;
+    d->timers[b]->timer_idx = b + 1;
+}
+
+
+static void qdpn_timer_sift_LH(qdpn_driver_t *d, size_t idx)
+{
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (d->timers[parent]->wakeup <= d->timers[idx]->wakeup)
+            break;
+        qdpn_timer_swap_LH(d, parent, idx);
+        idx = parent;
+    }
+
+    for (;;) {
+        size_t left     = 2 * idx + 1;
+        size_t right    = left + 1;
+        size_t smallest = idx;
+        if (left < d->timer_count && d->timers[left]->wakeup < d->timers[smallest]->wakeup)
+            smallest = left;
+        if (right < d->timer_count && d->timers[right]->wakeup < d->timers[smallest]->wakeup)
+            smallest = right;
+        if (smallest == idx)
+            break;
+        qdpn_timer_swap_LH(d, idx, smallest);
+        idx = smallest;
+    }
+}
+
+
+static void qdpn_timer_remove_LH(qdpn_driver_t *d, qdpn_connector_t *c)
+{
+    if (!c->timer_idx)
+        return;
+
+    size_t idx = c->timer_idx - 1;
+    c->timer_idx = 0;
+    d->timer_count--;
+    if (idx != d->timer_count) {
+        d->timers[idx] = d->timers[d->timer_count];
+        d->timers[idx]->timer_idx = idx + 1;
+        qdpn_timer_sift_LH(d, idx);
+    }
+}
+
+
+static void qdpn_timer_update_LH(qdpn_driver_t *d, qdpn_connector_t *c)
+{
+    if (!c->wakeup) {
+        qdpn_timer_remove_LH(d, c);
+        return;
+    }
+
+    if (!c->timer_idx) {
+        if (d->timer_count == d->timer_capacity) {
+            d->timer_capacity = d->timer_capacity ? 2 * d->timer_capacity : 64;
+            d->timers = (qdpn_connector_t**) realloc(d->timers, d->timer_capacity * sizeof(qdpn_connector_t*));
+        }
+        d->timers[d->timer_count] = c;
+        c->timer_idx = ++d->timer_count;
+    }
+    qdpn_timer_sift_LH(d, c->timer_idx - 1);
+}
+
+#endif
+
+
 // listener
 
 static void qdpn_driver_add_listener(qdpn_driver_t *d, qdpn_listener_t *l)
@@ -190,6 +492,12 @@ static void qdpn_driver_add_listener(qdpn_driver_t *d, qdpn_listener_t *l)
     if (!l->driver) return;
     sys_mutex_lock(d->lock);
     DEQ_INSERT_TAIL(d->listeners, l);
+#if USE_EPOLL
+    l->slot = qdpn_epoll_watch_LH(d, l, true);
+    // Listeners are level-triggered so that a backlog of pending connections
+    // keeps the listener active until it has been drained.
+    qdpn_epoll_ctl(d, EPOLL_CTL_ADD, l->fd, EPOLLIN, qdpn_epoll_tag(d, l->slot));
+#endif
     sys_mutex_unlock(d->lock);
     l->driver = d;
 }
@@ -202,6 +510,9 @@ static void qdpn_driver_remove_listener(qdpn_driver_t *d, qdpn_listener_t *l)
     if (l == d->listener_next)
         d->listener_next = DEQ_NEXT(l);
     DEQ_REMOVE(d->listeners, l);
+#if USE_EPOLL
+    qdpn_epoll_forget_LH(d, l->slot);
+#endif
     sys_mutex_unlock(d->lock);
 
     l->driver = NULL;
@@ -316,6 +627,15 @@ qdpn_listener_t *qdpn_listener_fd(qdpn_driver_t *driver, int fd, void *context)
 
     qdpn_listener_t *l = new_qdpn_listener_t();
     if (!l) return NULL;
+#if USE_EPOLL
+    //
+    // More than one thread may be told of the same pending connection.  The
+    // socket must not block those that find the backlog already drained.
+    //
+    int flags = fcntl(fd, F_GETFL);
+    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        qdpn_log_errno(driver, "fcntl");
+#endif
     DEQ_ITEM_INIT(l);
     l->driver = driver;
     l->idx = 0;
@@ -391,7 +711,8 @@ qdpn_connector_t *qdpn_listener_accept(qdpn_listener_t *l,
 
     int sock = accept(l->fd, (struct sockaddr *) &addr, &addrlen);
     if (sock < 0) {
-        qdpn_log_errno(l->driver, "accept");
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            qdpn_log_errno(l->driver, "accept");
         return 0;
     } else {
         int code;
@@ -430,6 +751,10 @@ void qdpn_listener_close(qdpn_listener_t *l)
     if (!l) return;
     if (l->closed) return;
 
+#if USE_EPOLL
+    if (l->driver)
+        qdpn_epoll_ctl(l->driver, EPOLL_CTL_DEL, l->fd, 0, 0);
+#endif
     if (close(l->fd) == -1)
         perror("close");
     l->closed = true;
@@ -450,6 +775,12 @@ static void qdpn_driver_add_connector(qdpn_driver_t *d, qdpn_connector_t *c)
     if (!c->driver) return;
     sys_mutex_lock(d->lock);
     DEQ_INSERT_TAIL(d->connectors, c);
+#if USE_EPOLL
+    c->slot = qdpn_epoll_watch_LH(d, c, false);
+    // The socket is registered once for all events.  Changes of interest are
+    // applied against the latched readiness without further system calls.
+    qdpn_epoll_ctl(d, EPOLL_CTL_ADD, c->fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, qdpn_epoll_tag(d, c->slot));
+#endif
     sys_mutex_unlock(d->lock);
     c->driver = d;
 }
@@ -464,6 +795,11 @@ static void qdpn_driver_remove_connector(qdpn_driver_t *d, qdpn_connector_t *c)
     }
 
     DEQ_REMOVE(d->connectors, c);
+#if USE_EPOLL
+    qdpn_connector_unschedule_LH(d, c);
+    qdpn_timer_remove_LH(d, c);
+    qdpn_epoll_forget_LH(d, c->slot);
+#endif
     c->driver = NULL;
     if (c->closed) {
         d->closed_count--;
@@ -539,8 +875,21 @@ qdpn_connector_t *qdpn_connector_fd(qdpn_driver_t *driver, int fd, void *context
     c->transport = pn_transport();
     c->input_done = false;
     c->output_done = false;
+    c->io_bytes = 0;
+    c->io_passes = 0;
+    c->octets_in = 0;
+    c->octets_out = 0;
+    c->io_yields = 0;
     c->context = context;
     c->listener = NULL;
+#if USE_EPOLL
+    DEQ_ITEM_INIT_N(READY, c);
+    c->in_ready = false;
+    c->readable = false;
+    c->writable = false;
+    c->repoll = false;
+    c->timer_idx = 0;
+#endif
 
     qdpn_connector_trace(c, driver->trace);
 
@@ -630,6 +979,17 @@ const char *qdpn_connector_hostip(const qdpn_connector_t *ctor)
     return ctor->hostip;
 }
 
+void qdpn_connector_io_stats(const qdpn_connector_t *ctor, uint64_t *octets_in, uint64_t *octets_out, uint64_t *io_yields)
+{
+    //
+    // The counters are updated only by the thread processing the connector; other threads
+    // read a recent value.
+    //
+    *octets_in  = ctor ? __atomic_load_n(&ctor->octets_in, __ATOMIC_RELAXED) : 0;
+    *octets_out = ctor ? __atomic_load_n(&ctor->octets_out, __ATOMIC_RELAXED) : 0;
+    *io_yields  = ctor ? __atomic_load_n(&ctor->io_yields, __ATOMIC_RELAXED) : 0;
+}
+
 qdpn_listener_t *qdpn_connector_listener(qdpn_connector_t *ctor)
 {
     return ctor ? ctor->listener : NULL;
@@ -641,12 +1001,22 @@ void qdpn_connector_close(qdpn_connector_t *ctor)
     if (!ctor) return;
 
     ctor->status = 0;
+#if USE_EPOLL
+    if (!ctor->closed)
+        qdpn_epoll_ctl(ctor->driver, EPOLL_CTL_DEL, ctor->fd, 0, 0);
+#endif
     if (close(ctor->fd) == -1)
         perror("close");
     if (!ctor->closed) {
+        qd_log(ctor->driver->log, QD_LOG_DEBUG,
+               "Closed %s: %"PRIu64" octets in, %"PRIu64" octets out, %"PRIu64" I/O budget yields",
+               ctor->name, ctor->octets_in, ctor->octets_out, ctor->io_yields);
         sys_mutex_lock(ctor->driver->lock);
         ctor->closed = true;
         ctor->driver->closed_count++;
+#if USE_EPOLL
+        qdpn_connector_schedule_LH(ctor->driver, ctor);
+#endif
         sys_mutex_unlock(ctor->driver->lock);
     }
 }
@@ -676,6 +1046,13 @@ void qdpn_connector_free(qdpn_connector_t *ctor)
 
 void qdpn_connector_activate(qdpn_connector_t *ctor, qdpn_activate_criteria_t crit)
 {
+#if USE_EPOLL
+    qdpn_driver_t *d = ctor->driver;
+    if (!d)
+        return;
+    sys_mutex_lock(d->lock);
+#endif
+
     switch (crit) {
     case QDPN_CONNECTOR_WRITABLE :
         ctor->status |= PN_SEL_WR;
@@ -685,6 +1062,20 @@ void qdpn_connector_activate(qdpn_connector_t *ctor, qdpn_activate_criteria_t cr
         ctor->status |= PN_SEL_RD;
         break;
     }
+
+#if USE_EPOLL
+    //
+    // If the latched readiness was handed to the application, there may be no
+    // further edge to report the socket's state.  Re-arming the registration
+    // causes epoll to report any readiness that is currently in effect.
+    //
+    if (ctor->repoll && !ctor->closed) {
+        ctor->repoll = false;
+        qdpn_epoll_ctl(d, EPOLL_CTL_MOD, ctor->fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, qdpn_epoll_tag(d, ctor->slot));
+    }
+    qdpn_connector_schedule_LH(d, ctor);
+    sys_mutex_unlock(d->lock);
+#endif
 }
 
 
@@ -694,6 +1085,9 @@ void qdpn_activate_all(qdpn_driver_t *d)
     qdpn_connector_t *c = DEQ_HEAD(d->connectors);
     while (c) {
         c->status |= PN_SEL_WR;
+#if USE_EPOLL
+        qdpn_connector_schedule_LH(d, c);
+#endif
         c = DEQ_NEXT(c);
     }
     sys_mutex_unlock(d->lock);
@@ -704,6 +1098,24 @@ bool qdpn_connector_activated(qdpn_connector_t *ctor, qdpn_activate_criteria_t c
 {
     bool result = false;
 
+#if USE_EPOLL
+    sys_mutex_lock(ctor->driver->lock);
+    switch (crit) {
+    case QDPN_CONNECTOR_WRITABLE :
+        result = ctor->writable;
+        ctor->writable = false;
+        ctor->status &= ~PN_SEL_WR;
+        break;
+
+    case QDPN_CONNECTOR_READABLE :
+        result = ctor->readable;
+        ctor->readable = false;
+        ctor->status &= ~PN_SEL_RD;
+        break;
+    }
+    ctor->repoll = true;
+    sys_mutex_unlock(ctor->driver->lock);
+#else
     switch (crit) {
     case QDPN_CONNECTOR_WRITABLE :
         result = ctor->pending_write;
@@ -717,10 +1129,38 @@ bool qdpn_connector_activated(qdpn_connector_t *ctor, qdpn_activate_criteria_t c
         ctor->status &= ~PN_SEL_RD;
         break;
     }
+#endif
 
     return result;
 }
 
+
+void qdpn_connector_serviced(qdpn_connector_t *ctor, bool work_done)
+{
+    qdpn_driver_t *d = ctor->driver;
+    if (!d)
+        return;
+
+#if USE_EPOLL
+    //
+    // Readiness that arrived while the connector was owned by a thread could
+    // not be acted upon.  Re-schedule the connector now that it is available.
+    //
+    sys_mutex_lock(d->lock);
+    bool scheduled = qdpn_connector_schedule_LH(d, ctor);
+    sys_mutex_unlock(d->lock);
+    if (scheduled)
+        qdpn_driver_wakeup(d);
+#else
+    //
+    // Wake up the driver to force it to reconsider its set of FDs in light
+    // of the processing that just occurred.
+    //
+    if (work_done)
+        qdpn_driver_wakeup(d);
+#endif
+}
+
 static pn_timestamp_t qdpn_connector_tick(qdpn_connector_t *ctor, pn_timestamp_t now)
 {
     if (!ctor->transport) return 0;
@@ -734,6 +1174,22 @@ void qdpn_connector_process(qdpn_connector_t *c)
 
         pn_transport_t *transport = c->transport;
 
+        c->io_passes++;
+
+#if USE_EPOLL
+        //
+        // Take the latched readiness for this pass.  Whatever is not used up
+        // is returned to the latch when the pass is complete.
+        //
+        sys_mutex_lock(c->driver->lock);
+        c->pending_read  = c->readable;
+        c->pending_write = c->writable;
+        c->pending_tick  = false;
+        c->readable      = false;
+        c->writable      = false;
+        sys_mutex_unlock(c->driver->lock);
+#endif
+
         ///
         /// Socket read
         ///
@@ -756,6 +1212,11 @@ void qdpn_connector_process(qdpn_connector_t *c)
                         c->input_done = true;
                         pn_transport_close_tail( transport );
                     } else {
+                        c->io_bytes  += n;
+                        c->octets_in += n;
+                        // A full read may have left data in the socket.
+                        if (n == capacity)
+                            c->pending_read = true;
                         if (pn_transport_process(transport, (size_t) n) < 0) {
                             c->status &= ~PN_SEL_RD;
                             c->input_done = true;
@@ -796,6 +1257,11 @@ void qdpn_connector_process(qdpn_connector_t *c)
                             pn_transport_close_head( transport );
                         }
                     } else if (n) {
+                        c->io_bytes   += n;
+                        c->octets_out += n;
+                        // A full write implies the socket still has room.
+                        if (n == pending)
+                            c->pending_write = true;
                         pn_transport_pop(transport, (size_t) n);
                     }
                 }
@@ -816,9 +1282,64 @@ void qdpn_connector_process(qdpn_connector_t *c)
             }
             qdpn_connector_close(c);
         }
+
+#if USE_EPOLL
+        sys_mutex_lock(c->driver->lock);
+        c->readable |= c->pending_read;
+        c->writable |= c->pending_write;
+        c->pending_read  = false;
+        c->pending_write = false;
+        qdpn_timer_update_LH(c->driver, c);
+        bool earlier = c->driver->waiters && c->wakeup &&
+            (!c->driver->wait_deadline || c->wakeup < c->driver->wait_deadline);
+        if (earlier)
+            c->driver->wait_deadline = c->wakeup;
+        sys_mutex_unlock(c->driver->lock);
+
+        //
+        // If the waiting threads are blocked with a later deadline, wake one so
+        // that it picks up the new one.
+        //
+        if (earlier)
+            qdpn_driver_wakeup(c->driver);
+#endif
     }
 }
 
+bool qdpn_connector_io_ready(qdpn_connector_t *c)
+{
+    if (!c || c->closed)
+        return false;
+
+#if USE_EPOLL
+    //
+    // The latch is written by pollers under the driver lock, but this is only a hint:  a
+    // flag missed here is still latched and gets the connector scheduled again, and one seen
+    // stale costs no more than a read or write that finds EAGAIN.
+    //
+    bool readable = __atomic_load_n(&c->readable, __ATOMIC_RELAXED);
+    bool writable = __atomic_load_n(&c->writable, __ATOMIC_RELAXED);
+#else
+    bool readable = c->pending_read;
+    bool writable = c->pending_write;
+#endif
+
+    bool ready = (readable && !c->input_done  && pn_transport_capacity(c->transport) > 0) ||
+                 (writable && !c->output_done && pn_transport_pending(c->transport) > 0);
+    if (!ready)
+        return false;
+
+    qdpn_driver_t *d = c->driver;
+    if (c->io_passes >= d->io_budget_passes ||
+        (d->io_budget_bytes && c->io_bytes >= d->io_budget_bytes)) {
+        c->io_yields++;
+        return false;
+    }
+
+    return true;
+}
+
+
 // driver
 
 qdpn_driver_t *qdpn_driver()
@@ -832,24 +1353,62 @@ qdpn_driver_t *qdpn_driver()
     d->listener_next = NULL;
     d->connector_next = NULL;
     d->closed_count = 0;
+#if USE_EPOLL
+    DEQ_INIT(d->ready);
+    d->timers = NULL;
+    d->timer_count = 0;
+    d->timer_capacity = 0;
+    d->slots = NULL;
+    d->slot_count = 0;
+    d->slot_free = QDPN_NO_SLOT;
+    d->waiters = 0;
+    d->wait_deadline = 0;
+    d->wakeup_pending = 0;
+    d->broadcast = 0;
+    d->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (d->epfd == -1)
+        qdpn_log_errno(d, "epoll_create1");
+#else
     d->capacity = 0;
     d->fds = NULL;
     d->nfds = 0;
+#endif
     d->ctrl[0] = 0;
     d->ctrl[1] = 0;
     d->trace = ((pn_env_bool("PN_TRACE_RAW") ? PN_TRACE_RAW : PN_TRACE_OFF) |
                 (pn_env_bool("PN_TRACE_FRM") ? PN_TRACE_FRM : PN_TRACE_OFF) |
                 (pn_env_bool("PN_TRACE_DRV") ? PN_TRACE_DRV : PN_TRACE_OFF));
     d->wakeup = 0;
+    d->io_budget_bytes = 0;
+    d->io_budget_passes = 1;
 
     // XXX
     if (pipe(d->ctrl)) {
         perror("Can't create control pipe");
     }
 
+#if USE_EPOLL
+    //
+    // The read side of the control pipe is drained after every wakeup and
+    // must not block once it is empty.  It is edge-triggered: a level-triggered
+    // registration would release every thread blocked in epoll_wait.
+    //
+    int flags = fcntl(d->ctrl[0], F_GETFL);
+    if (fcntl(d->ctrl[0], F_SETFL, flags | O_NONBLOCK) < 0)
+        qdpn_log_errno(d, "fcntl");
+    qdpn_epoll_ctl(d, EPOLL_CTL_ADD, d->ctrl[0], EPOLLIN | EPOLLET, QDPN_EPOLL_CTRL);
+#endif
+
     return d;
 }
 
+void qdpn_driver_set_io_budget(qdpn_driver_t *d, size_t bytes, int passes)
+{
+    d->io_budget_bytes  = bytes;
+    d->io_budget_passes = passes > 0 ? passes : 1;
+}
+
+
 void qdpn_driver_trace(qdpn_driver_t *d, pn_trace_t trace)
 {
     d->trace = trace;
@@ -865,7 +1424,13 @@ void qdpn_driver_free(qdpn_driver_t *d)
         qdpn_connector_free(DEQ_HEAD(d->connectors));
     while (DEQ_HEAD(d->listeners))
         qdpn_listener_free(DEQ_HEAD(d->listeners));
+#if USE_EPOLL
+    close(d->epfd);
+    free(d->timers);
+    free(d->slots);
+#else
     free(d->fds);
+#endif
     sys_mutex_free(d->lock);
     free(d);
 }
@@ -873,6 +1438,14 @@ void qdpn_driver_free(qdpn_driver_t *d)
 int qdpn_driver_wakeup(qdpn_driver_t *d)
 {
     if (d) {
+#if USE_EPOLL
+        //
+        // Wakeups are coalesced.  While one is outstanding, the thread that
+        // consumes it will observe whatever state change prompted this one.
+        //
+        if (__atomic_exchange_n(&d->wakeup_pending, 1, __ATOMIC_ACQ_REL))
+            return 0;
+#endif
         ssize_t count = write(d->ctrl[1], "x", 1);
         if (count <= 0) {
             return count;
@@ -884,6 +1457,145 @@ int qdpn_driver_wakeup(qdpn_driver_t *d)
     }
 }
 
+int qdpn_driver_wakeup_all(qdpn_driver_t *d, int count)
+{
+    if (!d)
+        return PN_ARG_ERR;
+
+#if USE_EPOLL
+    //
+    // A wakeup releases one waiting thread, which relays it to the next until
+    // count threads have been woken.
+    //
+    if (count <= 0)
+        return 0;
+    __atomic_store_n(&d->broadcast, count, __ATOMIC_RELEASE);
+    __atomic_store_n(&d->wakeup_pending, 0, __ATOMIC_RELEASE);
+    return qdpn_driver_wakeup(d);
+#else
+    return qdpn_driver_wakeup(d);
+#endif
+}
+
+bool qdpn_driver_concurrent_wait(qdpn_driver_t *d)
+{
+    return USE_EPOLL;
+}
+
+#if USE_EPOLL
+
+void qdpn_driver_wait_1(qdpn_driver_t *d)
+{
+    //
+    // Nothing to rebuild.  The epoll set is maintained as sockets are added,
+    // removed and closed.
+    //
+}
+
+/**
+ * Latch the readiness reported in a batch of events and schedule the
+ * connectors that need service.
+ */
+static void qdpn_driver_harvest_LH(qdpn_driver_t *d, struct epoll_event *events, int nevents)
+{
+    for (int i = 0; i < nevents; i++) {
+        struct epoll_event *ev   = &events[i];
+        uint64_t            data = ev->data.u64;
+
+        if (data == QDPN_EPOLL_CTRL) {
+            qdpn_driver_woken(d);
+            continue;
+        }
+
+        bool  listener = false;
+        void *object   = qdpn_epoll_object_LH(d, data, &listener);
+        if (!object)
+            continue;
+
+        if (listener) {
+            qdpn_listener_t *l = (qdpn_listener_t*) object;
+            l->pending = !l->closed;
+            continue;
+        }
+
+        qdpn_connector_t *c = (qdpn_connector_t*) object;
+        if (c->closed)
+            continue;
+        if (ev->events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+            c->readable = true;
+        if (ev->events & (EPOLLOUT | EPOLLHUP))
+            c->writable = true;
+        if (ev->events & EPOLLERR)
+            c->socket_error = true;
+        if ((ev->events & (EPOLLHUP | EPOLLRDHUP)) && (c->trace & (PN_TRACE_FRM | PN_TRACE_RAW | PN_TRACE_DRV)))
+            fprintf(stderr, "hangup on connector %s\n", c->name);
+        qdpn_connector_schedule_LH(d, c);
+    }
+}
+
+int qdpn_driver_wait_2(qdpn_driver_t *d, int timeout)
+{
+    struct epoll_event events[QDPN_EPOLL_BATCH];
+
+    sys_mutex_lock(d->lock);
+    pn_timestamp_t wakeup = d->timer_count ? d->timers[0]->wakeup : 0;
+    bool           ready  = !DEQ_IS_EMPTY(d->ready);
+    if (!d->waiters || !d->wait_deadline || (wakeup && wakeup < d->wait_deadline))
+        d->wait_deadline = wakeup;
+    d->waiters++;
+    sys_mutex_unlock(d->lock);
+
+    if (ready)
+        timeout = 0;
+    else if (wakeup) {
+        pn_timestamp_t now = pn_i_now();
+        if (now >= wakeup)
+            timeout = 0;
+        else
+            timeout = (timeout < 0) ? wakeup-now : pn_min(timeout, wakeup - now);
+    }
+
+    int result = epoll_wait(d->epfd, events, QDPN_EPOLL_BATCH, timeout);
+    int error  = errno;
+    if (result == -1 && error != EINTR)
+        qdpn_log_errno(d, "epoll_wait");
+
+    sys_mutex_lock(d->lock);
+    d->waiters--;
+    if (result > 0)
+        qdpn_driver_harvest_LH(d, events, result);
+    sys_mutex_unlock(d->lock);
+
+    errno = error;
+    return result;
+}
+
+int qdpn_driver_wait_3(qdpn_driver_t *d)
+{
+    bool woken = qdpn_woken;
+    qdpn_woken = false;
+
+    sys_mutex_lock(d->lock);
+
+    //
+    // Schedule the connectors whose tick timers have expired.
+    //
+    pn_timestamp_t now = pn_i_now();
+    while (d->timer_count && d->timers[0]->wakeup <= now) {
+        qdpn_connector_t *c = d->timers[0];
+        qdpn_timer_remove_LH(d, c);
+        c->pending_tick = true;
+        qdpn_connector_schedule_LH(d, c);
+    }
+
+    d->listener_next = DEQ_HEAD(d->listeners);
+    sys_mutex_unlock(d->lock);
+
+    return woken ? PN_INTR : 0;
+}
+
+#else
+
 static void qdpn_driver_rebuild(qdpn_driver_t *d)
 {
     sys_mutex_lock(d->lock);
@@ -1006,10 +1718,13 @@ int qdpn_driver_wait_3(qdpn_driver_t *d)
     return woken ? PN_INTR : 0;
 }
 
+#endif
+
 //
 // XXX - pn_driver_wait has been divided into three internal functions as a
 //       temporary workaround for a multi-threading problem.  A multi-threaded
-//       application must hold a lock on parts 1 and 3, but not on part 2.
+//       application must hold a lock on part 1, but not on parts 2 and 3.  Unless
+//       qdpn_driver_concurrent_wait is true, only one thread may be in parts 2 and 3.
 //       This temporary change, which is not reflected in the driver's API, allows
 //       a multi-threaded application to use the three parts separately.
 //
@@ -1035,6 +1750,10 @@ qdpn_listener_t *qdpn_driver_listener(qdpn_driver_t *d)
         d->listener_next = DEQ_NEXT(l);
 
         if (l->pending) {
+#if USE_EPOLL
+            // Listeners are level-triggered, a remaining backlog is reported again.
+            l->pending = false;
+#endif
             sys_mutex_unlock(d->lock);
             return l;
         }
@@ -1048,12 +1767,26 @@ qdpn_connector_t *qdpn_driver_connector(qdpn_driver_t *d)
 {
     if (!d) return NULL;
 
+#if USE_EPOLL
+    sys_mutex_lock(d->lock);
+    qdpn_connector_t *c = DEQ_HEAD(d->ready);
+    if (c) {
+        DEQ_REMOVE_HEAD_N(READY, d->ready);
+        c->in_ready  = false;
+        c->io_bytes  = 0;
+        c->io_passes = 0;
+    }
+    sys_mutex_unlock(d->lock);
+    return c;
+#else
     sys_mutex_lock(d->lock);
     while (d->connector_next) {
         qdpn_connector_t *c = d->connector_next;
         d->connector_next = DEQ_NEXT(c);
 
         if (c->closed || c->pending_read || c->pending_write || c->pending_tick || c->socket_error) {
+            c->io_bytes  = 0;
+            c->io_passes = 0;
             sys_mutex_unlock(d->lock);
             return c;
         }
@@ -1061,5 +1794,6 @@ qdpn_connector_t *qdpn_driver_connector(qdpn_driver_t *d)
 
     sys_mutex_unlock(d->lock);
     return NULL;
+#endif
 }
 
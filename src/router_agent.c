@@ -41,11 +41,15 @@ ENUM_DEFINE(qd_router_mode, qd_router_mode_names);
 qd_error_t qd_entity_refresh_router(qd_entity_t* entity, void *impl) {
     qd_dispatch_t *qd = (qd_dispatch_t*) impl;
     qd_router_t *router = qd->router;
+    uint64_t stolen, requeued;
+    qd_server_work_stats(qd->server, &stolen, &requeued);
     if (qd_entity_set_string(entity, "area", router->router_area) == 0 &&
         qd_entity_set_string(entity, "mode", qd_router_mode_name(router->router_mode)) == 0 &&
         qd_entity_set_long(entity, "addrCount", 0) == 0 &&
         qd_entity_set_long(entity, "linkCount", 0) == 0 &&
-        qd_entity_set_long(entity, "nodeCount", 0) == 0
+        qd_entity_set_long(entity, "nodeCount", 0) == 0 &&
+        qd_entity_set_long(entity, "workItemsStolen", stolen) == 0 &&
+        qd_entity_set_long(entity, "workItemsRequeued", requeued) == 0
     )
         return QD_ERROR_NONE;
     return qd_error_code();
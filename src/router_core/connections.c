@@ -110,6 +110,23 @@ void *qdr_connection_get_context(const qdr_connection_t *conn)
 }
 
 
+/**
+ * Move all the link references on one of the connection's work lists to a private list.
+ * Each link is marked as no longer being on the work list so the core can add it again.
+ */
+static bool qdr_connection_take_link_refs(qdr_connection_t *conn, qdr_link_ref_list_t *list,
+                                          qdr_link_ref_list_t *refs, int cls)
+{
+    sys_mutex_lock(conn->work_lock);
+    DEQ_MOVE(*list, *refs);
+    for (qdr_link_ref_t *ref = DEQ_HEAD(*refs); ref; ref = DEQ_NEXT(ref))
+        ref->link->ref[cls] = 0;
+    sys_mutex_unlock(conn->work_lock);
+
+    return !DEQ_IS_EMPTY(*refs);
+}
+
+
 int qdr_connection_process(qdr_connection_t *conn)
 {
     qdr_connection_work_list_t  work_list;
@@ -154,41 +171,33 @@ int qdr_connection_process(qdr_connection_t *conn)
         work = DEQ_HEAD(work_list);
     }
 
-    qdr_link_ref_t *ref;
-    qdr_link_t     *link;
-
-    do {
-        sys_mutex_lock(conn->work_lock);
-        ref = DEQ_HEAD(conn->links_with_deliveries);
-        if (ref) {
-            link = ref->link;
-            qdr_del_link_ref(&conn->links_with_deliveries, ref->link, QDR_LINK_LIST_CLASS_DELIVERY);
-        } else
-            link = 0;
-        sys_mutex_unlock(conn->work_lock);
-
-        if (link) {
-            core->push_handler(core->user_context, link);
+    qdr_link_ref_list_t  refs;
+    qdr_link_ref_t      *ref;
+
+    //
+    // Take the whole list of links with deliveries, then the whole list of links with
+    // credit, each under one acquisition of the lock.  A link that the core adds back
+    // while its list is being handled is picked up by the next round.
+    //
+    while (qdr_connection_take_link_refs(conn, &conn->links_with_deliveries, &refs, QDR_LINK_LIST_CLASS_DELIVERY)) {
+        while ((ref = DEQ_HEAD(refs))) {
+            DEQ_REMOVE_HEAD(refs);
+            core->push_handler(core->user_context, ref->link);
+            free_qdr_link_ref_t(ref);
             event_count++;
         }
-    } while (link);
-
-    do {
-        sys_mutex_lock(conn->work_lock);
-        ref = DEQ_HEAD(conn->links_with_credit);
-        if (ref) {
-            link = ref->link;
-            qdr_del_link_ref(&conn->links_with_credit, ref->link, QDR_LINK_LIST_CLASS_FLOW);
-        } else
-            link = 0;
-        sys_mutex_unlock(conn->work_lock);
-
-        if (link) {
+    }
+
+    while (qdr_connection_take_link_refs(conn, &conn->links_with_credit, &refs, QDR_LINK_LIST_CLASS_FLOW)) {
+        while ((ref = DEQ_HEAD(refs))) {
+            qdr_link_t *link = ref->link;
+            DEQ_REMOVE_HEAD(refs);
             core->flow_handler(core->user_context, link, link->incremental_credit);
             link->incremental_credit = 0;
+            free_qdr_link_ref_t(ref);
             event_count++;
         }
-    } while (link);
+    }
 
     return event_count;
 }
@@ -349,12 +358,43 @@ void qdr_connection_handlers(qdr_core_t                *core,
 // In-Thread Functions
 //==================================================================================
 
+//
+// While a batch of deliveries is being forwarded, activations are collected here and issued
+// once per connection at the end of the batch.
+//
+#define QDR_DEFERRED_ACTIVATIONS 16
+static __thread bool              activation_deferred = false;
+static __thread int               deferred_count = 0;
+static __thread qdr_connection_t *deferred_conns[QDR_DEFERRED_ACTIVATIONS];
+
+
 void qdr_connection_activate_CT(qdr_core_t *core, qdr_connection_t *conn)
 {
+    if (activation_deferred) {
+        for (int i = 0; i < deferred_count; i++)
+            if (deferred_conns[i] == conn)
+                return;
+        if (deferred_count < QDR_DEFERRED_ACTIVATIONS) {
+            deferred_conns[deferred_count++] = conn;
+            return;
+        }
+    }
+
     core->activate_handler(core->user_context, conn);
 }
 
 
+void qdr_connection_defer_activations_CT(qdr_core_t *core, bool defer)
+{
+    activation_deferred = defer;
+    if (!defer) {
+        for (int i = 0; i < deferred_count; i++)
+            core->activate_handler(core->user_context, deferred_conns[i]);
+        deferred_count = 0;
+    }
+}
+
+
 void qdr_connection_enqueue_work_CT(qdr_core_t            *core,
                                     qdr_connection_t      *conn,
                                     qdr_connection_work_t *work)
@@ -992,6 +1032,7 @@ static void qdr_link_inbound_first_attach_CT(qdr_core_t *core, qdr_action_t *act
                     // to do an address lookup for deliveries that arrive on this link.
                     //
                     link->owning_addr = addr;
+                    qdr_link_set_shard_CT(core, link);
                     qdr_add_link_ref(&addr->inlinks, link, QDR_LINK_LIST_CLASS_ADDRESS);
                     qdr_link_outbound_second_attach_CT(core, link, source, target);
 
@@ -1106,6 +1147,7 @@ static void qdr_link_inbound_second_attach_CT(qdr_core_t *core, qdr_action_t *ac
                     link->auto_link->state = QDR_AUTO_LINK_STATE_ACTIVE;
                     qdr_add_link_ref(&link->auto_link->addr->inlinks, link, QDR_LINK_LIST_CLASS_ADDRESS);
                     link->owning_addr = link->auto_link->addr;
+                    qdr_link_set_shard_CT(core, link);
                 }
             }
 
@@ -1199,6 +1241,7 @@ static void qdr_link_inbound_detach_CT(qdr_core_t *core, qdr_action_t *action, b
     }
 
     link->owning_addr = 0;
+    link->shard       = 0;
 
     if (link->link_direction == QD_INCOMING) {
         //
@@ -73,14 +73,11 @@ static bool qdr_forward_attach_null_CT(qdr_core_t     *core,
 
 qdr_delivery_t *qdr_forward_new_delivery_CT(qdr_core_t *core, qdr_delivery_t *in_dlv, qdr_link_t *link, qd_message_t *msg)
 {
-    qdr_delivery_t *dlv = new_qdr_delivery_t();
+    qdr_delivery_t *dlv = qdr_delivery(link, qd_message_copy(msg), !in_dlv || in_dlv->settled,
+                                       in_dlv ? in_dlv->shard : 0);
     uint64_t       *tag = (uint64_t*) dlv->tag;
 
-    ZERO(dlv);
-    dlv->link    = link;
-    dlv->msg     = qd_message_copy(msg);
-    dlv->settled = !in_dlv || in_dlv->settled;
-    *tag         = core->next_tag++;
+    *tag            = __atomic_fetch_add(&core->next_tag, 1, __ATOMIC_RELAXED);
     dlv->tag_length = 8;
 
     //
@@ -227,15 +224,18 @@ int qdr_forward_multicast_CT(qdr_core_t      *core,
         }
 
         //
-        // Send a copy of the message outbound on each identified link.
+        // Send a copy of the message outbound on each identified link, other than those
+        // leading back to routers the message has already passed through.
         //
+        if (link_exclusion)
+            qd_bitmask_andnot(link_set, link_exclusion);
+
         int link_bit;
-        while (qd_bitmask_first_set(link_set, &link_bit)) {
-            qd_bitmask_clear_bit(link_set, link_bit);
+        for (QD_BITMASK_EACH(link_set, link_bit, c)) {
             dest_link = control ?
                 core->control_links_by_mask_bit[link_bit] :
                 core->data_links_by_mask_bit[link_bit];
-            if (dest_link && (!link_exclusion || qd_bitmask_value(link_exclusion, link_bit) == 0)) {
+            if (dest_link) {
                 qdr_delivery_t *out_delivery = qdr_forward_new_delivery_CT(core, in_delivery, dest_link, msg);
                 qdr_forward_deliver_CT(core, dest_link, out_delivery);
                 fanout++;
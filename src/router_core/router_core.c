@@ -23,7 +23,16 @@
 ALLOC_DEFINE(qdr_address_t);
 ALLOC_DEFINE(qdr_address_config_t);
 ALLOC_DEFINE(qdr_node_t);
+#if USE_MEMORY_POOL
+//
+// Deliveries come from cache-line aligned slabs so that their hot fields stay in one line.
+//
+static qd_alloc_config_t qdr_delivery_alloc_config = {64, 128, 0, QDR_DELIVERY_HOT_SIZE};
+
+ALLOC_DEFINE_CONFIG(qdr_delivery_t, sizeof(qdr_delivery_t), 0, &qdr_delivery_alloc_config);
+#else
 ALLOC_DEFINE(qdr_delivery_t);
+#endif
 ALLOC_DEFINE(qdr_delivery_ref_t);
 ALLOC_DEFINE(qdr_link_t);
 ALLOC_DEFINE(qdr_router_ref_t);
@@ -33,7 +42,7 @@ ALLOC_DEFINE(qdr_connection_ref_t);
 
 static void qdr_general_handler(void *context);
 
-qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area, const char *id)
+qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area, const char *id, int core_threads)
 {
     qdr_core_t *core = NEW(qdr_core_t);
     ZERO(core);
@@ -49,12 +58,21 @@ qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area,
     core->log = qd_log_source("ROUTER_CORE");
 
     //
-    // Set up the threading support
+    // Set up the threading support.  There is one shard per core thread.
     //
-    core->action_cond = sys_cond();
-    core->action_lock = sys_mutex();
+    if (core_threads < 1)
+        core_threads = 1;
     core->running     = true;
-    DEQ_INIT(core->action_list);
+    core->shard_count = core_threads;
+    core->shards      = NEW_ARRAY(qdr_core_shard_t, core_threads);
+    for (int i = 0; i < core_threads; i++) {
+        qdr_core_shard_t *shard = &core->shards[i];
+        ZERO(shard);
+        shard->core        = core;
+        shard->index       = i;
+        shard->exec_lock   = sys_mutex();
+        qdr_action_queue_init(&shard->actions);
+    }
 
     core->work_lock = sys_mutex();
     DEQ_INIT(core->work_list);
@@ -67,9 +85,11 @@ qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area,
     core->id_lock = sys_mutex();
 
     //
-    // Launch the core thread
+    // Launch the core threads
     //
-    core->thread = sys_thread(router_core_thread, core);
+    core->shards[0].thread = sys_thread(router_core_thread, core);
+    for (int i = 1; i < core->shard_count; i++)
+        core->shards[i].thread = sys_thread(router_core_shard_thread, &core->shards[i]);
 
     //
     // Perform outside-of-thread setup for the management agent
@@ -88,20 +108,27 @@ qdr_core_t *qdr_core(qd_dispatch_t *qd, qd_router_mode_t mode, const char *area,
 void qdr_core_free(qdr_core_t *core)
 {
     //
-    // Stop and join the thread
+    // Stop and join the threads
     //
     core->running = false;
-    sys_cond_signal(core->action_cond);
-    sys_thread_join(core->thread);
+    for (int i = 0; i < core->shard_count; i++) {
+        qdr_core_shard_t *shard = &core->shards[i];
+        qdr_action_queue_wake(&shard->actions);
+        sys_thread_join(shard->thread);
+    }
 
     //
     // Free the core resources
     //
     qdr_core_unsubscribe(core->agent_subscription_mobile);
     qdr_core_unsubscribe(core->agent_subscription_local);
-    sys_thread_free(core->thread);
-    sys_cond_free(core->action_cond);
-    sys_mutex_free(core->action_lock);
+    for (int i = 0; i < core->shard_count; i++) {
+        qdr_core_shard_t *shard = &core->shards[i];
+        sys_thread_free(shard->thread);
+        qdr_action_queue_final(&shard->actions);
+        sys_mutex_free(shard->exec_lock);
+    }
+    free(core->shards);
     sys_mutex_free(core->work_lock);
     sys_mutex_free(core->id_lock);
     qd_timer_free(core->work_timer);
@@ -198,10 +225,49 @@ qdr_action_t *qdr_action(qdr_action_handler_t action_handler, const char *label)
 
 void qdr_action_enqueue(qdr_core_t *core, qdr_action_t *action)
 {
-    sys_mutex_lock(core->action_lock);
-    DEQ_INSERT_TAIL(core->action_list, action);
-    sys_cond_signal(core->action_cond);
-    sys_mutex_unlock(core->action_lock);
+    qdr_action_enqueue_shard(core, action, 0);
+}
+
+
+void qdr_action_enqueue_shard(qdr_core_t *core, qdr_action_t *action, int shard)
+{
+    qdr_core_shard_t *target = &core->shards[shard < core->shard_count ? shard : 0];
+
+    //
+    // Deliveries collected by this thread were made before this action, so they go first.
+    //
+    qdr_link_deliver_flush(core);
+    qdr_action_queue_push(&target->actions, action);
+}
+
+
+/**
+ * Choose the shard that will process deliveries arriving on an incoming link.  Only
+ * endpoint links that are bound to an address are moved off the control shard; an
+ * address is assigned to a worker shard by the hash of its key the first time it is
+ * needed and keeps that shard for its lifetime.
+ */
+void qdr_link_set_shard_CT(qdr_core_t *core, qdr_link_t *link)
+{
+    qdr_address_t *addr = link->owning_addr;
+
+    link->shard = 0;
+    if (core->shard_count < 2 || !addr || link->link_direction != QD_INCOMING ||
+        link->link_type != QD_LINK_ENDPOINT || link->connected_link)
+        return;
+
+    if (addr->shard == 0) {
+        const char *key = (const char*) qd_hash_key_by_handle(addr->hash_handle);
+        if (!key)
+            return;
+
+        qd_field_iterator_t *iter = qd_field_iterator_string(key);
+        uint32_t             hash = qd_iterator_hash_function(iter);
+        qd_field_iterator_free(iter);
+        addr->shard = 1 + (int) (hash % (uint32_t) (core->shard_count - 1));
+    }
+
+    link->shard = addr->shard;
 }
 
 
@@ -309,6 +375,27 @@ void qdr_del_node_ref(qdr_router_ref_list_t *ref_list, qdr_node_t *rnode)
 }
 
 
+qdr_delivery_t *qdr_delivery(qdr_link_t *link, qd_message_t *msg, bool settled, int shard)
+{
+    qdr_delivery_t *dlv = new_qdr_delivery_t();
+
+    DEQ_ITEM_INIT(dlv);
+    dlv->link           = link;
+    dlv->msg            = msg;
+    dlv->peer           = 0;
+    dlv->disposition    = 0;
+    dlv->settled        = settled;
+    dlv->where          = QDR_DELIVERY_NOWHERE;
+    dlv->shard          = shard;
+    dlv->tag_length     = 0;
+    dlv->context        = 0;
+    dlv->to_addr        = 0;
+    dlv->origin         = 0;
+    dlv->link_exclusion = 0;
+    return dlv;
+}
+
+
 void qdr_add_delivery_ref(qdr_delivery_ref_list_t *list, qdr_delivery_t *dlv)
 {
     qdr_delivery_ref_t *ref = new_qdr_delivery_ref_t();
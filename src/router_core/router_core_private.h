@@ -23,7 +23,9 @@
 #include <qpid/dispatch/router_core.h>
 #include <qpid/dispatch/threading.h>
 #include <qpid/dispatch/log.h>
+#include <qpid/dispatch/static_assert.h>
 #include <memory.h>
+#include <stddef.h>
 
 typedef struct qdr_address_t         qdr_address_t;
 typedef struct qdr_address_config_t  qdr_address_config_t;
@@ -69,6 +71,8 @@ char *qdr_field_copy(qdr_field_t *field);
 typedef struct qdr_action_t qdr_action_t;
 typedef void (*qdr_action_handler_t) (qdr_core_t *core, qdr_action_t *action, bool discard);
 
+DEQ_DECLARE(qdr_delivery_t, qdr_delivery_list_t);
+
 struct qdr_action_t {
     DEQ_LINKS(qdr_action_t);
     qdr_action_handler_t  action_handler;
@@ -106,6 +110,13 @@ struct qdr_action_t {
             int               tag_length;
         } connection;
 
+        //
+        // Arguments for a batch of deliveries from one thread
+        //
+        struct {
+            qdr_delivery_list_t deliveries;
+        } batch;
+
         //
         // Arguments for delivery state updates
         //
@@ -146,6 +157,44 @@ struct qdr_action_t {
 ALLOC_DECLARE(qdr_action_t);
 DEQ_DECLARE(qdr_action_t, qdr_action_list_t);
 
+/**
+ * qdr_action_queue_t - Multi-producer, single-consumer queue of actions.
+ *
+ * Producers push onto a lock-free stack; the consumer takes the whole stack at once and
+ * reverses it into arrival order.  The mutex and condition variable are used only to put the
+ * consumer to sleep, and a producer touches them only when the consumer is sleeping.
+ */
+typedef struct qdr_action_queue_t {
+    qdr_action_t *stack;     ///< Pushed actions, newest first
+    int           sleeping;  ///< Non-zero while the consumer is (about to be) waiting
+    bool          woken;     ///< Set by qdr_action_queue_wake to end a wait with nothing queued
+    sys_mutex_t  *lock;
+    sys_cond_t   *cond;
+} qdr_action_queue_t;
+
+void qdr_action_queue_init(qdr_action_queue_t *queue);
+void qdr_action_queue_final(qdr_action_queue_t *queue);
+void qdr_action_queue_push(qdr_action_queue_t *queue, qdr_action_t *action);
+void qdr_action_queue_take(qdr_action_queue_t *queue, qdr_action_list_t *list);
+void qdr_action_queue_wait(qdr_action_queue_t *queue);
+void qdr_action_queue_wake(qdr_action_queue_t *queue);
+
+/**
+ * qdr_core_shard_t - One router-core thread and its action queue.
+ *
+ * Shard 0 is the control shard.  It runs every action that is not explicitly directed
+ * elsewhere (link setup, route table and management changes, anonymous and link-routed
+ * deliveries) and it runs them with all other shards stopped.  Shards 1..N-1 run only the
+ * deliveries on incoming links whose owning address hashes to that shard.
+ */
+typedef struct qdr_core_shard_t {
+    qdr_core_t         *core;
+    int                 index;
+    sys_thread_t       *thread;
+    qdr_action_queue_t  actions;
+    sys_mutex_t        *exec_lock;   ///< Held by a worker shard while it runs actions
+} qdr_core_shard_t;
+
 #define QDR_AGENT_MAX_COLUMNS 64
 #define QDR_AGENT_COLUMN_NULL (QDR_AGENT_MAX_COLUMNS + 1)
 
@@ -194,24 +243,41 @@ typedef enum {
     QDR_DELIVERY_IN_UNSETTLED
 } qdr_delivery_where_t;
 
+//
+// The fields used to forward, queue and settle a delivery come first, so that they share the
+// first cache line of the delivery.  Deliveries are allocated from slabs aligned to cache lines.
+// The fields that follow are used only when the delivery enters the core or meets its Proton
+// delivery.
+//
 struct qdr_delivery_t {
     DEQ_LINKS(qdr_delivery_t);
-    void                *context;
     qdr_link_t          *link;
-    qdr_delivery_t      *peer;
     qd_message_t        *msg;
-    qd_field_iterator_t *to_addr;
-    qd_field_iterator_t *origin;
+    qdr_delivery_t      *peer;
     uint64_t             disposition;
     bool                 settled;
     qdr_delivery_where_t where;
-    uint8_t              tag[32];
+    int                  shard;          ///< Core shard that processes this delivery
     int                  tag_length;
+
+    void                *context;
+    qd_field_iterator_t *to_addr;
+    qd_field_iterator_t *origin;
     qd_bitmask_t        *link_exclusion;
+    uint8_t              tag[32];        ///< Valid only up to tag_length
 };
 
+#define QDR_DELIVERY_HOT_SIZE 64
+
+STATIC_ASSERT(offsetof(qdr_delivery_t, context) <= QDR_DELIVERY_HOT_SIZE, qdr_delivery_hot_fields_fit_one_cache_line);
+
 ALLOC_DECLARE(qdr_delivery_t);
-DEQ_DECLARE(qdr_delivery_t, qdr_delivery_list_t);
+
+/**
+ * Allocate a delivery for a link.  Every field but the tag is set here, so the delivery isn't
+ * zeroed first.
+ */
+qdr_delivery_t *qdr_delivery(qdr_link_t *link, qd_message_t *msg, bool settled, int shard);
 
 typedef struct qdr_delivery_ref_t {
     DEQ_LINKS(struct qdr_delivery_ref_t);
@@ -265,6 +331,7 @@ struct qdr_link_t {
     bool                     drain_mode;
     int                      credit_to_core; ///< Number of the available credits incrementally given to the core
     uint64_t                 total_deliveries;
+    int                      shard;          ///< Core shard for deliveries arriving on this link
 };
 
 ALLOC_DECLARE(qdr_link_t);
@@ -318,6 +385,7 @@ struct qdr_address_t {
     int                        ref_count;     ///< Number of link-routes + auto-links referencing this address
     bool                       block_deletion;
     bool                       local;
+    int                        shard;         ///< Core shard owning this address's deliveries (0 until assigned)
 
     /**@name Statistics */
     ///@{
@@ -483,11 +551,9 @@ ALLOC_DECLARE(qdr_conn_identifier_t);
 struct qdr_core_t {
     qd_dispatch_t     *qd;
     qd_log_source_t   *log;
-    sys_thread_t      *thread;
     bool               running;
-    qdr_action_list_t  action_list;
-    sys_cond_t        *action_cond;
-    sys_mutex_t       *action_lock;
+    qdr_core_shard_t  *shards;
+    int                shard_count;
 
     sys_mutex_t             *work_lock;
     qdr_general_work_list_t  work_list;
@@ -560,6 +626,9 @@ struct qdr_core_t {
 };
 
 void *router_core_thread(void *arg);
+void *router_core_shard_thread(void *arg);
+int qdr_core_current_shard(void);
+void qdr_core_set_current_shard(int shard);
 uint64_t qdr_identifier(qdr_core_t* core);
 void qdr_management_agent_on_message(void *context, qd_message_t *msg, int unused_link_id);
 void  qdr_route_table_setup_CT(qdr_core_t *core);
@@ -567,6 +636,8 @@ void  qdr_agent_setup_CT(qdr_core_t *core);
 void  qdr_forwarder_setup_CT(qdr_core_t *core);
 qdr_action_t *qdr_action(qdr_action_handler_t action_handler, const char *label);
 void qdr_action_enqueue(qdr_core_t *core, qdr_action_t *action);
+void qdr_action_enqueue_shard(qdr_core_t *core, qdr_action_t *action, int shard);
+void qdr_link_set_shard_CT(qdr_core_t *core, qdr_link_t *link);
 void qdr_link_issue_credit_CT(qdr_core_t *core, qdr_link_t *link, int credit);
 void qdr_addr_start_inlinks_CT(qdr_core_t *core, qdr_address_t *addr);
 void qdr_delivery_push_CT(qdr_core_t *core, qdr_delivery_t *dlv);
@@ -585,6 +656,7 @@ void qdr_check_addr_CT(qdr_core_t *core, qdr_address_t *addr, bool was_local);
 qdr_delivery_t *qdr_forward_new_delivery_CT(qdr_core_t *core, qdr_delivery_t *peer, qdr_link_t *link, qd_message_t *msg);
 void qdr_forward_deliver_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv);
 void qdr_connection_activate_CT(qdr_core_t *core, qdr_connection_t *conn);
+void qdr_connection_defer_activations_CT(qdr_core_t *core, bool defer);
 qd_address_treatment_t qdr_treatment_for_address_CT(qdr_core_t *core, qd_field_iterator_t *iter, int *in_phase, int *out_phase);
 qd_address_treatment_t qdr_treatment_for_address_hash_CT(qdr_core_t *core, qd_field_iterator_t *iter);
 
@@ -30,50 +30,193 @@
 ALLOC_DEFINE(qdr_action_t);
 
 
+static __thread int current_shard = 0;
+
+int qdr_core_current_shard(void)
+{
+    return current_shard;
+}
+
+
+void qdr_core_set_current_shard(int shard)
+{
+    current_shard = shard;
+}
+
+
+/**
+ * Process and free all of the action items in the list
+ */
+static void router_core_process_actions(qdr_core_t *core, qdr_action_list_t *action_list)
+{
+    qdr_action_t *action = DEQ_HEAD(*action_list);
+    while (action) {
+        DEQ_REMOVE_HEAD(*action_list);
+        if (action->label)
+            qd_log(core->log, QD_LOG_TRACE, "Core action '%s'%s", action->label, core->running ? "" : " (discard)");
+        action->action_handler(core, action, !core->running);
+        free_qdr_action_t(action);
+        action = DEQ_HEAD(*action_list);
+    }
+}
+
+
+void qdr_action_queue_init(qdr_action_queue_t *queue)
+{
+    queue->stack    = 0;
+    queue->sleeping = 0;
+    queue->woken    = false;
+    queue->lock     = sys_mutex();
+    queue->cond     = sys_cond();
+}
+
+
+void qdr_action_queue_final(qdr_action_queue_t *queue)
+{
+    sys_cond_free(queue->cond);
+    sys_mutex_free(queue->lock);
+}
+
+
+void qdr_action_queue_push(qdr_action_queue_t *queue, qdr_action_t *action)
+{
+    qdr_action_t *top = __atomic_load_n(&queue->stack, __ATOMIC_RELAXED);
+
+    action->prev = 0;
+    do {
+        action->next = top;
+    } while (!__atomic_compare_exchange_n(&queue->stack, &top, action, true,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    //
+    // The consumer publishes that it is sleeping before it makes its last check of the
+    // stack, so either it sees this action or this sees it sleeping.
+    //
+    if (__atomic_load_n(&queue->sleeping, __ATOMIC_SEQ_CST)) {
+        sys_mutex_lock(queue->lock);
+        sys_cond_signal(queue->cond);
+        sys_mutex_unlock(queue->lock);
+    }
+}
+
+
+void qdr_action_queue_take(qdr_action_queue_t *queue, qdr_action_list_t *list)
+{
+    //
+    // Nothing but the consumer removes from the stack, so taking all of it at once is
+    // free of the ABA problem.
+    //
+    qdr_action_t *top = __atomic_exchange_n(&queue->stack, 0, __ATOMIC_ACQUIRE);
+
+    DEQ_INIT(*list);
+    while (top) {
+        qdr_action_t *next = top->next;
+        top->next = 0;
+        DEQ_INSERT_HEAD(*list, top);
+        top = next;
+    }
+}
+
+
+void qdr_action_queue_wait(qdr_action_queue_t *queue)
+{
+    if (__atomic_load_n(&queue->stack, __ATOMIC_ACQUIRE))
+        return;
+
+    sys_mutex_lock(queue->lock);
+    __atomic_store_n(&queue->sleeping, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&queue->stack, __ATOMIC_SEQ_CST) && !queue->woken)
+        sys_cond_wait(queue->cond, queue->lock);
+    __atomic_store_n(&queue->sleeping, 0, __ATOMIC_RELAXED);
+    queue->woken = false;
+    sys_mutex_unlock(queue->lock);
+}
+
+
+/**
+ * Make the consumer return from qdr_action_queue_wait even if nothing is queued.
+ */
+void qdr_action_queue_wake(qdr_action_queue_t *queue)
+{
+    sys_mutex_lock(queue->lock);
+    queue->woken = true;
+    sys_cond_signal(queue->cond);
+    sys_mutex_unlock(queue->lock);
+}
+
+
 void *router_core_thread(void *arg)
 {
-    qdr_core_t        *core = (qdr_core_t*) arg;
+    qdr_core_t        *core    = (qdr_core_t*) arg;
+    qdr_core_shard_t  *control = &core->shards[0];
     qdr_action_list_t  action_list;
-    qdr_action_t      *action;
+    qdr_action_list_t  shard_list;
 
+    qdr_core_set_current_shard(0);
     qdr_forwarder_setup_CT(core);
     qdr_route_table_setup_CT(core);
     qdr_agent_setup_CT(core);
 
     qd_log(core->log, QD_LOG_INFO, "Router Core thread running. %s/%s", core->router_area, core->router_id);
     while (core->running) {
-        //
-        // Use the lock only to protect the condition variable and the action list
-        //
-        sys_mutex_lock(core->action_lock);
+        qdr_action_queue_wait(&control->actions);
 
         //
-        // Block on the condition variable when there is no action to do
-        //
-        while (core->running && DEQ_IS_EMPTY(core->action_list))
-            sys_cond_wait(core->action_cond, core->action_lock);
-
-        //
-        // Move the entire action list to a private list so we can process it without
+        // Take the entire queue as a private list so we can process it without
         // holding the lock
         //
-        DEQ_MOVE(core->action_list, action_list);
-        sys_mutex_unlock(core->action_lock);
+        qdr_action_queue_take(&control->actions, &action_list);
 
         //
-        // Process and free all of the action items in the list
+        // Control actions run with every worker shard stopped.  Anything already queued
+        // to a worker shard was queued before the actions just taken, so it is run first
+        // to keep the deliveries ahead of the link and address changes that follow them.
         //
-        action = DEQ_HEAD(action_list);
-        while (action) {
-            DEQ_REMOVE_HEAD(action_list);
-            if (action->label)
-                qd_log(core->log, QD_LOG_TRACE, "Core action '%s'%s", action->label, core->running ? "" : " (discard)");
-            action->action_handler(core, action, !core->running);
-            free_qdr_action_t(action);
-            action = DEQ_HEAD(action_list);
+        for (int i = 1; i < core->shard_count; i++)
+            sys_mutex_lock(core->shards[i].exec_lock);
+
+        for (int i = 1; i < core->shard_count; i++) {
+            qdr_action_queue_take(&core->shards[i].actions, &shard_list);
+            router_core_process_actions(core, &shard_list);
         }
+
+        router_core_process_actions(core, &action_list);
+
+        for (int i = core->shard_count - 1; i > 0; i--)
+            sys_mutex_unlock(core->shards[i].exec_lock);
     }
 
     qd_log(core->log, QD_LOG_INFO, "Router Core thread exited");
     return 0;
 }
+
+
+/**
+ * Thread for a worker shard.  It forwards the deliveries of the addresses that hash to it,
+ * concurrently with the other worker shards.
+ */
+void *router_core_shard_thread(void *arg)
+{
+    qdr_core_shard_t  *shard = (qdr_core_shard_t*) arg;
+    qdr_core_t        *core  = shard->core;
+    qdr_action_list_t  action_list;
+
+    qdr_core_set_current_shard(shard->index);
+
+    qd_log(core->log, QD_LOG_INFO, "Router Core shard %d running", shard->index);
+    while (core->running) {
+        qdr_action_queue_wait(&shard->actions);
+
+        //
+        // Take the list under the execution lock so the control shard can't run between
+        // the taking and the processing of it.
+        //
+        sys_mutex_lock(shard->exec_lock);
+        qdr_action_queue_take(&shard->actions, &action_list);
+        router_core_process_actions(core, &action_list);
+        sys_mutex_unlock(shard->exec_lock);
+    }
+
+    qd_log(core->log, QD_LOG_INFO, "Router Core shard %d exited", shard->index);
+    return 0;
+}
@@ -23,15 +23,78 @@
 
 
 static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
+static void qdr_link_deliver_batch_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_link_flow_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_send_to_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 static void qdr_update_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
+static void qdr_delivery_continue_CT(qdr_core_t *core, qdr_action_t *action, bool discard);
 
 //==================================================================================
 // Internal Functions
 //==================================================================================
 
 
+//==================================================================================
+// Delivery Batching
+//==================================================================================
+
+//
+// The largest number of outgoing deliveries taken from a link under one acquisition of
+// the connection's work lock.
+//
+#define QDR_PROCESS_BATCH 64
+
+//
+// Deliveries made by a thread that have not yet been handed to the core.  Only the
+// owning thread touches these.
+//
+static __thread qdr_core_t          *batch_core = 0;
+static __thread qdr_delivery_list_t  batch_deliveries;
+
+
+static void qdr_link_deliver_collect(qdr_core_t *core, qdr_delivery_t *dlv)
+{
+    if (batch_core && batch_core != core)
+        qdr_link_deliver_flush(batch_core);
+    batch_core = core;
+    DEQ_ITEM_INIT(dlv);
+    DEQ_INSERT_TAIL(batch_deliveries, dlv);
+}
+
+
+void qdr_link_deliver_flush(qdr_core_t *core)
+{
+    //
+    // The collected deliveries all belong to batch_core; a thread switching cores flushes
+    // the old one in qdr_link_deliver_collect.  Deliveries for a different core have no
+    // ordering relationship with this one's actions, so they are left for their own flush.
+    //
+    if (DEQ_IS_EMPTY(batch_deliveries) || batch_core != core)
+        return;
+
+    //
+    // Make one action per shard, keeping the deliveries in the order they were made.
+    //
+    while (DEQ_HEAD(batch_deliveries)) {
+        qdr_action_t   *action = qdr_action(qdr_link_deliver_batch_CT, "link_deliver_batch");
+        int             shard  = DEQ_HEAD(batch_deliveries)->shard;
+        qdr_delivery_t *dlv    = DEQ_HEAD(batch_deliveries);
+
+        DEQ_INIT(action->args.batch.deliveries);
+        while (dlv) {
+            qdr_delivery_t *next = DEQ_NEXT(dlv);
+            if (dlv->shard == shard) {
+                DEQ_REMOVE(batch_deliveries, dlv);
+                DEQ_INSERT_TAIL(action->args.batch.deliveries, dlv);
+            }
+            dlv = next;
+        }
+
+        qdr_action_queue_push(&core->shards[shard < core->shard_count ? shard : 0].actions, action);
+    }
+}
+
+
 //==================================================================================
 // Interface Functions
 //==================================================================================
@@ -39,19 +102,12 @@ static void qdr_update_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool
 qdr_delivery_t *qdr_link_deliver(qdr_link_t *link, qd_message_t *msg, qd_field_iterator_t *ingress,
                                  bool settled, qd_bitmask_t *link_exclusion)
 {
-    qdr_action_t   *action = qdr_action(qdr_link_deliver_CT, "link_deliver");
-    qdr_delivery_t *dlv    = new_qdr_delivery_t();
+    qdr_delivery_t *dlv = qdr_delivery(link, msg, settled, link->shard);
 
-    ZERO(dlv);
-    dlv->link           = link;
-    dlv->msg            = msg;
-    dlv->to_addr        = 0;
     dlv->origin         = ingress;
-    dlv->settled        = settled;
     dlv->link_exclusion = link_exclusion;
 
-    action->args.connection.delivery = dlv;
-    qdr_action_enqueue(link->core, action);
+    qdr_link_deliver_collect(link->core, dlv);
     return dlv;
 }
 
@@ -60,19 +116,13 @@ qdr_delivery_t *qdr_link_deliver_to(qdr_link_t *link, qd_message_t *msg,
                                     qd_field_iterator_t *ingress, qd_field_iterator_t *addr,
                                     bool settled, qd_bitmask_t *link_exclusion)
 {
-    qdr_action_t   *action = qdr_action(qdr_link_deliver_CT, "link_deliver");
-    qdr_delivery_t *dlv    = new_qdr_delivery_t();
+    qdr_delivery_t *dlv = qdr_delivery(link, msg, settled, link->shard);
 
-    ZERO(dlv);
-    dlv->link           = link;
-    dlv->msg            = msg;
     dlv->to_addr        = addr;
     dlv->origin         = ingress;
-    dlv->settled        = settled;
     dlv->link_exclusion = link_exclusion;
 
-    action->args.connection.delivery = dlv;
-    qdr_action_enqueue(link->core, action);
+    qdr_link_deliver_collect(link->core, dlv);
     return dlv;
 }
 
@@ -84,12 +134,7 @@ qdr_delivery_t *qdr_link_deliver_to_routed_link(qdr_link_t *link, qd_message_t *
         return 0;
     
     qdr_action_t   *action = qdr_action(qdr_link_deliver_CT, "link_deliver");
-    qdr_delivery_t *dlv    = new_qdr_delivery_t();
-
-    ZERO(dlv);
-    dlv->link    = link;
-    dlv->msg     = msg;
-    dlv->settled = settled;
+    qdr_delivery_t *dlv    = qdr_delivery(link, msg, settled, 0);
 
     action->args.connection.delivery = dlv;
     action->args.connection.tag_length = tag_length;
@@ -101,35 +146,62 @@ qdr_delivery_t *qdr_link_deliver_to_routed_link(qdr_link_t *link, qd_message_t *
 
 void qdr_link_process_deliveries(qdr_core_t *core, qdr_link_t *link, int credit)
 {
-    qdr_connection_t *conn = link->conn;
+    qdr_connection_t *conn    = link->conn;
     qdr_delivery_t   *dlv;
     bool              drained = false;
     int               offer   = -1;
-    bool              settled = false;
 
     while (credit > 0 && !drained) {
+        //
+        // Take as many deliveries as there is credit for under one acquisition of the lock.
+        // A message that is still arriving may not be sent in full, and nothing may follow it
+        // on the link until it is, so it ends the batch.
+        //
+        qdr_delivery_t *batch[QDR_PROCESS_BATCH];
+        bool            batch_settled[QDR_PROCESS_BATCH];
+        int             count = 0;
+
         sys_mutex_lock(conn->work_lock);
-        dlv = DEQ_HEAD(link->undelivered);
-        if (dlv) {
+        while (count < credit && count < QDR_PROCESS_BATCH) {
+            dlv = DEQ_HEAD(link->undelivered);
+            if (!dlv) {
+                drained = true;
+                break;
+            }
+
             DEQ_REMOVE_HEAD(link->undelivered);
-            settled = dlv->settled;
-            if (!settled) {
+            batch_settled[count] = dlv->settled;
+            if (!dlv->settled) {
                 DEQ_INSERT_TAIL(link->unsettled, dlv);
                 dlv->where = QDR_DELIVERY_IN_UNSETTLED;
             } else
                 dlv->where = QDR_DELIVERY_NOWHERE;
-            credit--;
+            batch[count++] = dlv;
             link->total_deliveries++;
-            offer = DEQ_SIZE(link->undelivered);
-        } else
-            drained = true;
+
+            if (!qd_message_receive_complete(dlv->msg))
+                break;
+        }
+        offer = DEQ_SIZE(link->undelivered);
         sys_mutex_unlock(conn->work_lock);
 
-        if (dlv) {
-            link->credit_to_core--;
-            core->deliver_handler(core->user_context, link, dlv, settled);
-            if (settled)
-                qdr_delivery_free(dlv);
+        credit               -= count;
+        link->credit_to_core -= count;
+
+        bool sent = true;
+        for (int i = 0; i < count; i++) {
+            sent = core->deliver_handler(core->user_context, link, batch[i], batch_settled[i]);
+            if (batch_settled[i])
+                qdr_delivery_free(batch[i]);
+        }
+
+        //
+        // If the message could not be sent in full, it is still arriving.  The rest of it
+        // must go out before anything else is sent on this link.
+        //
+        if (!sent) {
+            drained = false;
+            break;
         }
     }
 
@@ -221,7 +293,15 @@ void qdr_delivery_update_disposition(qdr_core_t *core, qdr_delivery_t *delivery,
     action->args.delivery.disposition = disposition;
     action->args.delivery.settled     = settled;
 
-    qdr_action_enqueue(core, action);
+    qdr_action_enqueue_shard(core, action, delivery->shard);
+}
+
+
+void qdr_delivery_continue(qdr_core_t *core, qdr_delivery_t *delivery)
+{
+    qdr_action_t *action = qdr_action(qdr_delivery_continue_CT, "delivery_continue");
+    action->args.delivery.delivery = delivery;
+    qdr_action_enqueue_shard(core, action, delivery->shard);
 }
 
 
@@ -345,11 +425,31 @@ static void qdr_link_flow_CT(qdr_core_t *core, qdr_action_t *action, bool discar
 }
 
 
+/**
+ * A message that is still being received may be forwarded only if it will be sent on exactly
+ * one link.  Anything else waits on the incoming link until the whole message has arrived.
+ */
+static bool qdr_link_cut_through_CT(qdr_delivery_t *dlv, qdr_address_t *addr)
+{
+    if (!addr || dlv->settled || DEQ_SIZE(addr->subscriptions) > 0)
+        return false;
+
+    return addr->treatment == QD_TREATMENT_ANYCAST_CLOSEST ||
+           addr->treatment == QD_TREATMENT_ANYCAST_BALANCED;
+}
+
+
 static int qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_t *dlv, qdr_address_t *addr)
 {
     int  fanout     = 0;
     bool presettled = dlv->settled;
 
+    if (!qd_message_receive_complete(dlv->msg) && !qdr_link_cut_through_CT(dlv, addr)) {
+        DEQ_INSERT_TAIL(link->undelivered, dlv);
+        dlv->where = QDR_DELIVERY_IN_UNDELIVERED;
+        return 0;
+    }
+
     if (addr) {
         fanout = qdr_forward_message_CT(core, addr, dlv->msg, dlv, false, link->link_type == QD_LINK_CONTROL);
         if (link->link_type != QD_LINK_CONTROL && link->link_type != QD_LINK_ROUTER)
@@ -397,21 +497,59 @@ static int qdr_link_forward_CT(qdr_core_t *core, qdr_link_t *link, qdr_delivery_
 }
 
 
-static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+/**
+ * Pass the undelivered deliveries of an incoming link back through the forwarder.
+ */
+static void qdr_link_forward_undelivered_CT(qdr_core_t *core, qdr_link_t *link)
 {
-    if (discard)
-        return;
+    qdr_delivery_list_t deliveries;
+    DEQ_MOVE(link->undelivered, deliveries);
+
+    qdr_delivery_t *dlv = DEQ_HEAD(deliveries);
+    while (dlv) {
+        DEQ_REMOVE_HEAD(deliveries);
+        dlv->where = QDR_DELIVERY_NOWHERE;
+
+        qdr_address_t *addr = link->owning_addr;
+        if (!addr && dlv->to_addr)
+            qd_hash_retrieve(core->addr_hash, dlv->to_addr, (void**) &addr);
+        qdr_link_forward_CT(core, link, dlv, addr);
+
+        dlv = DEQ_HEAD(deliveries);
+    }
+}
 
-    qdr_delivery_t *dlv  = action->args.connection.delivery;
-    qdr_link_t     *link = dlv->link;
+
+static void qdr_link_deliver_one_CT(qdr_core_t *core, qdr_delivery_t *dlv, const uint8_t *tag, int tag_length)
+{
+    qdr_link_t *link = dlv->link;
+    int         me   = qdr_core_current_shard();
+
+    //
+    // A worker shard may only forward deliveries of the addresses it owns.  If the link
+    // has been rebound since the delivery was queued, hand the delivery to the control
+    // shard, which may forward anything.
+    //
+    if (me != 0 && (link->connected_link || link->shard != me || !link->owning_addr ||
+                    link->owning_addr->shard != me)) {
+        qdr_action_t *handoff = qdr_action(qdr_link_deliver_CT, "link_deliver");
+        handoff->args.connection.delivery   = dlv;
+        handoff->args.connection.tag_length = tag_length;
+        if (tag_length)
+            memcpy(handoff->args.connection.tag, tag, tag_length);
+        dlv->shard = 0;
+        qdr_action_enqueue_shard(core, handoff, 0);
+        return;
+    }
 
     //
     // If this is an attach-routed link, put the delivery directly onto the peer link
     //
     if (link->connected_link) {
         qdr_delivery_t *peer = qdr_forward_new_delivery_CT(core, dlv, link->connected_link, dlv->msg);
-        peer->tag_length = action->args.connection.tag_length;
-        memcpy(peer->tag, action->args.connection.tag, peer->tag_length);
+        peer->tag_length = tag_length;
+        if (tag_length)
+            memcpy(peer->tag, tag, tag_length);
         qdr_forward_deliver_CT(core, link->connected_link, peer);
         qd_message_free(dlv->msg);
         dlv->msg = 0;
@@ -436,6 +574,37 @@ static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool dis
 }
 
 
+static void qdr_link_deliver_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    if (discard)
+        return;
+
+    qdr_link_deliver_one_CT(core, action->args.connection.delivery,
+                            action->args.connection.tag, action->args.connection.tag_length);
+}
+
+
+static void qdr_link_deliver_batch_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    if (discard)
+        return;
+
+    //
+    // Activate each connection that the batch was forwarded to once, at the end
+    //
+    qdr_connection_defer_activations_CT(core, true);
+
+    qdr_delivery_t *dlv = DEQ_HEAD(action->args.batch.deliveries);
+    while (dlv) {
+        DEQ_REMOVE_HEAD(action->args.batch.deliveries);
+        qdr_link_deliver_one_CT(core, dlv, 0, 0);
+        dlv = DEQ_HEAD(action->args.batch.deliveries);
+    }
+
+    qdr_connection_defer_activations_CT(core, false);
+}
+
+
 static void qdr_send_to_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
 {
     qdr_field_t  *addr_field = action->args.io.address;
@@ -512,6 +681,39 @@ static void qdr_update_delivery_CT(qdr_core_t *core, qdr_action_t *action, bool
 }
 
 
+static void qdr_delivery_continue_CT(qdr_core_t *core, qdr_action_t *action, bool discard)
+{
+    if (discard)
+        return;
+
+    qdr_delivery_t *dlv  = action->args.delivery.delivery;
+    qdr_delivery_t *peer = dlv->peer;
+    qdr_link_t     *link = dlv->link;
+
+    //
+    // If the message has been forwarded, wake up the outgoing link so it sends what has
+    // arrived since the last time.
+    //
+    if (peer && peer->link) {
+        qdr_link_t *out_link = peer->link;
+
+        sys_mutex_lock(out_link->conn->work_lock);
+        qdr_add_link_ref(&out_link->conn->links_with_deliveries, out_link, QDR_LINK_LIST_CLASS_DELIVERY);
+        sys_mutex_unlock(out_link->conn->work_lock);
+
+        qdr_connection_activate_CT(core, out_link->conn);
+        return;
+    }
+
+    //
+    // If the delivery was held back until its message was complete, forward it now.
+    //
+    if (link && dlv->where == QDR_DELIVERY_IN_UNDELIVERED && DEQ_HEAD(link->undelivered) == dlv &&
+        qd_message_receive_complete(dlv->msg))
+        qdr_link_forward_undelivered_CT(core, link);
+}
+
+
 /**
  * Check the link's accumulated credit.  If the credit given to the connection thread
  * has been issued to Proton, provide the next batch of credit to the connection thread.
@@ -77,7 +77,14 @@ static void qd_router_connection_get_config(const qd_connection_t  *conn,
 
 static int AMQP_writable_conn_handler(void *type_context, qd_connection_t *conn, void *context)
 {
-    qdr_connection_t *qconn = (qdr_connection_t*) qd_connection_get_context(conn);
+    qd_router_t      *router = (qd_router_t*) type_context;
+    qdr_connection_t *qconn  = (qdr_connection_t*) qd_connection_get_context(conn);
+
+    //
+    // This is called at the end of each pass over the connection's events.  Hand the
+    // deliveries received during the pass to the core.
+    //
+    qdr_link_deliver_flush(router->router_core);
 
     if (qconn)
         return qdr_connection_process(qconn);
@@ -142,17 +149,14 @@ static qd_field_iterator_t *router_annotate_message(qd_router_t       *router,
             *link_exclusions = qd_tracemask_create(router->tracemask, trace);
 
             //
-            // Append this router's ID to the trace.
+            // Append this router's ID to the trace.  The existing entries are
+            // copied as they were encoded rather than being decoded and
+            // re-encoded one at a time.
             //
-            uint32_t idx = 0;
-            qd_parsed_field_t *trace_item = qd_parse_sub_value(trace, idx);
-            while (trace_item) {
-                qd_field_iterator_t *iter = qd_parse_raw(trace_item);
-                qd_address_iterator_reset_view(iter, ITER_VIEW_ALL);
-                qd_compose_insert_string_iterator(trace_field, iter);
-                idx++;
-                trace_item = qd_parse_sub_value(trace, idx);
-            }
+            qd_field_iterator_t *items = qd_parse_raw(trace);
+            qd_field_iterator_reset(items);
+            qd_compose_insert_encoded(trace_field, items, qd_parse_raw_length(trace), qd_parse_sub_count(trace));
+            qd_field_iterator_reset(items);
         }
     }
 
@@ -213,20 +217,60 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
 
     //
     // Receive the message into a local representation.  If the returned message
-    // pointer is NULL, we have not yet received a complete message.
-    //
-    // Note:  In the link-routing case, consider cutting the message through.  There's
-    //        no reason to wait for the whole message to be received before starting to
-    //        send it.
+    // pointer is NULL, nothing new has arrived.
     //
     msg = qd_message_receive(pnd);
     if (!msg)
         return;
 
+    //
+    // If the message is being cut through, the core already has it.  Tell the core that
+    // more has arrived and finish with the delivery once the message is complete.
+    //
+    if (qd_message_is_cut_through(msg)) {
+        delivery = (qdr_delivery_t*) pn_delivery_get_context(pnd);
+        if (delivery)
+            qdr_delivery_continue(router->router_core, delivery);
+
+        if (qd_message_receive_complete(msg)) {
+            pn_link_advance(pn_link);
+
+            //
+            // If the core has already finished with the delivery, it could not be settled
+            // while it was still being received.  Settle it now.
+            //
+            if (!delivery)
+                pn_delivery_settle(pnd);
+            qd_message_free(msg);
+        }
+        return;
+    }
+
+    //
+    // An unsettled message that has not been completely received is forwarded as soon as
+    // enough of it has arrived to route it.  The rest is streamed through as it arrives.
+    // Everything else waits for the whole message.
+    //
+    bool cut_through = false;
+    if (!qd_message_receive_complete(msg)) {
+        if (!rlink || pn_delivery_settled(pnd))
+            return;
+
+        if (!qdr_link_is_routed(rlink)) {
+            qd_message_depth_t depth = qdr_link_is_anonymous(rlink) ? QD_DEPTH_PROPERTIES : QD_DEPTH_MESSAGE_ANNOTATIONS;
+            if (qd_message_check_depth(msg, depth) != QD_MESSAGE_DEPTH_OK)
+                return;
+        }
+
+        cut_through = true;
+        qd_message_set_cut_through(msg, true);
+    }
+
     //
     // Consume the delivery.
     //
-    pn_link_advance(pn_link);
+    if (!cut_through)
+        pn_link_advance(pn_link);
 
     //
     // If there's no router link, free the message and finish.  It's likely that the link
@@ -242,7 +286,8 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
     //
     if (qdr_link_is_routed(rlink)) {
         pn_delivery_tag_t dtag = pn_delivery_tag(pnd);
-        delivery = qdr_link_deliver_to_routed_link(rlink, msg, pn_delivery_settled(pnd), (uint8_t*) dtag.start, dtag.size);
+        delivery = qdr_link_deliver_to_routed_link(rlink, cut_through ? qd_message_copy(msg) : msg,
+                                                   pn_delivery_settled(pnd), (uint8_t*) dtag.start, dtag.size);
         if (delivery) {
             if (pn_delivery_settled(pnd))
                 pn_delivery_settle(pnd);
@@ -302,8 +347,8 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
                 qd_address_iterator_reset_view(addr_iter, ITER_VIEW_ADDRESS_HASH);
                 if (phase > 0)
                     qd_address_iterator_set_phase(addr_iter, '0' + (char) phase);
-                delivery = qdr_link_deliver_to(rlink, msg, ingress_iter, addr_iter, pn_delivery_settled(pnd),
-                                               link_exclusions);
+                delivery = qdr_link_deliver_to(rlink, cut_through ? qd_message_copy(msg) : msg,
+                                               ingress_iter, addr_iter, pn_delivery_settled(pnd), link_exclusions);
             }
         } else {
             const char *term_addr = pn_terminus_get_address(qd_link_remote_target(link));
@@ -318,7 +363,8 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
                 if (phase != 0)
                     qd_message_set_phase_annotation(msg, phase);
             }
-            delivery = qdr_link_deliver(rlink, msg, ingress_iter, pn_delivery_settled(pnd), link_exclusions);
+            delivery = qdr_link_deliver(rlink, cut_through ? qd_message_copy(msg) : msg,
+                                        ingress_iter, pn_delivery_settled(pnd), link_exclusions);
         }
 
         if (delivery) {
@@ -331,9 +377,11 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
         } else {
             //
             // The message is now and will always be unroutable because there is no address.
+            // A message that is still arriving is settled once the rest of it has been received.
             //
             pn_delivery_update(pnd, PN_REJECTED);
-            pn_delivery_settle(pnd);
+            if (!cut_through)
+                pn_delivery_settle(pnd);
         }
 
         //
@@ -360,6 +408,46 @@ static void AMQP_rx_handler(void* context, qd_link_t *link, pn_delivery_t *pnd)
 }
 
 
+/**
+ * Settle a proton delivery.  An outgoing message that is still being sent is cut short.  An
+ * incoming message that is still being received is settled by the rx handler when it is complete.
+ */
+static void router_settle(pn_delivery_t *pnd)
+{
+    pn_link_t *pn_link = pn_delivery_link(pnd);
+
+    if (pn_link_is_sender(pn_link))
+        qd_message_send_cancel(pnd);
+    else if (pn_link_current(pn_link) == pnd)
+        return;
+
+    pn_delivery_settle(pnd);
+}
+
+
+/**
+ * Abandon the message that is partially sent or received on the link's current delivery.  The
+ * peer of a partially received message is sent what has arrived so far.
+ */
+static void router_link_abandon_current(qd_router_t *router, qd_link_t *link)
+{
+    pn_link_t     *pn_link = qd_link_pn(link);
+    pn_delivery_t *pnd     = pn_link ? pn_link_current(pn_link) : 0;
+
+    if (!pnd)
+        return;
+
+    if (pn_link_is_sender(pn_link))
+        qd_message_send_cancel(pnd);
+    else {
+        qd_message_receive_cancel(pnd);
+        qdr_delivery_t *delivery = (qdr_delivery_t*) pn_delivery_get_context(pnd);
+        if (delivery)
+            qdr_delivery_continue(router->router_core, delivery);
+    }
+}
+
+
 /**
  * Delivery Disposition Handler
  */
@@ -389,7 +477,7 @@ static void AMQP_disposition_handler(void* context, qd_link_t *link, pn_delivery
     // If settled, close out the delivery
     //
     if (pn_delivery_settled(pnd))
-        pn_delivery_settle(pnd);
+        router_settle(pnd);
 }
 
 
@@ -469,6 +557,8 @@ static int AMQP_link_detach_handler(void* context, qd_link_t *link, qd_detach_ty
     qdr_link_t     *rlink  = (qdr_link_t*) qd_link_get_context(link);
     pn_condition_t *cond   = qd_link_pn(link) ? pn_link_remote_condition(qd_link_pn(link)) : 0;
 
+    router_link_abandon_current((qd_router_t*) context, link);
+
     if (rlink) {
         qdr_error_t *error = qdr_error_from_pn(cond);
         qdr_link_detach(rlink, dt, error);
@@ -695,6 +785,8 @@ static void CORE_link_detach(void *context, qdr_link_t *link, qdr_error_t *error
     if (!pn_link)
         return;
 
+    router_link_abandon_current((qd_router_t*) context, qlink);
+
     if (error) {
         pn_condition_t *cond = pn_link_condition(pn_link);
         qdr_error_copy(error, cond);
@@ -738,18 +830,58 @@ static void CORE_link_drained(void *context, qdr_link_t *link)
 }
 
 
+/**
+ * Finish with an outgoing delivery once the whole message has been sent.
+ */
+static void router_send_complete(qd_router_t *router, qd_link_t *qlink, pn_delivery_t *pdlv)
+{
+    pn_link_t      *plink = qd_link_pn(qlink);
+    qdr_delivery_t *dlv   = (qdr_delivery_t*) pn_delivery_get_context(pdlv);
+
+    //
+    // If the remote send settle mode is set to 'settled', we should settle the delivery on behalf of the receiver.
+    //
+    bool remote_snd_settled = qd_link_remote_snd_settle_mode(qlink) == PN_SND_SETTLED;
+
+    if (dlv && remote_snd_settled) {
+        // Tell the core that the delivery has been accepted and settled, since we are settling on behalf of the receiver
+        pn_delivery_set_context(pdlv, 0);
+        qdr_delivery_set_context(dlv, 0);
+        qdr_delivery_update_disposition(router->router_core, dlv, PN_ACCEPTED, true);
+    }
+
+    if (!dlv || remote_snd_settled)
+        pn_delivery_settle(pdlv);
+
+    pn_link_advance(plink);
+}
+
+
 static void CORE_link_push(void *context, qdr_link_t *link)
 {
     qd_router_t *router      = (qd_router_t*) context;
     qd_link_t   *qlink       = (qd_link_t*) qdr_link_get_context(link);
     pn_link_t   *plink       = qd_link_pn(qlink);
-    int          link_credit = pn_link_credit(plink);
+    int          link_credit = 0;
+
+    //
+    // If a message is partway through being sent, send what has arrived since.  Nothing
+    // else may be sent on the link until it is finished.
+    //
+    if (qd_message_send_pending(qlink)) {
+        pn_delivery_t *pdlv = pn_link_current(plink);
+        if (qd_message_send_resume(qlink))
+            router_send_complete(router, qlink, pdlv);
+    }
+
+    if (!qd_message_send_pending(qlink))
+        link_credit = pn_link_credit(plink);
 
     qdr_link_process_deliveries(router->router_core, link, link_credit);
 }
 
 
-static void CORE_link_deliver(void *context, qdr_link_t *link, qdr_delivery_t *dlv, bool settled)
+static bool CORE_link_deliver(void *context, qdr_link_t *link, qdr_delivery_t *dlv, bool settled)
 {
     qd_router_t *router = (qd_router_t*) context;
     qd_link_t  *qlink   = (qd_link_t*) qdr_link_get_context(link);
@@ -762,26 +894,19 @@ static void CORE_link_deliver(void *context, qdr_link_t *link, qdr_delivery_t *d
     pn_delivery(plink, pn_dtag(tag, tag_length));
     pn_delivery_t *pdlv = pn_link_current(plink);
 
-    //
-    // If the remote send settle mode is set to 'settled', we should settle the delivery on behalf of the receiver.
-    //
-    bool remote_snd_settled = qd_link_remote_snd_settle_mode(qlink) == PN_SND_SETTLED;
-
-    if (!settled && !remote_snd_settled) {
+    if (!settled) {
         pn_delivery_set_context(pdlv, dlv);
         qdr_delivery_set_context(dlv, pdlv);
     }
 
-    qd_message_send(qdr_delivery_message(dlv), qlink, qdr_link_strip_annotations_out(link));
-
-    if (!settled && remote_snd_settled)
-        // Tell the core that the delivery has been accepted and settled, since we are settling on behalf of the receiver
-        qdr_delivery_update_disposition(router->router_core, dlv, PN_ACCEPTED, true);
-
-    if (settled || remote_snd_settled)
-        pn_delivery_settle(pdlv);
+    //
+    // If the message is still arriving, the rest of it is sent from CORE_link_push.
+    //
+    if (!qd_message_send(qdr_delivery_message(dlv), qlink, qdr_link_strip_annotations_out(link)))
+        return false;
 
-    pn_link_advance(plink);
+    router_send_complete(router, qlink, pdlv);
+    return true;
 }
 
 
@@ -804,7 +929,7 @@ static void CORE_delivery_update(void *context, qdr_delivery_t *dlv, uint64_t di
     if (settled) {
         qdr_delivery_set_context(dlv, 0);
         pn_delivery_set_context(pnd, 0);
-        pn_delivery_settle(pnd);
+        router_settle(pnd);
     }
 }
 
@@ -812,7 +937,8 @@ static void CORE_delivery_update(void *context, qdr_delivery_t *dlv, uint64_t di
 void qd_router_setup_late(qd_dispatch_t *qd)
 {
     qd->router->tracemask   = qd_tracemask();
-    qd->router->router_core = qdr_core(qd, qd->router->router_mode, qd->router->router_area, qd->router->router_id);
+    qd->router->router_core = qdr_core(qd, qd->router->router_mode, qd->router->router_area, qd->router->router_id,
+                                       qd->core_thread_count);
 
     qdr_connection_handlers(qd->router->router_core, (void*) qd->router,
                             CORE_connection_activate,
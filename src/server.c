@@ -74,6 +74,7 @@ static qd_thread_t *thread(qd_server_t *qd_server, int id)
     thread->running      = 0;
     thread->canceled     = 0;
     thread->using_thread = 0;
+    DEQ_INIT(thread->work_queue);
 
     return thread;
 }
@@ -345,6 +346,9 @@ qd_error_t qd_entity_refresh_connection(qd_entity_t* entity, void *impl)
     pn_ssl_t       *ssl   = 0;
     const char     *mech  = 0;
     const char     *user  = 0;
+    uint64_t        octets_in, octets_out, io_yields;
+
+    qdpn_connector_io_stats(conn->pn_cxtr, &octets_in, &octets_out, &io_yields);
 
     if (conn->pn_conn) {
         tport = pn_connection_transport(conn->pn_conn);
@@ -370,7 +374,10 @@ qd_error_t qd_entity_refresh_connection(qd_entity_t* entity, void *impl)
         qd_entity_set_string(entity, "user", user) == 0 &&
         qd_entity_set_bool(entity, "isAuthenticated", tport && pn_transport_is_authenticated(tport)) == 0 &&
         qd_entity_set_bool(entity, "isEncrypted", tport && pn_transport_is_encrypted(tport)) == 0 &&
-        qd_entity_set_bool(entity, "ssl", ssl != 0) == 0) {
+        qd_entity_set_bool(entity, "ssl", ssl != 0) == 0 &&
+        qd_entity_set_long(entity, "octetsIn", octets_in) == 0 &&
+        qd_entity_set_long(entity, "octetsOut", octets_out) == 0 &&
+        qd_entity_set_long(entity, "ioYields", io_yields) == 0) {
 
         if (ssl) {
             #define SSL_ATTR_SIZE 50
@@ -487,7 +494,26 @@ static void decorate_connection(qd_server_t *qd_server, pn_connection_t *conn)
 }
 
 
-static void thread_process_listeners_LH(qd_server_t *qd_server)
+//
+// The policy module's connection counters are guarded by the server lock.
+//
+static bool thread_policy_accept(void *context, const char *hostname)
+{
+    qd_server_t *qd_server = (qd_server_t*) context;
+
+    sys_mutex_lock(qd_server->lock);
+    bool result = qd_policy_socket_accept(qd_server->qd->policy, hostname);
+    sys_mutex_unlock(qd_server->lock);
+    return result;
+}
+
+
+//
+// Accept and set up new connections.  This is called without the server lock: a
+// connector's context is set only once the connection is fully configured, and a
+// connector with no context is passed over by thread_run until then.
+//
+static void thread_process_listeners(qd_server_t *qd_server)
 {
     qdpn_driver_t    *driver = qd_server->driver;
     qdpn_listener_t  *listener;
@@ -496,7 +522,7 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
 
     for (listener = qdpn_driver_listener(driver); listener; listener = qdpn_driver_listener(driver)) {
         bool policy_counted = false;
-        cxtr = qdpn_listener_accept(listener, qd_server->qd->policy, &qd_policy_socket_accept, &policy_counted);
+        cxtr = qdpn_listener_accept(listener, qd_server, &thread_policy_accept, &policy_counted);
         if (!cxtr)
             continue;
 
@@ -512,6 +538,7 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
         ctx->closed        = false;
         ctx->owner_thread  = CONTEXT_UNSPECIFIED_OWNER;
         ctx->enqueued      = 0;
+        ctx->affinity      = CONTEXT_NO_OWNER;
         ctx->pn_cxtr       = cxtr;
         ctx->collector     = 0;
         ctx->ssl           = 0;
@@ -523,7 +550,7 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
         ctx->ufd           = 0;
         ctx->user_id       = 0;
         ctx->free_user_id  = false;
-        ctx->connection_id = qd_server->next_connection_id++; // Increment the connection id so the next connection can use it
+        ctx->connection_id = 0;
         ctx->policy_settings = 0;
         ctx->n_senders       = 0;
         ctx->n_receivers     = 0;
@@ -541,11 +568,6 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
         pn_connection_set_context(conn, ctx);
         ctx->pn_conn = conn;
         ctx->owner_thread = CONTEXT_NO_OWNER;
-        qdpn_connector_set_context(cxtr, ctx);
-
-        // qd_server->lock is already locked
-        DEQ_INSERT_TAIL(qd_server->connections, ctx);
-        qd_entity_cache_add(QD_CONNECTION_TYPE, ctx);
 
         //
         // Get a pointer to the transport so we can insert security components into it
@@ -571,6 +593,7 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
         }
 
         // Set up SSL if configured
+        bool ssl_failed = false;
         if (config->ssl_enabled) {
             qd_log(qd_server->log_source, QD_LOG_TRACE, "Configuring SSL on %s",
                    log_incoming(logbuf, sizeof(logbuf), cxtr));
@@ -578,22 +601,41 @@ static void thread_process_listeners_LH(qd_server_t *qd_server)
                 qd_log(qd_server->log_source, QD_LOG_ERROR, "%s on %s",
                        qd_error_message(), log_incoming(logbuf, sizeof(logbuf), cxtr));
                 qdpn_connector_close(cxtr);
-                continue;
+                ssl_failed = true;
             }
         }
 
         //
         // Set up SASL
         //
-        pn_sasl_t *sasl = pn_sasl(tport);
-        if (qd_server->sasl_config_path)
-            pn_sasl_config_path(sasl, qd_server->sasl_config_path);
-        pn_sasl_config_name(sasl, qd_server->sasl_config_name);
-        if (config->sasl_mechanisms)
-            pn_sasl_allowed_mechs(sasl, config->sasl_mechanisms);
-        pn_transport_require_auth(tport, config->requireAuthentication);
-        pn_transport_require_encryption(tport, config->requireEncryption);
-        pn_sasl_set_allow_insecure_mechs(sasl, config->allowInsecureAuthentication);
+        if (!ssl_failed) {
+            pn_sasl_t *sasl = pn_sasl(tport);
+            if (qd_server->sasl_config_path)
+                pn_sasl_config_path(sasl, qd_server->sasl_config_path);
+            pn_sasl_config_name(sasl, qd_server->sasl_config_name);
+            if (config->sasl_mechanisms)
+                pn_sasl_allowed_mechs(sasl, config->sasl_mechanisms);
+            pn_transport_require_auth(tport, config->requireAuthentication);
+            pn_transport_require_encryption(tport, config->requireEncryption);
+            pn_sasl_set_allow_insecure_mechs(sasl, config->allowInsecureAuthentication);
+        }
+
+        //
+        // Publish the connection.  A closed connector is published too, so that it is
+        // harvested and released like any other.
+        //
+        sys_mutex_lock(qd_server->lock);
+        ctx->connection_id = qd_server->next_connection_id++; // Increment the connection id so the next connection can use it
+        DEQ_INSERT_TAIL(qd_server->connections, ctx);
+        qd_entity_cache_add(QD_CONNECTION_TYPE, ctx);
+        qdpn_connector_set_context(cxtr, ctx);
+        sys_mutex_unlock(qd_server->lock);
+
+        //
+        // Events that arrived while the context was unset were passed over; hand the
+        // connector back to the driver so that they are reconsidered.
+        //
+        qdpn_connector_serviced(cxtr, true);
     }
 }
 
@@ -737,18 +779,119 @@ static int process_connector(qd_server_t *qd_server, qdpn_connector_t *cxtr)
             }
             events += qd_server->conn_handler(qd_server->conn_handler_context, ctx->context, QD_CONN_EVENT_WRITABLE, qd_conn);
         }
-    } while (events > 0);
+
+        //
+        // Keep reading and writing while the socket allows it and the connector's I/O budget
+        // lasts, dispatching the events from each pass before the next.
+        //
+    } while (events > 0 || (!ctx->event_stall && qdpn_connector_io_ready(cxtr)));
 
     return passes > 1;
 }
 
 
+/**
+ * Queue a connector for processing.  A connector that has been processed before
+ * is queued to the thread that last processed it so that it tends to stay on the
+ * same thread (and its caches).  Otherwise it is queued to the shared queue.
+ */
+static void work_enqueue_LH(qd_server_t *qd_server, qd_work_item_t *work, int affinity)
+{
+    if (affinity >= 0 && affinity < qd_server->thread_count)
+        DEQ_INSERT_TAIL(qd_server->threads[affinity]->work_queue, work);
+    else
+        DEQ_INSERT_TAIL(qd_server->work_queue, work);
+    qd_server->work_queued++;
+}
+
+
+/**
+ * Take the next work item for a thread.  The thread's own queue is served
+ * first, then the shared queue.  An otherwise idle thread steals from the tail
+ * of another thread's queue, leaving the head to the thread that owns it.
+ */
+static qd_work_item_t *work_take_LH(qd_server_t *qd_server, qd_thread_t *thread)
+{
+    qd_work_item_t *work;
+
+    if (qd_server->work_queued == 0)
+        return 0;
+
+    work = DEQ_HEAD(thread->work_queue);
+    if (work) {
+        DEQ_REMOVE_HEAD(thread->work_queue);
+        qd_server->work_queued--;
+        return work;
+    }
+
+    work = DEQ_HEAD(qd_server->work_queue);
+    if (work) {
+        DEQ_REMOVE_HEAD(qd_server->work_queue);
+        qd_server->work_queued--;
+        return work;
+    }
+
+    for (int i = 1; i < qd_server->thread_count; i++) {
+        qd_thread_t *victim = qd_server->threads[(thread->thread_id + i) % qd_server->thread_count];
+        work = DEQ_TAIL(victim->work_queue);
+        while (work) {
+            //
+            // Leave alone the connectors that are still being processed, the
+            // victim will take them when it is done.
+            //
+            qd_connection_t *ctx = qdpn_connector_context(work->cxtr);
+            if (ctx->owner_thread == CONTEXT_NO_OWNER) {
+                DEQ_REMOVE(victim->work_queue, work);
+                qd_server->work_queued--;
+                __atomic_fetch_add(&qd_server->work_stolen, 1, __ATOMIC_RELAXED);
+                return work;
+            }
+            work = DEQ_PREV(work);
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Drop the work item that was queued for a connector while this thread was
+ * processing it.  Such an item is only ever on the owning thread's queue.
+ */
+static void work_cancel_LH(qd_server_t *qd_server, qd_thread_t *thread, qdpn_connector_t *cxtr)
+{
+    qd_work_item_t *work = DEQ_HEAD(thread->work_queue);
+    while (work) {
+        if (work->cxtr == cxtr) {
+            DEQ_REMOVE(thread->work_queue, work);
+            free_qd_work_item_t(work);
+            qd_server->work_queued--;
+            return;
+        }
+        work = DEQ_NEXT(work);
+    }
+}
+
+
+void qd_server_work_stats(qd_server_t *qd_server, uint64_t *stolen, uint64_t *requeued)
+{
+    //
+    // These are read without the server lock.  The management agent holds the
+    // entity-cache lock while refreshing and the server threads take that lock
+    // while holding the server lock.  The counters are updated atomically so
+    // that a read is never torn; a slightly stale count is harmless.
+    //
+    *stolen   = __atomic_load_n(&qd_server->work_stolen, __ATOMIC_RELAXED);
+    *requeued = __atomic_load_n(&qd_server->work_requeued, __ATOMIC_RELAXED);
+}
+
+
 //
 // TEMPORARY FUNCTION PROTOTYPES
 //
 void qdpn_driver_wait_1(qdpn_driver_t *d);
 int  qdpn_driver_wait_2(qdpn_driver_t *d, int timeout);
-void qdpn_driver_wait_3(qdpn_driver_t *d);
+int  qdpn_driver_wait_3(qdpn_driver_t *d);
 //
 // END TEMPORARY
 //
@@ -827,7 +970,7 @@ static void *thread_run(void *arg)
         //
         // Check the work queue for connectors scheduled for processing.
         //
-        work = DEQ_HEAD(qd_server->work_queue);
+        work = work_take_LH(qd_server, thread);
         if (!work) {
             //
             // There is no pending work to do
@@ -840,10 +983,12 @@ static void *thread_run(void *arg)
                 sys_cond_wait(qd_server->cond, qd_server->lock);
             } else {
                 //
-                // This thread elects itself to wait on the proton driver.  Set the
-                // thread-is-waiting flag so other idle threads will not interfere.
+                // This thread elects itself to wait on the proton driver.  If the driver
+                // does not support concurrent waiters, set the thread-is-waiting flag so
+                // other idle threads will not interfere.  Otherwise, every idle thread
+                // waits on the driver and takes its share of the ready connectors.
                 //
-                qd_server->a_thread_is_waiting = true;
+                qd_server->a_thread_is_waiting = !qd_server->multi_poller;
 
                 //
                 // Ask the timer module when its next timer is scheduled to fire.  We'll
@@ -854,9 +999,10 @@ static void *thread_run(void *arg)
 
                 //
                 // Invoke the proton driver's wait sequence.  This is a bit of a hack for now
-                // and will be improved in the future.  The wait process is divided into three parts,
-                // the first and third of which need to be non-reentrant, and the second of which
-                // must be reentrant (and blocks).
+                // and will be improved in the future.  The wait process is divided into three parts.
+                // The first is called under the server lock.  The second blocks and the third
+                // harvests what the driver found; neither needs the server lock, so concurrent
+                // pollers don't serialize on it while they collect their events.
                 //
                 qdpn_driver_wait_1(qd_server->driver);
                 sys_mutex_unlock(qd_server->lock);
@@ -871,9 +1017,14 @@ static void *thread_run(void *arg)
                     exit(-1);
                 }
 
-                sys_mutex_lock(qd_server->lock);
                 qdpn_driver_wait_3(qd_server->driver);
 
+                //
+                // Process listeners (incoming connections).
+                //
+                thread_process_listeners(qd_server);
+
+                sys_mutex_lock(qd_server->lock);
                 if (!thread->running) {
                     sys_mutex_unlock(qd_server->lock);
                     break;
@@ -887,26 +1038,30 @@ static void *thread_run(void *arg)
                 qd_timestamp_t milliseconds = ((qd_timestamp_t)tv.tv_sec) * 1000 + tv.tv_nsec / 1000000;
                 qd_timer_visit_LH(milliseconds);
 
-                //
-                // Process listeners (incoming connections).
-                //
-                thread_process_listeners_LH(qd_server);
-
                 //
                 // Traverse the list of connectors-needing-service from the proton driver.
-                // If the connector is not already in the work queue and it is not currently
-                // being processed by another thread, put it in the work queue and signal the
-                // condition variable.
+                // If the connector is not already in the work queue, put it in the work queue
+                // and signal the condition variable.  A connector that is being processed by
+                // another thread goes to that thread's queue, to be taken up when the thread
+                // is done with it.  The connectors are taken from the driver under the server
+                // lock because the thread that owns a connector frees it under this lock.
+                // A connector with no context is still being set up by thread_process_listeners,
+                // which hands it back to the driver when it is done.
                 //
                 cxtr = qdpn_driver_connector(qd_server->driver);
                 while (cxtr) {
                     ctx = qdpn_connector_context(cxtr);
-                    if (!ctx->enqueued && ctx->owner_thread == CONTEXT_NO_OWNER) {
+                    if (ctx && !ctx->enqueued && ctx->owner_thread != CONTEXT_UNSPECIFIED_OWNER) {
+                        int affinity = ctx->affinity;
+                        if (ctx->owner_thread != CONTEXT_NO_OWNER) {
+                            affinity = ctx->owner_thread;
+                            __atomic_fetch_add(&qd_server->work_requeued, 1, __ATOMIC_RELAXED);
+                        }
                         ctx->enqueued = 1;
                         qd_work_item_t *workitem = new_qd_work_item_t();
                         DEQ_ITEM_INIT(workitem);
                         workitem->cxtr = cxtr;
-                        DEQ_INSERT_TAIL(qd_server->work_queue, workitem);
+                        work_enqueue_LH(qd_server, workitem, affinity);
                         sys_cond_signal(qd_server->cond);
                     }
                     cxtr = qdpn_driver_connector(qd_server->driver);
@@ -920,24 +1075,33 @@ static void *thread_run(void *arg)
         }
 
         //
-        // If we were given a connector to work on from the work queue, mark it as
+        // If we were given a connector to work on from a work queue, mark it as
         // owned by this thread and as no longer enqueued.
         //
         cxtr = 0;
         if (work) {
-            DEQ_REMOVE_HEAD(qd_server->work_queue);
             ctx = qdpn_connector_context(work->cxtr);
             if (ctx->owner_thread == CONTEXT_NO_OWNER) {
                 ctx->owner_thread = thread->thread_id;
-                ctx->enqueued = 0;
+                ctx->affinity     = thread->thread_id;
+                ctx->enqueued     = 0;
                 qd_server->threads_active++;
                 cxtr = work->cxtr;
                 free_qd_work_item_t(work);
+
+                //
+                // If there is more work queued, recruit another polling thread to take it.
+                //
+                if (qd_server->multi_poller && qd_server->work_queued > 0)
+                    qdpn_driver_wakeup(qd_server->driver);
             } else {
                 //
-                // This connector is being processed by another thread, re-queue it.
+                // This connector is being processed by another thread.  Hand it to
+                // that thread's queue rather than cycling it through the shared queue;
+                // the owner will pick it up when it is done.
                 //
-                DEQ_INSERT_TAIL(qd_server->work_queue, work);
+                work_enqueue_LH(qd_server, work, ctx->owner_thread);
+                __atomic_fetch_add(&qd_server->work_requeued, 1, __ATOMIC_RELAXED);
             }
         }
         sys_mutex_unlock(qd_server->lock);
@@ -974,6 +1138,8 @@ static void *thread_run(void *arg)
 
                 sys_mutex_lock(qd_server->lock);
                 DEQ_REMOVE(qd_server->connections, ctx);
+                if (ctx->enqueued)
+                    work_cancel_LH(qd_server, thread, cxtr);
 
                 if (ctx->policy_counted) {
                     qd_policy_socket_close(qd_server->qd->policy, ctx);
@@ -985,22 +1151,25 @@ static void *thread_run(void *arg)
                 free_qd_connection(ctx);
                 qd_server->threads_active--;
                 sys_mutex_unlock(qd_server->lock);
+
+                //
+                // Wake up the proton driver to force it to reconsider its set of FDs
+                // in light of the processing that just occurred.
+                //
+                if (work_done)
+                    qdpn_driver_wakeup(qd_server->driver);
             } else {
                 //
-                // The connector lives on.  Mark it as no longer owned by this thread.
+                // The connector lives on.  Mark it as no longer owned by this thread
+                // and let the driver reconsider it in light of the processing that
+                // just occurred.
                 //
                 sys_mutex_lock(qd_server->lock);
                 ctx->owner_thread = CONTEXT_NO_OWNER;
                 qd_server->threads_active--;
+                qdpn_connector_serviced(cxtr, work_done);
                 sys_mutex_unlock(qd_server->lock);
             }
-
-            //
-            // Wake up the proton driver to force it to reconsider its set of FDs
-            // in light of the processing that just occurred.
-            //
-            if (work_done)
-                qdpn_driver_wakeup(qd_server->driver);
         }
     }
 
@@ -1062,6 +1231,7 @@ static void cxtr_try_open(void *context)
     ctx->closed       = false;
     ctx->owner_thread = CONTEXT_UNSPECIFIED_OWNER;
     ctx->enqueued     = 0;
+    ctx->affinity     = CONTEXT_NO_OWNER;
     ctx->pn_conn      = pn_connection();
     ctx->collector    = pn_collector();
     ctx->ssl          = 0;
@@ -1211,7 +1381,14 @@ static void cxtr_try_open(void *context)
 
     pn_connection_open(ctx->pn_conn);
 
+    //
+    // The connector was passed over while it was being set up.  Release it and
+    // hand it back to the driver.
+    //
+    sys_mutex_lock(ct->server->lock);
     ctx->owner_thread = CONTEXT_NO_OWNER;
+    sys_mutex_unlock(ct->server->lock);
+    qdpn_connector_serviced(ctx->pn_cxtr, true);
 }
 
 
@@ -1240,6 +1417,7 @@ qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, const char *containe
     qd_server->sasl_config_path = sasl_config_path;
     qd_server->sasl_config_name = sasl_config_name;
     qd_server->driver           = qdpn_driver();
+    qdpn_driver_set_io_budget(qd_server->driver, qd->io_budget_bytes, qd->io_budget_passes);
     qd_server->start_handler    = 0;
     qd_server->conn_handler     = 0;
     qd_server->pn_event_handler = 0;
@@ -1258,7 +1436,11 @@ qd_server_t *qd_server(qd_dispatch_t *qd, int thread_count, const char *containe
 
     DEQ_INIT(qd_server->work_queue);
     DEQ_INIT(qd_server->pending_timers);
+    qd_server->work_queued         = 0;
+    qd_server->work_stolen         = 0;
+    qd_server->work_requeued       = 0;
     qd_server->a_thread_is_waiting = false;
+    qd_server->multi_poller        = qdpn_driver_concurrent_wait(qd_server->driver) && thread_count > 1;
     qd_server->threads_active      = 0;
     qd_server->pause_requests      = 0;
     qd_server->threads_paused      = 0;
@@ -1387,7 +1569,7 @@ void qd_server_stop(qd_dispatch_t *qd)
     for (idx = 0; idx < qd_server->thread_count; idx++)
         thread_cancel(qd_server->threads[idx]);
     sys_cond_signal_all(qd_server->cond);
-    qdpn_driver_wakeup(qd_server->driver);
+    qdpn_driver_wakeup_all(qd_server->driver, qd_server->thread_count);
     sys_mutex_unlock(qd_server->lock);
 
     if (thread_server != qd_server) {
@@ -1427,7 +1609,7 @@ void qd_server_pause(qd_dispatch_t *qd)
     // Awaken all threads that are currently blocking.
     //
     sys_cond_signal_all(qd_server->cond);
-    qdpn_driver_wakeup(qd_server->driver);
+    qdpn_driver_wakeup_all(qd_server->driver, qd_server->thread_count);
 
     //
     // Wait for the paused thread count plus the number of threads requesting a pause to equal
@@ -1642,6 +1824,7 @@ qd_user_fd_t *qd_user_fd(qd_dispatch_t *qd, int fd, void *context)
     ctx->closed       = false;
     ctx->owner_thread = CONTEXT_NO_OWNER;
     ctx->enqueued     = 0;
+    ctx->affinity     = CONTEXT_NO_OWNER;
     ctx->pn_conn      = 0;
     ctx->collector    = 0;
     ctx->ssl          = 0;
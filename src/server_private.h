@@ -88,6 +88,7 @@ struct qd_connection_t {
     bool                      closed;
     int                       owner_thread;
     int                       enqueued;
+    int                       affinity; // Thread that last processed this connection
     qdpn_connector_t         *pn_cxtr;
     pn_connection_t          *pn_conn;
     pn_collector_t           *collector;
@@ -123,16 +124,6 @@ struct qd_user_fd_t {
 };
 
 
-typedef struct qd_thread_t {
-    qd_server_t  *qd_server;
-    int           thread_id;
-    volatile int  running;
-    volatile int  canceled;
-    int           using_thread;
-    sys_thread_t *thread;
-} qd_thread_t;
-
-
 typedef struct qd_work_item_t {
     DEQ_LINKS(struct qd_work_item_t);
     qdpn_connector_t *cxtr;
@@ -141,6 +132,17 @@ typedef struct qd_work_item_t {
 DEQ_DECLARE(qd_work_item_t, qd_work_list_t);
 
 
+typedef struct qd_thread_t {
+    qd_server_t    *qd_server;
+    int             thread_id;
+    volatile int    running;
+    volatile int    canceled;
+    int             using_thread;
+    sys_thread_t   *thread;
+    qd_work_list_t  work_queue; // Connectors with affinity for this thread (server lock)
+} qd_thread_t;
+
+
 struct qd_server_t {
     qd_dispatch_t            *qd;
     int                       thread_count;
@@ -158,9 +160,13 @@ struct qd_server_t {
     sys_cond_t               *cond;
     sys_mutex_t              *lock;
     qd_thread_t             **threads;
-    qd_work_list_t            work_queue;
+    qd_work_list_t            work_queue;    // Connectors with no thread affinity
+    int                       work_queued;   // Total items in all work queues
+    uint64_t                  work_stolen;   // Items taken from another thread's queue
+    uint64_t                  work_requeued; // Items handed to the thread that owned them
     qd_timer_list_t           pending_timers;
     bool                      a_thread_is_waiting;
+    bool                      multi_poller;
     int                       threads_active;
     int                       pause_requests;
     int                       threads_paused;
@@ -174,6 +180,11 @@ struct qd_server_t {
     uint64_t                 next_connection_id;
 };
 
+/**
+ * Report the work-distribution counters of the server.
+ */
+void qd_server_work_stats(qd_server_t *qd_server, uint64_t *stolen, uint64_t *requeued);
+
 ALLOC_DECLARE(qd_work_item_t);
 ALLOC_DECLARE(qd_listener_t);
 ALLOC_DECLARE(qd_deferred_call_t);
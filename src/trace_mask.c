@@ -22,6 +22,7 @@
 #include <qpid/dispatch/threading.h>
 #include <qpid/dispatch/hash.h>
 #include "alloc.h"
+#include <string.h>
 
 typedef struct {
     qd_hash_handle_t *hash_handle;
@@ -32,12 +33,110 @@ typedef struct {
 ALLOC_DECLARE(qdtm_router_t);
 ALLOC_DEFINE(qdtm_router_t);
 
+//
+// The same few trace lists turn up on message after message, so each thread keeps a small
+// direct-mapped cache from the encoded trace list to the exclusion mask built for it.  The
+// cached masks are shared with the callers and are never modified.  A cache holds masks
+// built under one generation of its tracemask and is emptied when the generation moves on.
+//
+// The caches are owned by the tracemask, which releases them and their masks when it is
+// freed, after the threads that used them have been joined.  A thread remembers its cache
+// for the last tracemask it used by that tracemask's id; ids and generations are drawn from
+// one counter so they are never reused, and a thread never follows its cache pointer for a
+// tracemask that is gone.  A cache left by a thread that has exited is adopted by the next
+// thread whose trace_cache variable lands at the same address.
+//
+#define TRACE_CACHE_SIZE    16
+#define TRACE_CACHE_KEY_MAX 256
+
+typedef struct {
+    uint32_t      hash;
+    uint32_t      length;
+    qd_bitmask_t *mask;
+    unsigned char key[TRACE_CACHE_KEY_MAX];
+} qdtm_cache_entry_t;
+
+typedef struct qdtm_cache_t qdtm_cache_t;
+
+struct qdtm_cache_t {
+    DEQ_LINKS(qdtm_cache_t);
+    void              *owner;        ///< Address of the owning thread's trace_cache variable
+    uint64_t           generation;
+    qdtm_cache_entry_t entries[TRACE_CACHE_SIZE];
+};
+
+DEQ_DECLARE(qdtm_cache_t, qdtm_cache_list_t);
+
 struct qd_tracemask_t {
-    sys_rwlock_t   *lock;
-    qd_hash_t      *hash;
-    qdtm_router_t **router_by_mask_bit;
+    sys_rwlock_t      *lock;
+    qd_hash_t         *hash;
+    qdtm_router_t    **router_by_mask_bit;
+    uint64_t           id;
+    uint64_t           generation;   ///< Changes whenever a router or link changes; guards the cached masks
+    qdtm_cache_list_t  caches;       ///< One per thread that has created a mask; under the write lock
 };
 
+static __thread qdtm_cache_t *trace_cache    = 0;
+static __thread uint64_t      trace_cache_id = 0;
+static uint64_t               next_generation = 1;
+
+
+//
+// Called with the write lock held, or before the tracemask is in use.
+//
+static void tracemask_changed(qd_tracemask_t *tm)
+{
+    __atomic_store_n(&tm->generation, __atomic_fetch_add(&next_generation, 1, __ATOMIC_RELAXED),
+                     __ATOMIC_RELEASE);
+}
+
+
+static void cache_release(qdtm_cache_t *cache)
+{
+    for (int i = 0; i < TRACE_CACHE_SIZE; i++) {
+        qd_bitmask_free(cache->entries[i].mask);
+        cache->entries[i].mask = 0;
+    }
+}
+
+
+//
+// Return the calling thread's cache for this tracemask, emptied of masks from older
+// generations.  Returns 0 if a cache cannot be allocated.
+//
+static qdtm_cache_t *thread_cache(qd_tracemask_t *tm, uint64_t generation)
+{
+    if (trace_cache_id != tm->id) {
+        sys_rwlock_wrlock(tm->lock);
+        qdtm_cache_t *cache = DEQ_HEAD(tm->caches);
+        while (cache && cache->owner != (void*) &trace_cache)
+            cache = DEQ_NEXT(cache);
+        if (!cache) {
+            cache = NEW(qdtm_cache_t);
+            if (cache) {
+                ZERO(cache);
+                DEQ_ITEM_INIT(cache);
+                cache->owner      = (void*) &trace_cache;
+                cache->generation = generation;
+                DEQ_INSERT_TAIL(tm->caches, cache);
+            }
+        }
+        sys_rwlock_unlock(tm->lock);
+
+        if (!cache)
+            return 0;
+        trace_cache    = cache;
+        trace_cache_id = tm->id;
+    }
+
+    if (trace_cache->generation != generation) {
+        cache_release(trace_cache);
+        trace_cache->generation = generation;
+    }
+
+    return trace_cache;
+}
+
 
 qd_tracemask_t *qd_tracemask(void)
 {
@@ -45,6 +144,9 @@ qd_tracemask_t *qd_tracemask(void)
     tm->lock               = sys_rwlock();
     tm->hash               = qd_hash(8, 1, 0);
     tm->router_by_mask_bit = NEW_PTR_ARRAY(qdtm_router_t, qd_bitmask_width());
+    tm->id                 = __atomic_fetch_add(&next_generation, 1, __ATOMIC_RELAXED);
+    DEQ_INIT(tm->caches);
+    tracemask_changed(tm);
 
     for (int i = 0; i < qd_bitmask_width(); i++)
         tm->router_by_mask_bit[i] = 0;
@@ -59,6 +161,14 @@ void qd_tracemask_free(qd_tracemask_t *tm)
             qd_tracemask_del_router(tm, i);
     }
 
+    qdtm_cache_t *cache = DEQ_HEAD(tm->caches);
+    while (cache) {
+        DEQ_REMOVE_HEAD(tm->caches);
+        cache_release(cache);
+        free(cache);
+        cache = DEQ_HEAD(tm->caches);
+    }
+
     qd_hash_free(tm->hash);
     sys_rwlock_free(tm->lock);
     free(tm);
@@ -77,6 +187,7 @@ void qd_tracemask_add_router(qd_tracemask_t *tm, const char *address, int maskbi
         qd_hash_insert(tm->hash, iter, router, &router->hash_handle);
         tm->router_by_mask_bit[maskbit] = router;
     }
+    tracemask_changed(tm);
     sys_rwlock_unlock(tm->lock);
     qd_field_iterator_free(iter);
 }
@@ -92,6 +203,7 @@ void qd_tracemask_del_router(qd_tracemask_t *tm, int maskbit)
         tm->router_by_mask_bit[maskbit] = 0;
         free_qdtm_router_t(router);
     }
+    tracemask_changed(tm);
     sys_rwlock_unlock(tm->lock);
 }
 
@@ -106,6 +218,7 @@ void qd_tracemask_set_link(qd_tracemask_t *tm, int router_maskbit, int link_mask
         qdtm_router_t *router = tm->router_by_mask_bit[router_maskbit];
         router->link_maskbit = link_maskbit;
     }
+    tracemask_changed(tm);
     sys_rwlock_unlock(tm->lock);
 }
 
@@ -118,18 +231,48 @@ void qd_tracemask_remove_link(qd_tracemask_t *tm, int router_maskbit)
         qdtm_router_t *router = tm->router_by_mask_bit[router_maskbit];
         router->link_maskbit = -1;
     }
+    tracemask_changed(tm);
     sys_rwlock_unlock(tm->lock);
 }
 
 
 qd_bitmask_t *qd_tracemask_create(qd_tracemask_t *tm, qd_parsed_field_t *tracelist)
 {
-    qd_bitmask_t *bm  = qd_bitmask(0);
-    int           idx = 0;
+    qdtm_cache_t       *cache  = 0;
+    qdtm_cache_entry_t *entry  = 0;
+    uint32_t            length = qd_parse_raw_length(tracelist);
+    unsigned char       key[TRACE_CACHE_KEY_MAX];
+    uint32_t            hash   = 2166136261u;
+    int                 idx    = 0;
 
     assert(qd_parse_is_list(tracelist));
 
+    //
+    // Look the encoded list up in this thread's cache.  Lists too long to be keyed are
+    // built every time.
+    //
+    if (length <= TRACE_CACHE_KEY_MAX)
+        cache = thread_cache(tm, __atomic_load_n(&tm->generation, __ATOMIC_ACQUIRE));
+
+    if (cache) {
+        qd_field_iterator_t *raw = qd_parse_raw(tracelist);
+        qd_field_iterator_reset(raw);
+        length = qd_field_iterator_read(raw, key, length);
+        qd_field_iterator_reset(raw);
+
+        for (uint32_t i = 0; i < length; i++)
+            hash = (hash ^ key[i]) * 16777619u;
+
+        entry = &cache->entries[hash % TRACE_CACHE_SIZE];
+        if (entry->mask && entry->hash == hash && entry->length == length &&
+            memcmp(entry->key, key, length) == 0)
+            return qd_bitmask_ref(entry->mask);
+    }
+
+    qd_bitmask_t *bm = qd_bitmask(0);
+
     sys_rwlock_rdlock(tm->lock);
+    uint64_t           generation = tm->generation;
     qd_parsed_field_t *item   = qd_parse_sub_value(tracelist, idx);
     qdtm_router_t     *router = 0;
     while (item) {
@@ -142,6 +285,25 @@ qd_bitmask_t *qd_tracemask_create(qd_tracemask_t *tm, qd_parsed_field_t *traceli
         item = qd_parse_sub_value(tracelist, idx);
     }
     sys_rwlock_unlock(tm->lock);
+
+    //
+    // A mask built after the generation moved on is not cached; the cache would drop it on
+    // the next call anyway.
+    //
+    if (entry && generation == cache->generation) {
+        //
+        // Settle the mask's lazily computed state before it is shared.
+        //
+        int first;
+        qd_bitmask_first_set(bm, &first);
+
+        qd_bitmask_free(entry->mask);
+        entry->mask   = qd_bitmask_ref(bm);
+        entry->hash   = hash;
+        entry->length = length;
+        memcpy(entry->key, key, length);
+    }
+
     return bm;
 }
 
@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Measure the rate at which 1 to 16 producer threads can hand actions to one core thread.
+// The core's lock-free action queue is compared with a list guarded by a mutex and signalled
+// with a condition variable on every enqueue, which is how actions were queued before.  The
+// actions are allocated up front so that only the hand-off is timed.
+//
+// Usage: action_queue_bench [actions-per-producer]
+//
+
+#include <qpid/dispatch/threading.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "router_core/router_core_private.h"
+
+#define MAX_PRODUCERS 16
+
+typedef struct {
+    sys_mutex_t       *lock;
+    sys_cond_t        *cond;
+    qdr_action_list_t  list;
+} locked_queue_t;
+
+typedef struct {
+    bool                lock_free;
+    qdr_action_queue_t  queue;
+    locked_queue_t      locked;
+} bench_t;
+
+typedef struct {
+    bench_t       *bench;
+    qdr_action_t **actions;
+    int            count;
+} producer_t;
+
+
+static void locked_push(locked_queue_t *q, qdr_action_t *action)
+{
+    sys_mutex_lock(q->lock);
+    DEQ_INSERT_TAIL(q->list, action);
+    sys_cond_signal(q->cond);
+    sys_mutex_unlock(q->lock);
+}
+
+
+static void locked_take(locked_queue_t *q, qdr_action_list_t *list)
+{
+    sys_mutex_lock(q->lock);
+    while (DEQ_IS_EMPTY(q->list))
+        sys_cond_wait(q->cond, q->lock);
+    DEQ_MOVE(q->list, *list);
+    sys_mutex_unlock(q->lock);
+}
+
+
+static void *producer(void *context)
+{
+    producer_t *p     = (producer_t*) context;
+    bench_t    *bench = p->bench;
+
+    for (int i = 0; i < p->count; i++) {
+        if (bench->lock_free)
+            qdr_action_queue_push(&bench->queue, p->actions[i]);
+        else
+            locked_push(&bench->locked, p->actions[i]);
+    }
+
+    return 0;
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+//
+// Consume all the actions of the producers on this thread and return the number of millions
+// of actions handed over per second.
+//
+static double run(bench_t *bench, producer_t *producers, int count)
+{
+    sys_thread_t *threads[MAX_PRODUCERS];
+    int           remaining = count * producers[0].count;
+
+    for (int i = 0; i < count; i++)
+        for (int j = 0; j < producers[i].count; j++)
+            DEQ_ITEM_INIT(producers[i].actions[j]);
+
+    double start = now_usec();
+    for (int i = 0; i < count; i++)
+        threads[i] = sys_thread(producer, &producers[i]);
+
+    while (remaining > 0) {
+        qdr_action_list_t list;
+
+        if (bench->lock_free) {
+            qdr_action_queue_wait(&bench->queue);
+            qdr_action_queue_take(&bench->queue, &list);
+        } else
+            locked_take(&bench->locked, &list);
+
+        remaining -= DEQ_SIZE(list);
+    }
+
+    double elapsed = now_usec() - start;
+
+    for (int i = 0; i < count; i++) {
+        sys_thread_join(threads[i]);
+        sys_thread_free(threads[i]);
+    }
+
+    return count * producers[0].count / elapsed;
+}
+
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 50000;
+
+    if (iterations < 1)
+        return 1;
+
+    qd_alloc_initialize();
+
+    bench_t    bench;
+    producer_t producers[MAX_PRODUCERS];
+
+    qdr_action_queue_init(&bench.queue);
+    bench.locked.lock = sys_mutex();
+    bench.locked.cond = sys_cond();
+    DEQ_INIT(bench.locked.list);
+
+    for (int i = 0; i < MAX_PRODUCERS; i++) {
+        producers[i].bench   = &bench;
+        producers[i].count   = iterations;
+        producers[i].actions = (qdr_action_t**) malloc(iterations * sizeof(qdr_action_t*));
+        for (int j = 0; j < iterations; j++)
+            producers[i].actions[j] = qdr_action(0, "bench");
+    }
+
+    printf("%9s %22s %22s\n", "producers", "lock-free (M/s)", "mutex and cond (M/s)");
+    for (int count = 1; count <= MAX_PRODUCERS; count *= 2) {
+        bench.lock_free = true;
+        double lock_free = run(&bench, producers, count);
+        bench.lock_free = false;
+        double locked = run(&bench, producers, count);
+        printf("%9d %22.2f %22.2f\n", count, lock_free, locked);
+    }
+
+    for (int i = 0; i < MAX_PRODUCERS; i++) {
+        for (int j = 0; j < iterations; j++)
+            free_qdr_action_t(producers[i].actions[j]);
+        free(producers[i].actions);
+    }
+
+    sys_cond_free(bench.locked.cond);
+    sys_mutex_free(bench.locked.lock);
+    qdr_action_queue_final(&bench.queue);
+    qd_alloc_finalize();
+    return 0;
+}
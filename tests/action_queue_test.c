@@ -0,0 +1,162 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ * 
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "test_case.h"
+#include "router_core/router_core_private.h"
+#include <stdio.h>
+#include <string.h>
+
+#define AQ_MAX_PRODUCERS 16
+#define AQ_ITERATIONS    20000
+
+typedef struct {
+    qdr_action_queue_t *queue;
+    int                 producer;
+} aq_producer_t;
+
+
+static void *aq_producer(void *context)
+{
+    aq_producer_t *p = (aq_producer_t*) context;
+
+    for (int i = 0; i < AQ_ITERATIONS; i++) {
+        qdr_action_t *action = qdr_action(0, 0);
+        action->args.route_table.link_maskbit   = p->producer;
+        action->args.route_table.router_maskbit = i;
+        qdr_action_queue_push(p->queue, action);
+    }
+
+    return 0;
+}
+
+
+//
+// Run a number of producers against one consumer.  Every action must arrive exactly once
+// and the actions of each producer must arrive in the order they were pushed.
+//
+static char *run_producers(int producers)
+{
+    qdr_action_queue_t  queue;
+    aq_producer_t       context[AQ_MAX_PRODUCERS];
+    sys_thread_t       *threads[AQ_MAX_PRODUCERS];
+    int                 next[AQ_MAX_PRODUCERS];
+    int                 remaining = producers * AQ_ITERATIONS;
+    char               *error = 0;
+
+    qdr_action_queue_init(&queue);
+    memset(next, 0, sizeof(next));
+
+    for (int i = 0; i < producers; i++) {
+        context[i].queue    = &queue;
+        context[i].producer = i;
+        threads[i] = sys_thread(aq_producer, &context[i]);
+    }
+
+    while (remaining > 0) {
+        qdr_action_list_t list;
+
+        qdr_action_queue_wait(&queue);
+        qdr_action_queue_take(&queue, &list);
+
+        qdr_action_t *action = DEQ_HEAD(list);
+        while (action) {
+            DEQ_REMOVE_HEAD(list);
+            int producer = action->args.route_table.link_maskbit;
+            if (producer < 0 || producer >= producers)
+                error = "Action from an unknown producer";
+            else if (action->args.route_table.router_maskbit != next[producer]++)
+                error = "Actions out of order";
+            remaining--;
+            free_qdr_action_t(action);
+            action = DEQ_HEAD(list);
+        }
+    }
+
+    for (int i = 0; i < producers; i++) {
+        sys_thread_join(threads[i]);
+        sys_thread_free(threads[i]);
+    }
+
+    qdr_action_list_t list;
+    qdr_action_queue_take(&queue, &list);
+    if (!DEQ_IS_EMPTY(list))
+        error = "Extra actions in the queue";
+
+    qdr_action_queue_final(&queue);
+    return error;
+}
+
+
+static char *test_action_queue_producers(void *context)
+{
+    // Initialize the type before the threads race to do it
+    free_qdr_action_t(qdr_action(0, 0));
+
+    for (int producers = 1; producers <= AQ_MAX_PRODUCERS; producers *= 2) {
+        char *error = run_producers(producers);
+        if (error)
+            return error;
+    }
+
+    return 0;
+}
+
+
+static char *test_action_queue_wake(void *context)
+{
+    qdr_action_queue_t queue;
+    qdr_action_list_t  list;
+
+    qdr_action_queue_init(&queue);
+
+    // A wake with nothing queued ends exactly one wait
+    qdr_action_queue_wake(&queue);
+    qdr_action_queue_wait(&queue);
+    qdr_action_queue_take(&queue, &list);
+    if (!DEQ_IS_EMPTY(list)) return "Unexpected action after wake";
+    if (queue.woken) return "Wake was not consumed";
+
+    // Queued actions end a wait without a wake
+    qdr_action_queue_push(&queue, qdr_action(0, "first"));
+    qdr_action_queue_push(&queue, qdr_action(0, "second"));
+    qdr_action_queue_wait(&queue);
+    qdr_action_queue_take(&queue, &list);
+    if (DEQ_SIZE(list) != 2) return "Expected two actions";
+    if (strcmp(DEQ_HEAD(list)->label, "first")) return "Expected arrival order";
+
+    while (DEQ_HEAD(list)) {
+        qdr_action_t *action = DEQ_HEAD(list);
+        DEQ_REMOVE_HEAD(list);
+        free_qdr_action_t(action);
+    }
+
+    qdr_action_queue_final(&queue);
+    return 0;
+}
+
+
+int action_queue_tests(void)
+{
+    int result = 0;
+
+    TEST_CASE(test_action_queue_producers, 0);
+    TEST_CASE(test_action_queue_wake, 0);
+
+    return result;
+}
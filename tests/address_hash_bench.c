@@ -0,0 +1,171 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Compare qd_iterator_hash_function with djb2 computed one octet at a time through
+// qd_field_iterator_octet, as addresses were hashed before.  The corpus is a set of long,
+// mostly alike addresses in a hierarchical naming scheme.  Each address is hashed from a
+// string and from a chain of 16-octet buffers, so that buffer boundaries fall inside it.
+// The spread of each hash over 4096 buckets is reported as well as its speed.
+//
+// Usage: address_hash_bench [addresses]
+//
+
+#include <qpid/dispatch/buffer.h>
+#include <qpid/dispatch/iterator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "alloc.h"
+
+#define ADDRESS_MAX 200
+#define SEGMENT     16
+#define BUCKETS     4096
+#define PASSES      20
+
+
+static void corpus_address(char *text, int i)
+{
+    snprintf(text, ADDRESS_MAX, "amqp:/tenant-%04d.region-%02d/services/order-processing.v%d/partition-%05d/queue.%s",
+             i % 200, i % 13, i % 7, i, (i & 1) ? "priority" : "standard");
+}
+
+
+static void build_buffer_chain(qd_buffer_list_t *chain, const char *text)
+{
+    size_t len = strlen(text);
+
+    DEQ_INIT(*chain);
+    while (len) {
+        size_t       count = len < SEGMENT ? len : SEGMENT;
+        qd_buffer_t *buf   = qd_buffer();
+        memcpy(qd_buffer_cursor(buf), text, count);
+        qd_buffer_insert(buf, count);
+        DEQ_INSERT_TAIL(*chain, buf);
+        len  -= count;
+        text += count;
+    }
+}
+
+
+static uint32_t djb2_octets(qd_field_iterator_t *iter)
+{
+    uint32_t hash = 5381;
+
+    qd_field_iterator_reset(iter);
+    while (!qd_field_iterator_end(iter))
+        hash = ((hash << 5) + hash) + (int) qd_field_iterator_octet(iter);
+
+    return hash;
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+//
+// Return the mean time in nanoseconds to hash one address.
+//
+static double run(qd_field_iterator_t **iters, int count, bool octets)
+{
+    uint32_t sum   = 0;
+    double   start = now_usec();
+
+    for (int pass = 0; pass < PASSES; pass++)
+        for (int i = 0; i < count; i++)
+            sum += octets ? djb2_octets(iters[i]) : qd_iterator_hash_function(iters[i]);
+
+    double elapsed = now_usec() - start;
+
+    // Keep the hashing from being optimized away
+    if (sum == 1)
+        printf(" ");
+
+    return elapsed * 1e3 / (PASSES * count);
+}
+
+
+//
+// Return the fullest of the buckets the corpus hashes into.
+//
+static int max_load(qd_field_iterator_t **iters, int count, bool octets)
+{
+    int *load    = (int*) calloc(BUCKETS, sizeof(int));
+    int  fullest = 0;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t hash = octets ? djb2_octets(iters[i]) : qd_iterator_hash_function(iters[i]);
+        if (++load[hash % BUCKETS] > fullest)
+            fullest = load[hash % BUCKETS];
+    }
+
+    free(load);
+    return fullest;
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+
+    if (count < 1)
+        return 1;
+
+    qd_alloc_initialize();
+    qd_field_iterator_set_address("area", "router");
+
+    char                 *texts   = (char*) malloc((size_t) count * ADDRESS_MAX);
+    qd_buffer_list_t     *chains  = (qd_buffer_list_t*) malloc(count * sizeof(qd_buffer_list_t));
+    qd_field_iterator_t **strings = (qd_field_iterator_t**) malloc(count * sizeof(qd_field_iterator_t*));
+    qd_field_iterator_t **buffers = (qd_field_iterator_t**) malloc(count * sizeof(qd_field_iterator_t*));
+    size_t                length  = 0;
+
+    for (int i = 0; i < count; i++) {
+        char *text = texts + (size_t) i * ADDRESS_MAX;
+        corpus_address(text, i);
+        length += strlen(text);
+        build_buffer_chain(&chains[i], text);
+        strings[i] = qd_address_iterator_string(text, ITER_VIEW_ADDRESS_HASH);
+        buffers[i] = qd_address_iterator_buffer(DEQ_HEAD(chains[i]), 0, strlen(text), ITER_VIEW_ADDRESS_HASH);
+    }
+
+    printf("%d addresses of %.1f octets on average\n", count, (double) length / count);
+    printf("%-28s %14s %16s\n", "", "word hash", "octet djb2");
+    printf("%-28s %14.1f %16.1f\n", "string (ns)", run(strings, count, false), run(strings, count, true));
+    printf("%-28s %14.1f %16.1f\n", "16-octet buffers (ns)", run(buffers, count, false), run(buffers, count, true));
+    printf("%-28s %14d %16d\n", "fullest of 4096 buckets", max_load(strings, count, false), max_load(strings, count, true));
+
+    for (int i = 0; i < count; i++) {
+        qd_field_iterator_free(strings[i]);
+        qd_field_iterator_free(buffers[i]);
+        qd_buffer_list_free_buffers(&chains[i]);
+    }
+    free(buffers);
+    free(strings);
+    free(chains);
+    free(texts);
+    qd_alloc_finalize();
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Measure the cost of objects that are allocated on one thread and freed on another, as
+// buffers are when a message is received on one connection and sent on another.  Each
+// producer thread allocates objects and hands them, a chunk at a time, to its own consumer
+// thread, which frees them.  Every freed object therefore goes back through the global free
+// list.  The time per object and the retries counted by the global exchange are reported for
+// 1 to 8 producer/consumer pairs.
+//
+// Usage: alloc_bench [objects-per-producer]
+//
+
+#include <qpid/dispatch/threading.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "alloc.h"
+
+#define MAX_PAIRS 8
+#define CHUNK     256
+#define WINDOW    16
+
+typedef struct {
+    char data[64];
+} bench_object_t;
+
+ALLOC_DECLARE(bench_object_t);
+ALLOC_DEFINE(bench_object_t);
+
+typedef struct chunk_t {
+    DEQ_LINKS(struct chunk_t);
+    bench_object_t *objects[CHUNK];
+} chunk_t;
+
+DEQ_DECLARE(chunk_t, chunk_list_t);
+
+typedef struct {
+    sys_mutex_t  *lock;
+    sys_cond_t   *cond;
+    chunk_list_t  chunks;
+    int           count;
+    bool          done;
+} pair_t;
+
+
+static void *producer(void *context)
+{
+    pair_t *pair = (pair_t*) context;
+
+    for (int n = 0; n < pair->count; n += CHUNK) {
+        chunk_t *chunk = NEW(chunk_t);
+        DEQ_ITEM_INIT(chunk);
+        for (int i = 0; i < CHUNK; i++)
+            chunk->objects[i] = new_bench_object_t();
+
+        sys_mutex_lock(pair->lock);
+        while (DEQ_SIZE(pair->chunks) >= WINDOW)
+            sys_cond_wait(pair->cond, pair->lock);
+        DEQ_INSERT_TAIL(pair->chunks, chunk);
+        sys_cond_signal(pair->cond);
+        sys_mutex_unlock(pair->lock);
+    }
+
+    sys_mutex_lock(pair->lock);
+    pair->done = true;
+    sys_cond_signal(pair->cond);
+    sys_mutex_unlock(pair->lock);
+    return 0;
+}
+
+
+static void *consumer(void *context)
+{
+    pair_t *pair = (pair_t*) context;
+
+    for (;;) {
+        chunk_list_t chunks;
+
+        sys_mutex_lock(pair->lock);
+        while (DEQ_IS_EMPTY(pair->chunks) && !pair->done)
+            sys_cond_wait(pair->cond, pair->lock);
+        DEQ_MOVE(pair->chunks, chunks);
+        bool done = pair->done;
+        sys_cond_signal(pair->cond);
+        sys_mutex_unlock(pair->lock);
+
+        chunk_t *chunk = DEQ_HEAD(chunks);
+        if (!chunk && done)
+            return 0;
+
+        while (chunk) {
+            DEQ_REMOVE_HEAD(chunks);
+            for (int i = 0; i < CHUNK; i++)
+                free_bench_object_t(chunk->objects[i]);
+            free(chunk);
+            chunk = DEQ_HEAD(chunks);
+        }
+    }
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+//
+// Return the mean time in nanoseconds for one object to be allocated and freed.
+//
+static double run(int pairs, int count)
+{
+    pair_t        pair[MAX_PAIRS];
+    sys_thread_t *threads[MAX_PAIRS * 2];
+
+    for (int i = 0; i < pairs; i++) {
+        pair[i].lock  = sys_mutex();
+        pair[i].cond  = sys_cond();
+        pair[i].count = count;
+        pair[i].done  = false;
+        DEQ_INIT(pair[i].chunks);
+    }
+
+    double start = now_usec();
+    for (int i = 0; i < pairs; i++) {
+        threads[i * 2]     = sys_thread(producer, &pair[i]);
+        threads[i * 2 + 1] = sys_thread(consumer, &pair[i]);
+    }
+
+    for (int i = 0; i < pairs * 2; i++) {
+        sys_thread_join(threads[i]);
+        sys_thread_free(threads[i]);
+    }
+    double elapsed = now_usec() - start;
+
+    for (int i = 0; i < pairs; i++) {
+        sys_cond_free(pair[i].cond);
+        sys_mutex_free(pair[i].lock);
+    }
+
+    return elapsed * 1e3 / ((double) pairs * count);
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    if (count < CHUNK)
+        return 1;
+    count -= count % CHUNK;
+
+    qd_alloc_initialize();
+
+    // Initialize the type before the threads race to do it
+    free_bench_object_t(new_bench_object_t());
+
+    printf("%6s %18s %16s %20s\n", "pairs", "per object (ns)", "batches moved", "exchange retries");
+    for (int pairs = 1; pairs <= MAX_PAIRS; pairs *= 2) {
+        qd_alloc_stats_t *stats   = alloc_stats_bench_object_t();
+        uint64_t          moved   = stats->batches_rebalanced_to_global;
+        uint64_t          retries = stats->global_exchange_retries;
+
+        double per_object = run(pairs, count);
+
+        printf("%6d %18.1f %16"PRIu64" %20"PRIu64"\n", pairs, per_object,
+               stats->batches_rebalanced_to_global - moved, stats->global_exchange_retries - retries);
+    }
+
+    qd_alloc_finalize();
+    return 0;
+}
@@ -19,6 +19,7 @@
 
 #include "test_case.h"
 #include "alloc.h"
+#include <qpid/dispatch/threading.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -32,6 +33,37 @@ qd_alloc_config_t config = {3, 7, 10};
 ALLOC_DECLARE(object_t);
 ALLOC_DEFINE_CONFIG(object_t, sizeof(object_t), 0, &config);
 
+typedef struct {
+    long owner;
+    int  sequence;
+} shared_object_t;
+
+ALLOC_DECLARE(shared_object_t);
+ALLOC_DEFINE(shared_object_t);
+
+typedef struct {
+    unsigned char data[40];
+} slab_object_t;
+
+qd_alloc_config_t slab_config = {3, 7, 10, 64};
+
+ALLOC_DECLARE(slab_object_t);
+ALLOC_DEFINE_CONFIG(slab_object_t, sizeof(slab_object_t), 0, &slab_config);
+
+typedef struct {
+    long owner;
+    int  sequence;
+} churn_object_t;
+
+//
+// A global limit of three batches, so that threads returning batches often find the global
+// pool full and free them to the heap while other threads are taking batches from it.
+//
+qd_alloc_config_t churn_config = {4, 8, 12};
+
+ALLOC_DECLARE(churn_object_t);
+ALLOC_DEFINE_CONFIG(churn_object_t, sizeof(churn_object_t), 0, &churn_config);
+
 
 static char* check_stats(qd_alloc_stats_t *stats, uint64_t ah, uint64_t fh, uint64_t ht, uint64_t rt, uint64_t rg)
 {
@@ -59,12 +91,22 @@ static char* test_alloc_basic(void *context)
         free_object_t(obj[idx]);
     if (error) return error;
 
-    error = check_stats(stats, 21, 5, 6, 0, 5);
+#if USE_ALLOC_ARENAS
+    // Arena memory stays in the pools, so there is no global limit
+    error = check_stats(stats, 21, 0, 6, 0, 5);
+#else
+    // The global limit of 10 holds three batches of three; the other two go to the heap
+    error = check_stats(stats, 21, 6, 6, 0, 5);
+#endif
     if (error) return error;
 
     for (idx = 0; idx < 20; idx++)
         obj[idx] = new_object_t();
-    error = check_stats(stats, 27, 5, 21, 3, 5);
+#if USE_ALLOC_ARENAS
+    error = check_stats(stats, 21, 0, 21, 5, 5);
+#else
+    error = check_stats(stats, 27, 6, 21, 3, 5);
+#endif
     for (idx = 0; idx < 20; idx++)
         free_object_t(obj[idx]);
     if (error) return error;
@@ -72,11 +114,280 @@ static char* test_alloc_basic(void *context)
     return 0;
 }
 
+static char* test_alloc_slab(void *context)
+{
+    slab_object_t    *obj[20];
+    int               idx;
+    qd_alloc_stats_t *stats;
+    char             *error = 0;
+
+    for (idx = 0; idx < 20; idx++) {
+        obj[idx] = new_slab_object_t();
+        if (((uintptr_t) obj[idx]) % 64 != 0) error = "Object is not aligned";
+        memset(obj[idx]->data, idx, sizeof(obj[idx]->data));
+    }
+    for (idx = 0; idx < 20; idx++)
+        for (int i = 0; i < sizeof(obj[idx]->data); i++)
+            if (obj[idx]->data[i] != idx) error = "Objects overlap";
+#ifdef NDEBUG
+    // Without memory debugging, items of a batch are packed at their aligned size
+    if ((uintptr_t) obj[1] - (uintptr_t) obj[0] != 64) error = "Objects are not packed at the alignment";
+#endif
+    stats = alloc_stats_slab_object_t();
+    if (!error)
+        error = check_stats(stats, 21, 0, 21, 0, 0);
+    for (idx = 0; idx < 20; idx++)
+        free_slab_object_t(obj[idx]);
+    if (error) return error;
+
+    // Slab memory stays in the pools, so there is no global limit
+    error = check_stats(stats, 21, 0, 6, 0, 5);
+    if (error) return error;
+
+    for (idx = 0; idx < 20; idx++) {
+        obj[idx] = new_slab_object_t();
+        if (((uintptr_t) obj[idx]) % 64 != 0) error = "Recycled object is not aligned";
+    }
+    if (!error)
+        error = check_stats(stats, 21, 0, 21, 5, 5);
+    for (idx = 0; idx < 20; idx++)
+        free_slab_object_t(obj[idx]);
+
+    return error;
+}
+
+#define PC_PAIRS      2
+#define PC_ITERATIONS 100000
+#define PC_RING_SIZE  64
+
+//
+// A ring of objects passed from a producer thread, which allocates them, to a consumer
+// thread, which frees them.
+//
+typedef struct {
+    sys_mutex_t      *lock;
+    sys_cond_t       *cond;
+    shared_object_t  *ring[PC_RING_SIZE];
+    int               head;
+    int               count;
+    char             *error;
+} pc_ring_t;
+
+
+static void *producer(void *context)
+{
+    pc_ring_t *pc = (pc_ring_t*) context;
+
+    for (int i = 0; i < PC_ITERATIONS; i++) {
+        shared_object_t *obj = new_shared_object_t();
+        obj->owner    = (long) pc;
+        obj->sequence = i;
+
+        sys_mutex_lock(pc->lock);
+        while (pc->count == PC_RING_SIZE)
+            sys_cond_wait(pc->cond, pc->lock);
+        pc->ring[(pc->head + pc->count++) % PC_RING_SIZE] = obj;
+        sys_cond_signal_all(pc->cond);
+        sys_mutex_unlock(pc->lock);
+    }
+
+    return 0;
+}
+
+
+static void *consumer(void *context)
+{
+    pc_ring_t *pc = (pc_ring_t*) context;
+
+    for (int i = 0; i < PC_ITERATIONS; i++) {
+        sys_mutex_lock(pc->lock);
+        while (pc->count == 0)
+            sys_cond_wait(pc->cond, pc->lock);
+        shared_object_t *obj = pc->ring[pc->head];
+        pc->head = (pc->head + 1) % PC_RING_SIZE;
+        pc->count--;
+        sys_cond_signal_all(pc->cond);
+        sys_mutex_unlock(pc->lock);
+
+        if (obj->owner != (long) pc || obj->sequence != i)
+            pc->error = "Object changed while in use";
+        obj->owner = 0;
+        free_shared_object_t(obj);
+    }
+
+    return 0;
+}
+
+
+static char* test_alloc_producer_consumer(void *context)
+{
+    pc_ring_t     rings[PC_PAIRS];
+    sys_thread_t *threads[PC_PAIRS * 2];
+    char         *error = 0;
+
+    // Initialize the type before the threads race to do it
+    free_shared_object_t(new_shared_object_t());
+
+    for (int i = 0; i < PC_PAIRS; i++) {
+        memset(&rings[i], 0, sizeof(pc_ring_t));
+        rings[i].lock = sys_mutex();
+        rings[i].cond = sys_cond();
+        threads[i * 2]     = sys_thread(producer, &rings[i]);
+        threads[i * 2 + 1] = sys_thread(consumer, &rings[i]);
+    }
+
+    for (int i = 0; i < PC_PAIRS * 2; i++) {
+        sys_thread_join(threads[i]);
+        sys_thread_free(threads[i]);
+    }
+
+    for (int i = 0; i < PC_PAIRS; i++) {
+        if (rings[i].error)
+            error = rings[i].error;
+        sys_cond_free(rings[i].cond);
+        sys_mutex_free(rings[i].lock);
+    }
+    if (error) return error;
+
+    //
+    // Objects freed by the consumers are recycled to the producers through the global pool
+    // rather than being allocated from the heap each time.
+    //
+    qd_alloc_stats_t *stats = alloc_stats_shared_object_t();
+    if (stats->total_alloc_from_heap >= PC_PAIRS * PC_ITERATIONS / 10) return "Objects were not recycled";
+    if (stats->batches_rebalanced_to_global == 0) return "No batches were returned to the global pool";
+    if (stats->batches_rebalanced_to_threads == 0) return "No batches were taken from the global pool";
+    if (stats->held_by_threads > stats->total_alloc_from_heap) return "Inconsistent held-by-threads";
+
+    return 0;
+}
+
+
+#define CHURN_THREADS 4
+#define CHURN_ROUNDS  20000
+#define CHURN_BURST   40
+
+typedef struct {
+    sys_mutex_t    *lock;
+    churn_object_t *handoff[CHURN_THREADS][CHURN_BURST];
+    int             handoff_count[CHURN_THREADS];
+    char           *error;
+} churn_t;
+
+typedef struct {
+    churn_t *churn;
+    int      id;
+} churn_thread_t;
+
+
+//
+// Each round allocates a burst of objects, checks that no other thread wrote to them while
+// they were held, and frees them:  half locally and the rest by handing them to the next thread,
+// which frees the objects it was handed at the start of its next round.
+//
+static void *churn_thread(void *context)
+{
+    churn_thread_t *thread = (churn_thread_t*) context;
+    churn_t        *churn  = thread->churn;
+    int             next   = (thread->id + 1) % CHURN_THREADS;
+    churn_object_t *burst[CHURN_BURST];
+    churn_object_t *handed[CHURN_BURST];
+
+    for (int round = 0; round < CHURN_ROUNDS; round++) {
+        sys_mutex_lock(churn->lock);
+        int handed_count = churn->handoff_count[thread->id];
+        memcpy(handed, churn->handoff[thread->id], handed_count * sizeof(churn_object_t*));
+        churn->handoff_count[thread->id] = 0;
+        sys_mutex_unlock(churn->lock);
+
+        for (int i = 0; i < handed_count; i++) {
+            handed[i]->owner = 0;
+            free_churn_object_t(handed[i]);
+        }
+
+        int count = 1 + (round * 7 + thread->id) % CHURN_BURST;
+        for (int i = 0; i < count; i++) {
+            burst[i] = new_churn_object_t();
+            burst[i]->owner    = (long) thread;
+            burst[i]->sequence = i;
+        }
+
+        for (int i = 0; i < count; i++)
+            if (burst[i]->owner != (long) thread || burst[i]->sequence != i)
+                churn->error = "Object changed while in use";
+
+        int keep = count / 2;
+        for (int i = 0; i < keep; i++) {
+            burst[i]->owner = 0;
+            free_churn_object_t(burst[i]);
+        }
+
+        sys_mutex_lock(churn->lock);
+        for (int i = keep; i < count; i++) {
+            if (churn->handoff_count[next] < CHURN_BURST)
+                churn->handoff[next][churn->handoff_count[next]++] = burst[i];
+            else {
+                burst[i]->owner = 0;
+                free_churn_object_t(burst[i]);
+            }
+        }
+        sys_mutex_unlock(churn->lock);
+    }
+
+    return 0;
+}
+
+
+static char* test_alloc_global_churn(void *context)
+{
+    churn_t         churn;
+    churn_thread_t  args[CHURN_THREADS];
+    sys_thread_t   *threads[CHURN_THREADS];
+
+    memset(&churn, 0, sizeof(churn));
+    churn.lock = sys_mutex();
+
+    // Initialize the type before the threads race to do it
+    free_churn_object_t(new_churn_object_t());
+
+    for (int i = 0; i < CHURN_THREADS; i++) {
+        args[i].churn = &churn;
+        args[i].id    = i;
+        threads[i]    = sys_thread(churn_thread, &args[i]);
+    }
+
+    for (int i = 0; i < CHURN_THREADS; i++) {
+        sys_thread_join(threads[i]);
+        sys_thread_free(threads[i]);
+    }
+
+    for (int i = 0; i < CHURN_THREADS; i++)
+        for (int j = 0; j < churn.handoff_count[i]; j++)
+            free_churn_object_t(churn.handoff[i][j]);
+    sys_mutex_free(churn.lock);
+    if (churn.error) return churn.error;
+
+    qd_alloc_stats_t *stats = alloc_stats_churn_object_t();
+    if (stats->batches_rebalanced_to_global == 0) return "No batches were returned to the global pool";
+    if (stats->batches_rebalanced_to_threads == 0) return "No batches were taken from the global pool";
+#if !USE_ALLOC_ARENAS
+    if (stats->total_free_to_heap == 0) return "No batches were returned to the heap";
+#endif
+    if (stats->held_by_threads > stats->total_alloc_from_heap - stats->total_free_to_heap)
+        return "Inconsistent held-by-threads";
+
+    return 0;
+}
+
+
 int alloc_tests(void)
 {
     int result = 0;
 
     TEST_CASE(test_alloc_basic, 0);
+    TEST_CASE(test_alloc_slab, 0);
+    TEST_CASE(test_alloc_producer_consumer, 0);
+    TEST_CASE(test_alloc_global_churn, 0);
 
     return result;
 }
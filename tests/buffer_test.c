@@ -85,11 +85,60 @@ static char *test_buffer_list_clone(void *context)
 }
 
 
+static char *test_buffer_classes(void *context)
+{
+    char        *result = 0;
+    qd_buffer_t *small  = qd_buffer();
+    size_t       capacity = qd_buffer_capacity(small);
+
+    qd_buffer_t *fit    = qd_buffer_sized(capacity);
+    qd_buffer_t *bigger = qd_buffer_sized(capacity + 1);
+    qd_buffer_t *huge   = qd_buffer_sized(1024 * 1024);
+    qd_buffer_t *large  = qd_buffer_of_class(QD_BUFFER_LARGE);
+
+    //
+    // There is no larger class if the default buffer size is very large.
+    //
+    size_t largest = qd_buffer_capacity(large) > capacity ? qd_buffer_capacity(large) : capacity;
+
+    if (qd_buffer_capacity(fit) != capacity)
+        result = "Buffer that fits isn't the default size";
+    else if (qd_buffer_capacity(bigger) <= capacity && capacity < largest)
+        result = "Larger buffer not allocated";
+    else if (qd_buffer_capacity(huge) != largest)
+        result = "Oversized request didn't get the largest buffer";
+    else {
+        //
+        // Buffers of different classes can be mixed in a list.
+        //
+        qd_buffer_list_t list;
+        DEQ_INIT(list);
+        memcpy(qd_buffer_cursor(large), pattern, pattern_len);
+        qd_buffer_insert(large, pattern_len);
+        DEQ_INSERT_TAIL(list, small);
+        DEQ_INSERT_TAIL(list, large);
+        large = small = 0;
+        if (!compare_buffer(&list, (unsigned char *)pattern, pattern_len))
+            result = "Large buffer corrupted";
+        qd_buffer_list_free_buffers(&list);
+    }
+
+    qd_buffer_free(small);
+    qd_buffer_free(fit);
+    qd_buffer_free(bigger);
+    qd_buffer_free(huge);
+    qd_buffer_free(large);
+
+    return result;
+}
+
+
 int buffer_tests()
 {
     int result = 0;
 
     TEST_CASE(test_buffer_list_clone, 0);
+    TEST_CASE(test_buffer_classes, 0);
 
     return result;
 }
@@ -0,0 +1,214 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Measure the rate at which outgoing deliveries pass from the router core to a connection.
+// One thread plays the core and forwards settled deliveries to the links of a connection
+// with qdr_forward_deliver_CT, in batches that activate the connection once, as the core
+// does for a batch of incoming deliveries.  Another plays the connection's I/O thread:  when
+// the connection is activated it runs qdr_connection_process, whose push handler calls
+// qdr_link_process_deliveries as the server does.  The deliver handler only counts, so the
+// cost measured is that of the hand-off and the connection's work lock.
+//
+// Usage: core_connection_bench [deliveries]
+//
+
+#include <qpid/dispatch/message.h>
+#include <qpid/dispatch/threading.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "router_core/router_core_private.h"
+
+#define MAX_LINKS 16
+#define BATCH     64
+#define WINDOW    4096
+
+typedef struct {
+    qdr_core_t       *core;
+    qdr_connection_t *conn;
+    qdr_link_t       *links[MAX_LINKS];
+    sys_mutex_t      *lock;
+    sys_cond_t       *cond;
+    bool              activated;
+    int               total;
+    int               forwarded;
+    int               delivered;        // Only touched by the connection thread
+    int               delivered_shared; // Copy of delivered for the core thread, under lock
+    int               processed;        // Calls of qdr_connection_process that did work
+} bench_t;
+
+
+static void bench_activate(void *context, qdr_connection_t *conn)
+{
+    bench_t *bench = (bench_t*) context;
+
+    sys_mutex_lock(bench->lock);
+    bench->activated = true;
+    sys_cond_signal(bench->cond);
+    sys_mutex_unlock(bench->lock);
+}
+
+
+static void bench_push(void *context, qdr_link_t *link)
+{
+    //
+    // The receiver is taken to have granted credit for everything that is forwarded.
+    //
+    bench_t *bench = (bench_t*) context;
+    qdr_link_process_deliveries(bench->core, link, INT_MAX);
+}
+
+
+static bool bench_deliver(void *context, qdr_link_t *link, qdr_delivery_t *dlv, bool settled)
+{
+    ((bench_t*) context)->delivered++;
+    return true;
+}
+
+
+static void bench_flow(void *context, qdr_link_t *link, int credit) {}
+static void bench_offer(void *context, qdr_link_t *link, int delivery_count) {}
+static void bench_drained(void *context, qdr_link_t *link) {}
+
+
+static void *connection_thread(void *context)
+{
+    bench_t *bench = (bench_t*) context;
+
+    while (bench->delivered < bench->total) {
+        sys_mutex_lock(bench->lock);
+        bench->delivered_shared = bench->delivered;
+        sys_cond_signal(bench->cond);
+        while (!bench->activated)
+            sys_cond_wait(bench->cond, bench->lock);
+        bench->activated = false;
+        sys_mutex_unlock(bench->lock);
+
+        if (qdr_connection_process(bench->conn) > 0)
+            bench->processed++;
+    }
+
+    sys_mutex_lock(bench->lock);
+    bench->delivered_shared = bench->delivered;
+    sys_mutex_unlock(bench->lock);
+    return 0;
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+//
+// Forward the deliveries round-robin over a number of links, keeping about WINDOW of them
+// outstanding, and return the number of millions of deliveries per second.
+//
+static double run(bench_t *bench, qd_message_t *msg, int link_count)
+{
+    bench->activated        = false;
+    bench->forwarded        = 0;
+    bench->delivered        = 0;
+    bench->delivered_shared = 0;
+    bench->processed        = 0;
+
+    double        start  = now_usec();
+    sys_thread_t *thread = sys_thread(connection_thread, bench);
+
+    while (bench->forwarded < bench->total) {
+        sys_mutex_lock(bench->lock);
+        while (bench->forwarded - bench->delivered_shared >= WINDOW)
+            sys_cond_wait(bench->cond, bench->lock);
+        sys_mutex_unlock(bench->lock);
+
+        qdr_connection_defer_activations_CT(bench->core, true);
+        for (int i = 0; i < BATCH && bench->forwarded < bench->total; i++) {
+            qdr_link_t     *link = bench->links[bench->forwarded % link_count];
+            qdr_delivery_t *dlv  = qdr_delivery(link, qd_message_copy(msg), true, 0);
+            qdr_forward_deliver_CT(bench->core, link, dlv);
+            bench->forwarded++;
+        }
+        qdr_connection_defer_activations_CT(bench->core, false);
+    }
+
+    sys_thread_join(thread);
+    sys_thread_free(thread);
+    return bench->total / (now_usec() - start);
+}
+
+
+int main(int argc, char **argv)
+{
+    static const int link_counts[] = {1, 4, 16};
+    int total = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    if (total < 1)
+        return 1;
+
+    qd_alloc_initialize();
+
+    bench_t bench;
+    ZERO(&bench);
+    bench.total = total;
+    bench.lock  = sys_mutex();
+    bench.cond  = sys_cond();
+
+    bench.core = NEW(qdr_core_t);
+    ZERO(bench.core);
+    qdr_connection_handlers(bench.core, &bench, bench_activate, 0, 0, 0, bench_flow,
+                            bench_offer, bench_drained, bench_push, bench_deliver, 0);
+
+    bench.conn = new_qdr_connection_t();
+    ZERO(bench.conn);
+    bench.conn->core      = bench.core;
+    bench.conn->work_lock = sys_mutex();
+
+    for (int i = 0; i < MAX_LINKS; i++) {
+        qdr_link_t *link = new_qdr_link_t();
+        ZERO(link);
+        link->core           = bench.core;
+        link->conn           = bench.conn;
+        link->link_direction = QD_OUTGOING;
+        bench.links[i] = link;
+    }
+
+    qd_message_t *msg = qd_message();
+
+    printf("%6s %18s %24s\n", "links", "deliveries (M/s)", "deliveries per process");
+    for (int i = 0; i < 3; i++) {
+        double rate = run(&bench, msg, link_counts[i]);
+        printf("%6d %18.2f %24.1f\n", link_counts[i], rate, (double) total / bench.processed);
+    }
+
+    qd_message_free(msg);
+    for (int i = 0; i < MAX_LINKS; i++)
+        free_qdr_link_t(bench.links[i]);
+    sys_mutex_free(bench.conn->work_lock);
+    free_qdr_connection_t(bench.conn);
+    free(bench.core);
+    sys_cond_free(bench.cond);
+    sys_mutex_free(bench.lock);
+    qd_alloc_finalize();
+    return 0;
+}
@@ -19,6 +19,7 @@
 
 #include "test_case.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <qpid/dispatch/iterator.h>
 #include <qpid/dispatch/hash.h>
@@ -648,6 +649,141 @@ static char *test_qd_hash_retrieve_prefix_separator_exact_match_dot_at_end_1(voi
 }
 
 
+#define HASH_TEST_ADDRESSES 20000
+
+static void hash_test_address(char *text, size_t len, int i)
+{
+    snprintf(text, len, "org.example.service%d/queue%d", i, i % 97);
+}
+
+
+static char *test_qd_hash_grow(void *context)
+{
+    //
+    // Start with a tiny table so that it is grown many times, removing addresses while items
+    // are being moved to the bigger tables.
+    //
+    qd_hash_t         *hash    = qd_hash(3, 32, 0);
+    qd_hash_handle_t **handles = (qd_hash_handle_t**) calloc(HASH_TEST_ADDRESSES, sizeof(qd_hash_handle_t*));
+    static int         values[HASH_TEST_ADDRESSES];
+    char               text[100];
+    char              *result  = 0;
+    size_t             size    = 0;
+
+    for (int i = 0; i < HASH_TEST_ADDRESSES && !result; i++) {
+        hash_test_address(text, sizeof(text), i);
+        qd_field_iterator_t *iter = qd_address_iterator_string(text, ITER_VIEW_ADDRESS_HASH);
+        values[i] = i;
+        if (qd_hash_insert(hash, iter, &values[i], &handles[i]) != QD_ERROR_NONE)
+            result = "Insert failed";
+        qd_field_iterator_free(iter);
+        size++;
+
+        if (i % 3 == 2) {
+            if (qd_hash_remove_by_handle(hash, handles[i - 1]) != QD_ERROR_NONE)
+                result = "Remove by handle failed";
+            qd_hash_handle_free(handles[i - 1]);
+            handles[i - 1] = 0;
+            size--;
+        }
+    }
+
+    if (!result && qd_hash_size(hash) != size)
+        result = "Wrong size after inserts";
+
+    for (int i = 0; i < HASH_TEST_ADDRESSES && !result; i++) {
+        void *val;
+        hash_test_address(text, sizeof(text), i);
+        qd_field_iterator_t *iter = qd_address_iterator_string(text, ITER_VIEW_ADDRESS_HASH);
+        qd_hash_retrieve(hash, iter, &val);
+        if (handles[i] ? val != &values[i] : val != 0)
+            result = "Retrieved the wrong value";
+        if (!result && handles[i] && i % 2 == 0) {
+            if (qd_hash_remove(hash, iter) != QD_ERROR_NONE)
+                result = "Remove by key failed";
+            qd_hash_handle_free(handles[i]);
+            handles[i] = 0;
+            size--;
+        }
+        qd_field_iterator_free(iter);
+    }
+
+    if (!result && qd_hash_size(hash) != size)
+        result = "Wrong size after removals";
+
+    for (int i = 0; i < HASH_TEST_ADDRESSES; i++) {
+        if (handles[i] && !result) {
+            const unsigned char *key = qd_hash_key_by_handle(handles[i]);
+            hash_test_address(text, sizeof(text), i);
+            if (!key || strcmp((const char*) key + 2, text))
+                result = "Wrong key for handle";
+        }
+        qd_hash_handle_free(handles[i]);
+    }
+
+    free(handles);
+    qd_hash_free(hash);
+    return result;
+}
+
+
+static void hash_corpus_address(char *text, size_t len, int i)
+{
+    //
+    // Long, mostly alike addresses in the style of a hierarchical naming scheme.
+    //
+    snprintf(text, len, "amqp:/tenant-%04d.region-%02d/services/order-processing.v%d/partition-%05d/queue.%s",
+             i % 200, i % 13, i % 7, i, (i & 1) ? "priority" : "standard");
+}
+
+
+static char *test_hash_function_corpus(void *context)
+{
+    //
+    // The hash of an address must not depend on how it is split across buffers, and it
+    // must spread a corpus of similar addresses evenly.
+    //
+    const int  buckets = 4096;
+    int       *load    = (int*) calloc(buckets, sizeof(int));
+    char       text[200];
+    char      *result  = 0;
+
+    for (int i = 0; i < HASH_TEST_ADDRESSES && !result; i++) {
+        hash_corpus_address(text, sizeof(text), i);
+
+        qd_field_iterator_t *iter = qd_address_iterator_string(text, ITER_VIEW_ADDRESS_HASH);
+        uint32_t             hash = qd_iterator_hash_function(iter);
+        qd_field_iterator_free(iter);
+
+        load[hash % buckets]++;
+
+        if (i % 100 == 0) {
+            for (int segment = 1; segment < 12 && !result; segment += 5) {
+                qd_buffer_list_t chain;
+                DEQ_INIT(chain);
+                build_buffer_chain(&chain, text, segment);
+                iter = qd_address_iterator_buffer(DEQ_HEAD(chain), 0, strlen(text), ITER_VIEW_ADDRESS_HASH);
+                if (qd_iterator_hash_function(iter) != hash)
+                    result = "Hash depends on buffer boundaries";
+                qd_field_iterator_free(iter);
+                release_buffer_chain(&chain);
+            }
+        }
+    }
+
+    //
+    // With 20000 addresses in 4096 buckets the expected load is under five; allow for
+    // ordinary variance but not for clustering.
+    //
+    for (int b = 0; b < buckets && !result; b++)
+        if (load[b] > 20)
+            result = "Hash clusters the address corpus";
+
+    free(load);
+    return result;
+}
+
+
 int field_tests(void)
 {
     int result = 0;
@@ -672,6 +808,8 @@ int field_tests(void)
     TEST_CASE(test_qd_hash_retrieve_prefix_separator_exact_match_slashes, 0);
     TEST_CASE(test_qd_hash_retrieve_prefix_separator_exact_match_dot_at_end, 0);
     TEST_CASE(test_qd_hash_retrieve_prefix_separator_exact_match_dot_at_end_1, 0);
+    TEST_CASE(test_qd_hash_grow, 0);
+    TEST_CASE(test_hash_function_corpus, 0);
 
     return result;
 }
@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Time the operations of the address table over a set of mobile addresses.  One table starts
+// with 8 slots, as a table that is sized too small at creation, and is grown while the
+// addresses are inserted.  The other is created big enough for all of them.  Each operation
+// includes building the address iterator, as the router does for every lookup.
+//
+// Usage: hash_bench [addresses]
+//
+
+#include <qpid/dispatch/hash.h>
+#include <qpid/dispatch/iterator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "alloc.h"
+
+#define ADDRESS_MAX 100
+
+typedef enum {
+    OP_INSERT,
+    OP_LOOKUP,
+    OP_MISS,
+    OP_REMOVE,
+    OP_COUNT
+} bench_op_t;
+
+static const char *op_names[OP_COUNT] = {"insert", "lookup", "lookup (absent)", "remove by handle"};
+
+
+static void bench_address(char *text, int i)
+{
+    snprintf(text, ADDRESS_MAX, "tenant-%04d.region-%02d/orders.v%d/client-%07d", i % 500, i % 13, i % 3, i);
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+//
+// Run each operation over all the addresses and record the mean time per operation in
+// nanoseconds.
+//
+static void run(int bucket_exponent, char *texts, int count, double *result)
+{
+    qd_hash_t         *hash    = qd_hash(bucket_exponent, 32, 0);
+    qd_hash_handle_t **handles = (qd_hash_handle_t**) calloc(count, sizeof(qd_hash_handle_t*));
+    char               absent[ADDRESS_MAX];
+    void              *val;
+    double             start;
+
+    start = now_usec();
+    for (int i = 0; i < count; i++) {
+        qd_field_iterator_t *iter = qd_address_iterator_string(texts + i * ADDRESS_MAX, ITER_VIEW_ADDRESS_HASH);
+        qd_hash_insert(hash, iter, texts + i * ADDRESS_MAX, &handles[i]);
+        qd_field_iterator_free(iter);
+    }
+    result[OP_INSERT] = (now_usec() - start) * 1e3 / count;
+
+    start = now_usec();
+    for (int i = 0; i < count; i++) {
+        qd_field_iterator_t *iter = qd_address_iterator_string(texts + i * ADDRESS_MAX, ITER_VIEW_ADDRESS_HASH);
+        qd_hash_retrieve(hash, iter, &val);
+        qd_field_iterator_free(iter);
+        if (val != texts + i * ADDRESS_MAX) {
+            fprintf(stderr, "Address %d not found\n", i);
+            exit(1);
+        }
+    }
+    result[OP_LOOKUP] = (now_usec() - start) * 1e3 / count;
+
+    start = now_usec();
+    for (int i = 0; i < count; i++) {
+        bench_address(absent, count + i);
+        qd_field_iterator_t *iter = qd_address_iterator_string(absent, ITER_VIEW_ADDRESS_HASH);
+        qd_hash_retrieve(hash, iter, &val);
+        qd_field_iterator_free(iter);
+    }
+    result[OP_MISS] = (now_usec() - start) * 1e3 / count;
+
+    start = now_usec();
+    for (int i = 0; i < count; i++) {
+        qd_hash_remove_by_handle(hash, handles[i]);
+        qd_hash_handle_free(handles[i]);
+    }
+    result[OP_REMOVE] = (now_usec() - start) * 1e3 / count;
+
+    free(handles);
+    qd_hash_free(hash);
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 500000;
+
+    if (count < 1)
+        return 1;
+
+    qd_alloc_initialize();
+    qd_field_iterator_set_address("area", "router");
+
+    char *texts = (char*) malloc((size_t) count * ADDRESS_MAX);
+    for (int i = 0; i < count; i++)
+        bench_address(texts + i * ADDRESS_MAX, i);
+
+    int exponent = 3;
+    while ((1 << exponent) < count * 2)
+        exponent++;
+
+    double grown[OP_COUNT];
+    double presized[OP_COUNT];
+    run(3, texts, count, grown);
+    run(exponent, texts, count, presized);
+
+    printf("%d addresses\n", count);
+    printf("%-18s %12s %14s\n", "operation", "grown (ns)", "presized (ns)");
+    for (int op = 0; op < OP_COUNT; op++)
+        printf("%-18s %12.1f %14.1f\n", op_names[op], grown[op], presized[op]);
+
+    free(texts);
+    qd_alloc_finalize();
+    return 0;
+}
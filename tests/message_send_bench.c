@@ -0,0 +1,221 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Compare two ways of handing a message's buffer chain to a Proton link:  one pn_link_send
+// per buffer, as qd_message_send does, and gathering the chain into one contiguous run that
+// is sent with a single call.  The link is connected through a pair of in-memory transports
+// so that the cost of Proton's copy and framing is included.
+//
+// Usage: message_send_bench [iterations]
+//
+
+#include <qpid/dispatch/buffer.h>
+#include <proton/connection.h>
+#include <proton/delivery.h>
+#include <proton/link.h>
+#include <proton/session.h>
+#include <proton/transport.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "alloc.h"
+
+typedef struct {
+    pn_connection_t *conn[2];
+    pn_transport_t  *tport[2];
+    pn_link_t       *sender;
+    pn_link_t       *receiver;
+} bench_pair_t;
+
+
+static bool move_octets(pn_transport_t *from, pn_transport_t *to)
+{
+    ssize_t pending = pn_transport_pending(from);
+    if (pending <= 0)
+        return false;
+
+    ssize_t taken = pn_transport_push(to, pn_transport_head(from), pending);
+    if (taken <= 0)
+        return false;
+
+    pn_transport_pop(from, taken);
+    return true;
+}
+
+
+static void pump(bench_pair_t *pair)
+{
+    bool moved = true;
+    while (moved) {
+        moved  = move_octets(pair->tport[0], pair->tport[1]);
+        moved |= move_octets(pair->tport[1], pair->tport[0]);
+    }
+}
+
+
+static void bench_pair_open(bench_pair_t *pair)
+{
+    for (int i = 0; i < 2; i++) {
+        pair->conn[i]  = pn_connection();
+        pair->tport[i] = pn_transport();
+        pn_transport_bind(pair->tport[i], pair->conn[i]);
+        pn_connection_open(pair->conn[i]);
+    }
+    pn_transport_set_server(pair->tport[1]);
+
+    pn_session_t *ssn = pn_session(pair->conn[0]);
+    pn_session_open(ssn);
+    pair->sender = pn_sender(ssn, "bench");
+    pn_link_open(pair->sender);
+    pump(pair);
+
+    ssn = pn_session_head(pair->conn[1], PN_LOCAL_UNINIT);
+    pn_session_open(ssn);
+    pair->receiver = pn_link_head(pair->conn[1], PN_LOCAL_UNINIT);
+    pn_link_open(pair->receiver);
+    pump(pair);
+}
+
+
+static void bench_pair_close(bench_pair_t *pair)
+{
+    for (int i = 0; i < 2; i++) {
+        pn_transport_unbind(pair->tport[i]);
+        pn_transport_free(pair->tport[i]);
+        pn_connection_free(pair->conn[i]);
+    }
+}
+
+
+//
+// Pump until the receiver has the whole delivery, reading it as it arrives so the session
+// window stays open.
+//
+static void receive_all(bench_pair_t *pair)
+{
+    static char sink[65536];
+
+    for (;;) {
+        pump(pair);
+        pn_delivery_t *dlv = pn_link_current(pair->receiver);
+        if (!dlv || !pn_delivery_readable(dlv))
+            continue;
+
+        ssize_t result;
+        while ((result = pn_link_recv(pair->receiver, sink, sizeof(sink))) > 0)
+            ;
+        if (result == PN_EOS) {
+            pn_link_advance(pair->receiver);
+            pn_delivery_settle(dlv);
+            return;
+        }
+    }
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+static double run(bench_pair_t *pair, qd_buffer_list_t *chain, size_t size, bool gather, int iterations)
+{
+    char   *staging = gather ? (char*) malloc(size) : 0;
+    double  start   = now_usec();
+
+    for (int i = 0; i < iterations; i++) {
+        pn_link_flow(pair->receiver, 1);
+        pump(pair);
+
+        char tag[16];
+        int  tag_len = snprintf(tag, sizeof(tag), "%d", i);
+        pn_delivery_t *dlv = pn_delivery(pair->sender, pn_dtag(tag, tag_len));
+
+        qd_buffer_t *buf = DEQ_HEAD(*chain);
+        if (gather) {
+            size_t offset = 0;
+            while (buf) {
+                memcpy(staging + offset, qd_buffer_base(buf), qd_buffer_size(buf));
+                offset += qd_buffer_size(buf);
+                buf = DEQ_NEXT(buf);
+            }
+            pn_link_send(pair->sender, staging, offset);
+        } else {
+            while (buf) {
+                pn_link_send(pair->sender, (const char*) qd_buffer_base(buf), qd_buffer_size(buf));
+                buf = DEQ_NEXT(buf);
+            }
+        }
+        pn_link_advance(pair->sender);
+
+        receive_all(pair);
+        pn_delivery_settle(dlv);
+    }
+
+    double elapsed = now_usec() - start;
+    free(staging);
+    return elapsed / iterations;
+}
+
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = {1024, 64 * 1024, 1024 * 1024};
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+
+    if (iterations < 1)
+        return 1;
+
+    qd_alloc_initialize();
+
+    printf("%10s %8s %16s %16s\n", "size", "buffers", "per-buffer (us)", "gathered (us)");
+    for (int i = 0; i < 3; i++) {
+        qd_buffer_list_t chain;
+        size_t           remaining = sizes[i];
+
+        DEQ_INIT(chain);
+        while (remaining > 0) {
+            qd_buffer_t *buf     = qd_buffer();
+            size_t       segment = qd_buffer_capacity(buf);
+            if (segment > remaining)
+                segment = remaining;
+            memset(qd_buffer_base(buf), 'x', segment);
+            qd_buffer_insert(buf, segment);
+            DEQ_INSERT_TAIL(chain, buf);
+            remaining -= segment;
+        }
+
+        bench_pair_t pair;
+        bench_pair_open(&pair);
+        double per_buffer = run(&pair, &chain, sizes[i], false, iterations);
+        double gathered   = run(&pair, &chain, sizes[i], true, iterations);
+        bench_pair_close(&pair);
+
+        printf("%10zu %8zu %16.2f %16.2f\n", sizes[i], DEQ_SIZE(chain), per_buffer, gathered);
+        qd_buffer_list_free_buffers(&chain);
+    }
+
+    qd_alloc_finalize();
+    return 0;
+}
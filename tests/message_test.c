@@ -42,15 +42,15 @@ static size_t flatten_bufs(qd_message_content_t *content)
 }
 
 
-static void set_content(qd_message_content_t *content, size_t len)
+static void append_content(qd_message_content_t *content, size_t offset, size_t len)
 {
-    char        *cursor = buffer;
+    char        *cursor = buffer + offset;
     qd_buffer_t *buf;
 
-    while (len > (size_t) (cursor - buffer)) {
+    while (offset + len > (size_t) (cursor - buffer)) {
         buf = qd_buffer();
         size_t segment   = qd_buffer_capacity(buf);
-        size_t remaining = len - (size_t) (cursor - buffer);
+        size_t remaining = offset + len - (size_t) (cursor - buffer);
         if (segment > remaining)
             segment = remaining;
         memcpy(qd_buffer_base(buf), cursor, segment);
@@ -61,6 +61,12 @@ static void set_content(qd_message_content_t *content, size_t len)
 }
 
 
+static void set_content(qd_message_content_t *content, size_t len)
+{
+    append_content(content, 0, len);
+}
+
+
 static char* test_send_to_messenger(void *context)
 {
     qd_message_t         *msg     = qd_message();
@@ -286,6 +292,106 @@ static char* test_send_message_annotations(void *context)
 }
 
 
+static char* test_check_partial(void *context)
+{
+    pn_message_t *pn_msg = pn_message();
+    pn_message_set_address(pn_msg, "test_addr_2");
+
+    size_t       size = 10000;
+    int result = pn_message_encode(pn_msg, buffer, &size);
+    if (result != 0) return "Error in pn_message_encode";
+
+    qd_message_t         *msg     = qd_message();
+    qd_message_content_t *content = MSG_CONTENT(msg);
+    content->receive_complete = false;
+
+    if (qd_message_check_depth(msg, QD_DEPTH_PROPERTIES) != QD_MESSAGE_DEPTH_INCOMPLETE)
+        return "Expected 'incomplete' for a message with no data";
+
+    append_content(content, 0, 8);
+    if (qd_message_check_depth(msg, QD_DEPTH_PROPERTIES) != QD_MESSAGE_DEPTH_INCOMPLETE)
+        return "Expected 'incomplete' for a partial first section";
+
+    //
+    // The properties are the last section, so they can't be checked until the
+    // message is known to be complete.
+    //
+    append_content(content, 8, size - 8);
+    if (qd_message_check_depth(msg, QD_DEPTH_PROPERTIES) != QD_MESSAGE_DEPTH_INCOMPLETE)
+        return "Expected 'incomplete' for a section at the end of a partial message";
+    if (qd_message_field_iterator(msg, QD_FIELD_TO) != 0)
+        return "Unexpected 'to' field in a partial message";
+
+    content->receive_complete = true;
+    if (qd_message_check_depth(msg, QD_DEPTH_PROPERTIES) != QD_MESSAGE_DEPTH_OK)
+        return "Expected 'ok' for the complete message";
+
+    qd_field_iterator_t *iter = qd_message_field_iterator(msg, QD_FIELD_TO);
+    if (iter == 0) return "Expected an iterator for the 'to' field";
+    if (!qd_field_iterator_equal(iter, (unsigned char*) "test_addr_2"))
+        return "Mismatched 'to' field contents";
+    qd_field_iterator_free(iter);
+
+    pn_message_free(pn_msg);
+    qd_message_free(msg);
+
+    return 0;
+}
+
+
+static char* test_shared_annotations(void *context)
+{
+    qd_message_t *msg = qd_message();
+
+    qd_composed_field_t *ingress = qd_compose_subfield(0);
+    qd_compose_insert_string(ingress, "distress");
+    qd_message_set_ingress_annotation(msg, ingress);
+
+    qd_message_t             *copy1  = qd_message_copy(msg);
+    qd_message_t             *copy2  = qd_message_copy(msg);
+    qd_message_annotations_t *shared = ((qd_message_pvt_t*) msg)->ma;
+    qd_buffer_list_t         *ma1    = 0;
+    qd_buffer_list_t          local;
+    char                     *result = 0;
+
+    DEQ_INIT(local);
+
+    //
+    // Copying the message allocates nothing for the annotations, and the copies share one
+    // encoding of them.
+    //
+    if (!shared || ((qd_message_pvt_t*) copy1)->ma != shared || ((qd_message_pvt_t*) copy2)->ma != shared)
+        result = "Copies didn't share the annotations";
+    else {
+        ma1 = qd_message_outbound_annotations(copy1, &local);
+        if (!ma1 || ma1 == &local || DEQ_IS_EMPTY(*ma1))
+            result = "First copy didn't cache its annotations";
+        else if (qd_message_outbound_annotations(copy2, &local) != ma1 || !DEQ_IS_EMPTY(local))
+            result = "Second copy didn't use the cached annotations";
+    }
+
+    //
+    // Changing the annotations of a copy stops it sharing them.
+    //
+    if (!result) {
+        qd_message_set_phase_annotation(copy2, 1);
+        if (((qd_message_pvt_t*) copy2)->ma == shared || ((qd_message_pvt_t*) copy1)->ma != shared)
+            result = "Changed copy didn't get its own annotations";
+        else if (qd_message_outbound_annotations(copy2, &local) == ma1)
+            result = "Changed copy used the cached annotations";
+        else if (qd_message_outbound_annotations(copy1, &local) != ma1)
+            result = "Unchanged copy lost the cached annotations";
+    }
+
+    qd_buffer_list_free_buffers(&local);
+    qd_message_free(copy2);
+    qd_message_free(copy1);
+    qd_message_free(msg);
+
+    return result;
+}
+
+
 int message_tests(void)
 {
     int result = 0;
@@ -295,6 +401,8 @@ int message_tests(void)
     TEST_CASE(test_message_properties, 0);
     TEST_CASE(test_check_multiple, 0);
     TEST_CASE(test_send_message_annotations, 0);
+    TEST_CASE(test_check_partial, 0);
+    TEST_CASE(test_shared_annotations, 0);
 
     return result;
 }
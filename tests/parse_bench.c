@@ -0,0 +1,157 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+//
+// Time parsing an application-properties style map, whose odd entries hold nested lists, in
+// three ways it is used:  looking up one key, as the router does for its annotations; visiting
+// every entry by index; and looking up every key by name.  Each figure includes parsing the
+// map and freeing the parsed tree.
+//
+// Usage: parse_bench [iterations]
+//
+
+#include <qpid/dispatch/compose.h>
+#include <qpid/dispatch/iterator.h>
+#include <qpid/dispatch/parse.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "alloc.h"
+
+typedef enum {
+    USE_ONE_KEY,
+    USE_BY_INDEX,
+    USE_BY_KEY,
+    USE_COUNT
+} bench_use_t;
+
+
+static void compose_map(qd_buffer_list_t *list, int entries)
+{
+    qd_composed_field_t *comp = qd_compose_subfield(0);
+    char                 key[32];
+
+    qd_compose_start_map(comp);
+    for (int i = 0; i < entries; i++) {
+        snprintf(key, sizeof(key), "property-%d", i);
+        qd_compose_insert_string(comp, key);
+        if (i & 1) {
+            qd_compose_start_list(comp);
+            qd_compose_insert_uint(comp, i);
+            qd_compose_insert_string(comp, key);
+            qd_compose_insert_ulong(comp, (uint64_t) i << 32);
+            qd_compose_end_list(comp);
+        } else
+            qd_compose_insert_uint(comp, i);
+    }
+    qd_compose_end_map(comp);
+
+    DEQ_INIT(*list);
+    qd_compose_take_buffers(comp, list);
+    qd_compose_free(comp);
+}
+
+
+static double now_usec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+//
+// Return the mean time in microseconds to parse the map and use it as given.
+//
+static double run(qd_buffer_list_t *list, int entries, bench_use_t use, int iterations)
+{
+    char (*keys)[32] = malloc(entries * sizeof(*keys));
+    int    length    = 0;
+    int    found     = 0;
+
+    for (int i = 0; i < entries; i++)
+        snprintf(keys[i], sizeof(keys[i]), "property-%d", i);
+    for (qd_buffer_t *buf = DEQ_HEAD(*list); buf; buf = DEQ_NEXT(buf))
+        length += qd_buffer_size(buf);
+
+    double start = now_usec();
+    for (int n = 0; n < iterations; n++) {
+        qd_field_iterator_t *iter = qd_address_iterator_buffer(DEQ_HEAD(*list), 0, length, ITER_VIEW_ALL);
+        qd_parsed_field_t   *pf   = qd_parse(iter);
+
+        switch (use) {
+        case USE_ONE_KEY:
+            found += qd_parse_value_by_key(pf, keys[entries - 1]) != 0;
+            break;
+
+        case USE_BY_INDEX:
+            for (int i = 0; i < entries; i++)
+                found += qd_parse_sub_key(pf, i) != 0 && qd_parse_sub_value(pf, i) != 0;
+            break;
+
+        case USE_BY_KEY:
+            for (int i = 0; i < entries; i++)
+                found += qd_parse_value_by_key(pf, keys[i]) != 0;
+            break;
+
+        default:
+            break;
+        }
+
+        qd_parse_free(pf);
+        qd_field_iterator_free(iter);
+    }
+    double elapsed = now_usec() - start;
+
+    free(keys);
+    if (found != iterations * (use == USE_ONE_KEY ? 1 : entries)) {
+        fprintf(stderr, "Entries of the %d-entry map were not found\n", entries);
+        exit(1);
+    }
+
+    return elapsed / iterations;
+}
+
+
+int main(int argc, char **argv)
+{
+    static const int sizes[] = {10, 100, 1000};
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+
+    if (iterations < 1)
+        return 1;
+
+    qd_alloc_initialize();
+
+    printf("%8s %14s %15s %13s\n", "entries", "one key (us)", "by index (us)", "by key (us)");
+    for (int i = 0; i < 3; i++) {
+        qd_buffer_list_t list;
+        double           result[USE_COUNT];
+
+        compose_map(&list, sizes[i]);
+        for (int use = 0; use < USE_COUNT; use++)
+            result[use] = run(&list, sizes[i], (bench_use_t) use, iterations);
+        qd_buffer_list_free_buffers(&list);
+
+        printf("%8d %14.2f %15.2f %13.2f\n", sizes[i], result[USE_ONE_KEY], result[USE_BY_INDEX], result[USE_BY_KEY]);
+    }
+
+    qd_alloc_finalize();
+    return 0;
+}
@@ -125,6 +125,7 @@ struct err_vector_t {
 {"\xb0\x00\x00\x00", 4, "Insufficient Data to Determine Length"},        // 7
 {"\xc0\x04",         2, "Insufficient Data to Determine Count"},         // 8
 {"\xd0\x00\x00\x00\x00\x00\x00\x00\x01",  9, "Insufficient Length to Determine Count"}, // 9
+{"\xc1\x09\x02\xa1\x01" "a" "\xc0\x03\x02\x50\x01", 11, "Insufficient Data to Determine Tag"}, // 10
 {0, 0, 0}
 };
 
@@ -210,6 +211,16 @@ static char *test_tracemask(void *context)
         return error;
     }
 
+    //
+    // The same trace list is answered from the cache with the same mask.
+    //
+    qd_bitmask_t *again = qd_tracemask_create(tm, pf);
+    if (again != bm) {
+        sprintf(error, "Expected the cached mask for a repeated trace list");
+        return error;
+    }
+    qd_bitmask_free(again);
+
     qd_bitmask_free(bm);
     qd_tracemask_del_router(tm, 3);
     qd_tracemask_remove_link(tm, 0);
@@ -229,11 +240,234 @@ static char *test_tracemask(void *context)
         return error;
     }
 
+    //
+    // The cache holds the other reference to the mask; freeing the tracemask releases it.
+    //
+    qd_bitmask_free(bm);
     qd_tracemask_free(tm);
     return 0;
 }
 
 
+static char *test_parse_large_map(void *context)
+{
+    static char          error[1024];
+    qd_composed_field_t *comp = qd_compose_subfield(0);
+    qd_buffer_list_t     list;
+    char                 key[32];
+    char                 value[32];
+    int                  entries = 200;
+
+    //
+    // A map this size does not fit in the parser's first arena block.
+    //
+    qd_compose_start_map(comp);
+    for (int i = 0; i < entries; i++) {
+        snprintf(key, sizeof(key), "key-%d", i);
+        snprintf(value, sizeof(value), "value-%d", i);
+        qd_compose_insert_string(comp, key);
+        qd_compose_insert_string(comp, value);
+    }
+    qd_compose_end_map(comp);
+
+    DEQ_INIT(list);
+    qd_compose_take_buffers(comp, &list);
+    qd_compose_free(comp);
+
+    int length = 0;
+    for (qd_buffer_t *buf = DEQ_HEAD(list); buf; buf = DEQ_NEXT(buf))
+        length += qd_buffer_size(buf);
+
+    qd_field_iterator_t *iter = qd_address_iterator_buffer(DEQ_HEAD(list), 0, length, ITER_VIEW_ALL);
+    qd_parsed_field_t   *pf   = qd_parse(iter);
+
+    if (!qd_parse_ok(pf)) {
+        sprintf(error, "Parse failed: %s", qd_parse_error(pf));
+        return error;
+    }
+    if (!qd_parse_is_map(pf) || qd_parse_sub_count(pf) != entries) {
+        sprintf(error, "Expected a map of %d entries, got %d", entries, qd_parse_sub_count(pf));
+        return error;
+    }
+
+    for (int i = 0; i < entries; i++) {
+        snprintf(key, sizeof(key), "key-%d", i);
+        snprintf(value, sizeof(value), "value-%d", i);
+        if (!qd_field_iterator_equal(qd_parse_raw(qd_parse_sub_key(pf, i)), (unsigned char*) key) ||
+            !qd_field_iterator_equal(qd_parse_raw(qd_parse_sub_value(pf, i)), (unsigned char*) value)) {
+            sprintf(error, "Entry %d does not match", i);
+            return error;
+        }
+    }
+
+    qd_parse_free(pf);
+    qd_field_iterator_free(iter);
+    qd_buffer_list_free_buffers(&list);
+    return 0;
+}
+
+
+static char *test_parse_nested_map(void *context)
+{
+    static char          error[1024];
+    qd_composed_field_t *comp = qd_compose_subfield(0);
+    qd_buffer_list_t     list;
+    char                 key[32];
+    int                  entries = 1000;
+
+    //
+    // An application-properties style map whose odd entries hold nested lists.  Look-ups by
+    // key and by index must not depend on walking the entries before them, and the nested
+    // lists are only built when they are asked for.
+    //
+    qd_compose_start_map(comp);
+    for (int i = 0; i < entries; i++) {
+        snprintf(key, sizeof(key), "property-%d", i);
+        qd_compose_insert_string(comp, key);
+        if (i & 1) {
+            qd_compose_start_list(comp);
+            qd_compose_insert_uint(comp, i);
+            qd_compose_insert_string(comp, key);
+            qd_compose_insert_ulong(comp, (uint64_t) i << 32);
+            qd_compose_end_list(comp);
+        } else
+            qd_compose_insert_uint(comp, i);
+    }
+    qd_compose_end_map(comp);
+
+    DEQ_INIT(list);
+    qd_compose_take_buffers(comp, &list);
+    qd_compose_free(comp);
+
+    int length = 0;
+    for (qd_buffer_t *buf = DEQ_HEAD(list); buf; buf = DEQ_NEXT(buf))
+        length += qd_buffer_size(buf);
+
+    qd_field_iterator_t *iter = qd_address_iterator_buffer(DEQ_HEAD(list), 0, length, ITER_VIEW_ALL);
+    qd_parsed_field_t   *pf   = qd_parse(iter);
+
+    if (!qd_parse_ok(pf)) {
+        sprintf(error, "Parse failed: %s", qd_parse_error(pf));
+        return error;
+    }
+    if (qd_parse_sub_count(pf) != entries) {
+        sprintf(error, "Expected a map of %d entries, got %d", entries, qd_parse_sub_count(pf));
+        return error;
+    }
+
+    qd_parsed_field_t *value = qd_parse_value_by_key(pf, "property-999");
+    if (!value || !qd_parse_is_list(value) || qd_parse_sub_count(value) != 3) {
+        sprintf(error, "property-999 is not a list of three");
+        return error;
+    }
+
+    //
+    // Building the list's sub-fields must not move an iterator already taken from it.
+    //
+    qd_field_iterator_t *raw = qd_parse_raw(value);
+    qd_field_iterator_advance(raw, 1);
+    uint32_t remaining = qd_field_iterator_remaining(raw);
+    if (qd_parse_as_uint(qd_parse_sub_value(value, 0)) != 999 ||
+        !qd_field_iterator_equal(qd_parse_raw(qd_parse_sub_value(value, 1)), (unsigned char*) "property-999") ||
+        qd_parse_as_ulong(qd_parse_sub_value(value, 2)) != (uint64_t) 999 << 32 ||
+        qd_parse_sub_value(value, 3) != 0) {
+        sprintf(error, "property-999 has the wrong content");
+        return error;
+    }
+    if (qd_field_iterator_remaining(raw) != remaining) {
+        sprintf(error, "Expanding property-999 moved its raw iterator");
+        return error;
+    }
+
+    for (int i = entries - 1; i >= 0; i -= 7) {
+        value = qd_parse_sub_value(pf, i);
+        if (i & 1)
+            value = qd_parse_sub_value(value, 0);
+        if (!value || qd_parse_as_uint(value) != i) {
+            sprintf(error, "Entry %d does not match", i);
+            return error;
+        }
+    }
+
+    if (qd_parse_sub_key(pf, entries) || qd_parse_sub_value(pf, entries)) {
+        sprintf(error, "Access past the end of the map succeeded");
+        return error;
+    }
+
+    qd_parse_free(pf);
+    qd_field_iterator_free(iter);
+    qd_buffer_list_free_buffers(&list);
+    return 0;
+}
+
+
+static char *test_parse_splice_list(void *context)
+{
+    static char          error[1024];
+    qd_buffer_list_t     list;
+    char                 id[256];
+    int                  hops = 5;
+
+    //
+    // Pass a trace list along a chain of routers the way a transit router does, copying the
+    // encoded entries and appending its own.  The ids are long enough that the list spans
+    // buffers.
+    //
+    DEQ_INIT(list);
+    for (int hop = 0; hop < hops; hop++) {
+        qd_composed_field_t *comp = qd_compose_subfield(0);
+        qd_compose_start_list(comp);
+        if (!DEQ_IS_EMPTY(list)) {
+            int length = 0;
+            for (qd_buffer_t *buf = DEQ_HEAD(list); buf; buf = DEQ_NEXT(buf))
+                length += qd_buffer_size(buf);
+
+            qd_field_iterator_t *iter  = qd_address_iterator_buffer(DEQ_HEAD(list), 0, length, ITER_VIEW_ALL);
+            qd_parsed_field_t   *trace = qd_parse(iter);
+            if (!qd_parse_ok(trace) || qd_parse_sub_count(trace) != hop) {
+                sprintf(error, "Hop %d: bad trace", hop);
+                return error;
+            }
+            qd_compose_insert_encoded(comp, qd_parse_raw(trace), qd_parse_raw_length(trace),
+                                      qd_parse_sub_count(trace));
+            qd_parse_free(trace);
+            qd_field_iterator_free(iter);
+            qd_buffer_list_free_buffers(&list);
+        }
+        memset(id, 'a' + hop, 200);
+        sprintf(id + 200, "/router-%d", hop);
+        qd_compose_insert_string(comp, id);
+        qd_compose_end_list(comp);
+        qd_compose_take_buffers(comp, &list);
+        qd_compose_free(comp);
+    }
+
+    int length = 0;
+    for (qd_buffer_t *buf = DEQ_HEAD(list); buf; buf = DEQ_NEXT(buf))
+        length += qd_buffer_size(buf);
+
+    qd_field_iterator_t *iter  = qd_address_iterator_buffer(DEQ_HEAD(list), 0, length, ITER_VIEW_ALL);
+    qd_parsed_field_t   *trace = qd_parse(iter);
+    if (!qd_parse_ok(trace) || !qd_parse_is_list(trace) || qd_parse_sub_count(trace) != hops) {
+        sprintf(error, "Final trace is not a list of %d", hops);
+        return error;
+    }
+    for (int hop = 0; hop < hops; hop++) {
+        memset(id, 'a' + hop, 200);
+        sprintf(id + 200, "/router-%d", hop);
+        if (!qd_field_iterator_equal(qd_parse_raw(qd_parse_sub_value(trace, hop)), (unsigned char*) id)) {
+            sprintf(error, "Trace entry %d does not match", hop);
+            return error;
+        }
+    }
+
+    qd_parse_free(trace);
+    qd_field_iterator_free(iter);
+    qd_buffer_list_free_buffers(&list);
+    return 0;
+}
+
+
 int parse_tests()
 {
     int result = 0;
@@ -241,6 +475,9 @@ int parse_tests()
     TEST_CASE(test_parser_fixed_scalars, 0);
     TEST_CASE(test_parser_errors, 0);
     TEST_CASE(test_tracemask, 0);
+    TEST_CASE(test_parse_large_map, 0);
+    TEST_CASE(test_parse_nested_map, 0);
+    TEST_CASE(test_parse_splice_list, 0);
 
     return result;
 }
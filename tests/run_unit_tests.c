@@ -30,6 +30,7 @@ int server_tests(qd_dispatch_t *qd);
 int parse_tests(void);
 int compose_tests(void);
 int policy_tests(void);
+int action_queue_tests(void);
 
 int main(int argc, char** argv)
 {
@@ -55,6 +56,7 @@ int main(int argc, char** argv)
     result += alloc_tests();
 #endif
     result += policy_tests();
+    result += action_queue_tests();
     qd_dispatch_free(qd);       // dispatch_free last.
 
     return result;
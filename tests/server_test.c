@@ -23,11 +23,14 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/socket.h>
 #include "test_case.h"
 #include <qpid/dispatch.h>
+#include <qpid/dispatch/driver.h>
 
 #define THREAD_COUNT 4
 #define OCTET_COUNT  100
+#define IDLE_COUNT   100
 
 static qd_dispatch_t *qd;
 static sys_mutex_t   *test_lock;
@@ -133,6 +136,70 @@ static char* test_user_fd(void *context)
 }
 
 
+static char* test_driver_idle_connectors(void *context)
+{
+    qdpn_driver_t    *driver = qdpn_driver();
+    qdpn_connector_t *cxtr[IDLE_COUNT];
+    qdpn_connector_t *c;
+    int               sv[IDLE_COUNT][2];
+    int               active = IDLE_COUNT / 2;
+    int               count  = 0;
+    char             *error  = 0;
+
+    for (int i = 0; i < IDLE_COUNT; i++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) != 0) {
+            for (int j = 0; j < i; j++) {
+                qdpn_connector_close(cxtr[j]);
+                qdpn_connector_free(cxtr[j]);
+                close(sv[j][1]);
+            }
+            qdpn_driver_free(driver);
+            return "Error creating socket pair";
+        }
+        int flags = fcntl(sv[i][0], F_GETFL);
+        fcntl(sv[i][0], F_SETFL, flags | O_NONBLOCK);
+        cxtr[i] = qdpn_connector_fd(driver, sv[i][0], 0);
+    }
+
+    //
+    // Consume the initial activation of every connector and withdraw its
+    // interest in I/O, leaving all of them idle.
+    //
+    qdpn_driver_wait(driver, 0);
+    while (qdpn_driver_connector(driver))
+        ;
+    for (int i = 0; i < IDLE_COUNT; i++) {
+        qdpn_connector_activated(cxtr[i], QDPN_CONNECTOR_READABLE);
+        qdpn_connector_activated(cxtr[i], QDPN_CONNECTOR_WRITABLE);
+    }
+
+    //
+    // Make one connector readable.  Only that connector shall be handed back.
+    //
+    if (write(sv[active][1], "X", 1) != 1)
+        error = "Error writing to socket";
+    qdpn_connector_activate(cxtr[active], QDPN_CONNECTOR_READABLE);
+    qdpn_driver_wait(driver, 1000);
+    while (!error && (c = qdpn_driver_connector(driver))) {
+        count++;
+        if (c != cxtr[active])
+            error = "Idle connector returned by the driver";
+    }
+    if (!error && count != 1)
+        error = "Active connector not returned by the driver";
+    if (!error && !qdpn_connector_activated(cxtr[active], QDPN_CONNECTOR_READABLE))
+        error = "Expected Readable";
+
+    for (int i = 0; i < IDLE_COUNT; i++) {
+        qdpn_connector_close(cxtr[i]);
+        qdpn_connector_free(cxtr[i]);
+        close(sv[i][1]);
+    }
+    qdpn_driver_free(driver);
+    return error;
+}
+
+
 int server_tests(qd_dispatch_t *_qd)
 {
     int result = 0;
@@ -141,6 +208,7 @@ int server_tests(qd_dispatch_t *_qd)
     qd = _qd;
 
     TEST_CASE(test_user_fd, 0);
+    TEST_CASE(test_driver_idle_connectors, 0);
 
     sys_mutex_free(test_lock);
     return result;
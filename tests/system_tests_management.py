@@ -24,7 +24,9 @@ from qpid_dispatch.management.client import Node, ManagementError, Url, BadReque
 from qpid_dispatch_internal.management.qdrouter import QdSchema
 from qpid_dispatch_internal.compat import OrderedDict, dictify
 from system_test import Qdrouterd, message, retry, retry_exception, wait_ports, Process
-from proton import ConnectionException
+from proton import ConnectionException, Message
+from proton.handlers import MessagingHandler
+from proton.reactor import Container
 from itertools import chain
 from time import sleep
 
@@ -329,6 +331,15 @@ class ManagementTest(system_test.TestCase):
         response = self.node.query(type='connection')
         self.assertTrue(response.results)
 
+    def test_connection_io_counters(self):
+        """Verify connections report the octets moved over their sockets"""
+        connections = self.node.query(type='connection').get_dicts()
+        self.assertTrue(connections)
+        for conn in connections:
+            self.assertTrue(conn['octetsIn'] >= 0 and conn['octetsOut'] >= 0 and conn['ioYields'] >= 0)
+        # Our own management connection has exchanged at least the open frames and a query.
+        self.assertTrue([c for c in connections if c['octetsIn'] > 0 and c['octetsOut'] > 0])
+
     def test_router(self):
         """Verify router counts match entity counts"""
         entities = self.node.query().get_entities()
@@ -338,6 +349,33 @@ class ManagementTest(system_test.TestCase):
         self.assertEqual(router.linkCount, len([e for e in entities if e.type == LINK]))
         self.assertEqual(router.addrCount, len([e for e in entities if e.type == ADDRESS]))
 
+    def test_work_stealing(self):
+        """Verify that a backlog of connection work is shared out among the worker threads"""
+        conf = Qdrouterd.Config([
+            ('router', {'mode': 'standalone', 'routerId': 'workers'}),
+            ('container', {'workerThreads': 4, 'containerName': 'Qpid.Dispatch.Router.Workers'}),
+            ('listener', {'port':self.get_port(), 'role':'normal'})
+        ])
+        r = self.qdrouterd('workers', conf)
+        node = self.cleanup(Node.connect(r.addresses[0]))
+
+        def work_counts():
+            router = node.query(type=ROUTER).get_entities()[0]
+            return router.workItemsStolen, router.workItemsRequeued
+
+        stolen, requeued = work_counts()
+        test = WorkBacklogTest(r.addresses[0], pairs=16, count=500)
+        test.run()
+        self.assertEqual(None, test.error)
+        self.assertEqual(16 * 500, test.n_received)
+
+        # Every connection carries a continuous stream, so connections become
+        # ready again while a thread is still processing them, and the threads
+        # whose queues are empty take work queued for the busy ones.
+        after_stolen, after_requeued = work_counts()
+        self.assertGreater(after_stolen, stolen)
+        self.assertGreater(after_requeued, requeued)
+
     def test_router_node(self):
         """Test node entity in a trio of linked routers"""
         nodes = [self.cleanup(Node.connect(Url(r.addresses[0]))) for r in self.routers]
@@ -453,5 +491,48 @@ class ManagementTest(system_test.TestCase):
         got = self.node.call(self.node.request(operation="GET-SCHEMA", identity="self")).body
         self.assertEquals(schema, got)
 
+
+class WorkBacklogTest(MessagingHandler):
+    """Stream messages through the router on many connections at once"""
+    def __init__(self, address, pairs, count):
+        super(WorkBacklogTest, self).__init__()
+        self.address    = address
+        self.pairs      = pairs
+        self.count      = count
+        self.body       = 'x' * 4096
+        self.error      = None
+        self.conns      = []
+        self.n_sent     = {}
+        self.n_received = 0
+        self.n_ready    = 0
+
+    def on_start(self, event):
+        for i in range(self.pairs):
+            conn = event.container.connect(self.address)
+            self.conns.append(conn)
+            dest = "backlog.%d" % i
+            event.container.create_receiver(conn, dest)
+            sender = event.container.create_sender(conn, dest)
+            self.n_sent[sender.name] = 0
+
+    def on_sendable(self, event):
+        sender = event.sender
+        while sender.credit > 0 and self.n_sent[sender.name] < self.count:
+            sender.send(Message(body=self.body))
+            self.n_sent[sender.name] += 1
+
+    def on_message(self, event):
+        self.n_received += 1
+        if self.n_received == self.pairs * self.count:
+            for conn in self.conns:
+                conn.close()
+
+    def on_rejected(self, event):
+        self.error = "Delivery rejected"
+
+    def run(self):
+        Container(self).run()
+
+
 if __name__ == '__main__':
     unittest.main(system_test.main_module())
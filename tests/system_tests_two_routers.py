@@ -1056,6 +1056,111 @@ class ExcessDeliveriesReleasedTest(MessagingHandler):
 
 
 
+class ShardedCoreTest(TestCase):
+    """Route through two routers whose cores run three threads each"""
+
+    @classmethod
+    def setUpClass(cls):
+        super(ShardedCoreTest, cls).setUpClass()
+
+        def router(name, connection):
+            config = Qdrouterd.Config([
+                ('container', {'workerThreads': 4, 'containerName': 'Qpid.Dispatch.Router.%s'%name}),
+                ('router', {'mode': 'interior', 'routerId': 'QDR.%s'%name, 'coreThreads': 3}),
+                ('listener', {'port': cls.tester.get_port()}),
+                ('address', {'prefix': 'closest', 'distribution': 'closest'}),
+                connection
+            ])
+            cls.routers.append(cls.tester.qdrouterd(name, config, wait=True))
+
+        cls.routers = []
+
+        inter_router_port = cls.tester.get_port()
+
+        router('SA', ('listener', {'role': 'inter-router', 'port': inter_router_port}))
+        router('SB', ('connector', {'role': 'inter-router', 'port': inter_router_port}))
+
+        cls.routers[0].wait_router_connected('QDR.SB')
+        cls.routers[1].wait_router_connected('QDR.SA')
+
+    def test_01_ordering_and_settlement(self):
+        """
+        Send a stream of unsettled deliveries on each of several addresses, which the core
+        spreads over its worker shards.  Each stream must arrive in order and every delivery
+        must be settled back to its sender.
+        """
+        test = ShardedOrderingTest(self.routers[0].addresses[0], self.routers[1].addresses[0],
+                                   addresses=8, count=200)
+        test.run()
+        self.assertEqual(None, test.error)
+        self.assertEqual(8 * 200, test.n_received)
+        self.assertEqual(8 * 200, test.n_settled)
+
+
+class ShardedOrderingTest(MessagingHandler):
+    def __init__(self, address1, address2, addresses, count):
+        super(ShardedOrderingTest, self).__init__()
+        self.address1   = address1
+        self.address2   = address2
+        self.addresses  = addresses
+        self.count      = count
+        self.error      = None
+        self.n_sent     = {}
+        self.expected   = {}
+        self.n_received = 0
+        self.n_settled  = 0
+
+    def on_start(self, event):
+        self.conn1 = event.container.connect(self.address1)
+        self.conn2 = event.container.connect(self.address2)
+        for i in range(self.addresses):
+            dest = "closest.shard.%d" % i
+            event.container.create_receiver(self.conn2, dest)
+            sender = event.container.create_sender(self.conn1, dest)
+            self.n_sent[sender.name] = 0
+            self.expected[dest] = 0
+
+    def on_sendable(self, event):
+        sender = event.sender
+        dest   = sender.target.address
+        while sender.credit > 0 and self.n_sent[sender.name] < self.count:
+            sender.send(Message(address=dest, body={'seq': self.n_sent[sender.name]}))
+            self.n_sent[sender.name] += 1
+
+    def on_message(self, event):
+        dest = event.receiver.source.address
+        seq  = event.message.body['seq']
+        if seq != self.expected[dest]:
+            self.error = "Out of order on %s: expected %d, got %d" % (dest, self.expected[dest], seq)
+            self.finish()
+        self.expected[dest] = seq + 1
+        self.n_received += 1
+
+    def on_accepted(self, event):
+        self.count_settled()
+
+    def on_rejected(self, event):
+        self.error = "Delivery rejected"
+        self.count_settled()
+
+    def on_released(self, event):
+        self.error = "Delivery released"
+        self.count_settled()
+
+    def count_settled(self):
+        self.n_settled += 1
+        if self.n_settled == self.addresses * self.count:
+            self.finish()
+
+    def finish(self):
+        self.conn1.close()
+        self.conn2.close()
+
+    def run(self):
+        Container(self).run()
+
+
+
 try:
     SSLDomain(SSLDomain.MODE_CLIENT)
 
@@ -306,6 +306,46 @@ static char* test_bitmask(void *context)
 }
 
 
+static char* test_bitmask_set_ops(void *context)
+{
+    qd_bitmask_t *a    = qd_bitmask(0);
+    qd_bitmask_t *b    = qd_bitmask(0);
+    int           last = qd_bitmask_width() - 1;
+    int           num;
+    int           c;
+    int           total;
+
+    qd_bitmask_set_bit(a, 1);
+    qd_bitmask_set_bit(a, 64);
+    qd_bitmask_set_bit(a, last);
+    qd_bitmask_set_bit(b, 64);
+    qd_bitmask_set_bit(b, 65);
+
+    qd_bitmask_or(a, b);
+    if (qd_bitmask_cardinality(a) != 4)  return "Expected cardinality == 4 after or";
+
+    total = 0;
+    for (QD_BITMASK_EACH(a, num, c))
+        total += num;
+    if (total != 1 + 64 + 65 + last)     return "Expected bits 1, 64, 65 and the last after or";
+
+    qd_bitmask_andnot(a, b);
+    if (qd_bitmask_cardinality(a) != 2)  return "Expected cardinality == 2 after andnot";
+    if (!qd_bitmask_first_set(a, &num) || num != 1) return "Expected first set bit to be 1";
+
+    qd_bitmask_clear_bit(a, 1);
+    if (!qd_bitmask_first_set(a, &num) || num != last) return "Expected first set bit to be the last";
+
+    qd_bitmask_and(a, b);
+    if (qd_bitmask_cardinality(a) != 0)  return "Expected cardinality == 0 after and";
+    if (qd_bitmask_first_set(a, &num))   return "Expected no first set bit after and";
+
+    qd_bitmask_free(a);
+    qd_bitmask_free(b);
+    return 0;
+}
+
+
 int tool_tests(void)
 {
     int result = 0;
@@ -314,6 +354,7 @@ int tool_tests(void)
     TEST_CASE(test_deq_basic2, 0);
     TEST_CASE(test_deq_multi, 0);
     TEST_CASE(test_bitmask, 0);
+    TEST_CASE(test_bitmask_set_ops, 0);
 
     return result;
 }